@@ -1221,8 +1221,8 @@ QPoint AbstractLogView::convertCoordToFilePos( const QPoint& pos ) const
     // Determine column in screen space and convert it to file space
     int column = firstCol + ( pos.x() - leftMarginPx_ ) / charWidth_;
 
-    QString this_line = logData->getExpandedLineString( line );
-    const int length = this_line.length();
+    // (without reading the line, which might be very long)
+    const int length = logData->getLineLength( line );
 
     if ( column >= length )
         column = length - 1;
@@ -1380,8 +1380,13 @@ inline bool AbstractLogView::isCharWord( char c )
 // Select the word under the given position
 void AbstractLogView::selectWordAtPosition( const QPoint& pos )
 {
-    const int x = pos.x();
-    const QString line = logData->getExpandedLineString( pos.y() );
+    // Words are only looked for in a window around the position
+    // (a line might be far too long to be read whole)
+    static const int WORD_WINDOW = 4096;
+    const int windowStart = std::max( 0, pos.x() - WORD_WINDOW );
+    const int x = pos.x() - windowStart;
+    const QString line = logData->getExpandedLineWindow(
+            pos.y(), windowStart, ( x + 1 ) + WORD_WINDOW );
 
     if ( isCharWord( line[x].toLatin1() ) ) {
         // Search backward for the first character in the word
@@ -1404,7 +1409,8 @@ void AbstractLogView::selectWordAtPosition( const QPoint& pos )
             currentPos--;
         int end = currentPos;
 
-        selection_.selectPortion( pos.y(), start, end );
+        selection_.selectPortion( pos.y(),
+                windowStart + start, windowStart + end );
         updateGlobalSelection();
         update();
     }
@@ -1540,6 +1546,8 @@ void AbstractLogView::drawTextArea( QPaintDevice* paint_device, int32_t )
     static const qreal BULLET_AREA_WIDTH = charWidth_ * 2;
     static const int CONTENT_MARGIN_WIDTH = 1;
     static const int LINE_NUMBER_PADDING = charWidth_ / 2;
+    // Columns read around the visible ones, for the highlighting
+    static const int WINDOW_MARGIN = 1024;
 
     // First check the lines to be drawn are within range (might not be the case if
     // the file has just changed)
@@ -1559,8 +1567,18 @@ void AbstractLogView::drawTextArea( QPaintDevice* paint_device, int32_t )
     LOG(logDEBUG) << "bottomOfTextPx: " << bottomOfTextPx;
     LOG(logDEBUG) << "Height: " << paintDeviceHeight;
 
-    // Lines to write
-    const QStringList lines = logData->getExpandedLines( firstLine, nbLines );
+    // Lines to write, only the columns around the visible ones are read
+    // (a line might be far too long to be read whole)
+    const int windowStart = std::max( 0, firstCol - WINDOW_MARGIN );
+    const int windowLength = ( firstCol - windowStart ) + nbCols + WINDOW_MARGIN;
+    const QStringList lines = logData->getExpandedLineWindows(
+            firstLine, nbLines, windowStart, windowLength );
+    // Columns of the lines are converted to columns of the windows
+    const int visibleStart = firstCol - windowStart;
+    const auto inWindow = [windowStart]( int start, int end ) {
+        return Range( std::max( start, windowStart ) - windowStart,
+                std::max( end, windowStart ) - windowStart );
+    };
 
     // First draw the bullet left margin
     painter.setPen(palette.color(QPalette::Text));
@@ -1574,8 +1592,11 @@ void AbstractLogView::drawTextArea( QPaintDevice* paint_device, int32_t )
     // This is also the bullet zone width, used for marking clicks
     bulletZoneWidthPx_ = contentStartPosX;
 
-    // Update the length of line numbers
-    const int nbDigitsInLineNumber = countDigits( maxDisplayLineNumber() );
+    // Update the length of line numbers, line numbers still counted from
+    // the tail of the file are shown as "+N"
+    const bool provisionalLineNumbers = logData->hasProvisionalLineNumbers();
+    const int nbDigitsInLineNumber = countDigits( maxDisplayLineNumber() )
+        + ( provisionalLineNumbers ? 1 : 0 );
 
     // Draw the line numbers area
     int lineNumberAreaStartX = 0;
@@ -1618,9 +1639,8 @@ void AbstractLogView::drawTextArea( QPaintDevice* paint_device, int32_t )
         const int yPos = i * fontHeight;
         const int xPos = contentStartPosX + CONTENT_MARGIN_WIDTH;
 
-        // string to print, cut to fit the length and position of the view
+        // window of the line around the visible columns
         const QString line = lines[i];
-        const QString cutLine = line.mid( firstCol, nbCols );
 
         // Is there something selected in the line?
         int sel_start, sel_end;
@@ -1629,7 +1649,7 @@ void AbstractLogView::drawTextArea( QPaintDevice* paint_device, int32_t )
         bool isLineSelected = selection_.isLineSelected(line_index);
         Range selRange;
         if (isSelection)
-            selRange = Range(sel_start, sel_end + 1);
+            selRange = inWindow(sel_start, sel_end + 1);
         else if (isLineSelected)
             selRange = Range(line.size());
         std::list<Token> tokens
@@ -1647,7 +1667,7 @@ void AbstractLogView::drawTextArea( QPaintDevice* paint_device, int32_t )
                 int start = match.startColumn();
                 int end = start + match.length();
                 // Ignore matches that are *completely* outside view area
-                if (end <= firstCol || start >= firstCol + nbCols)
+                if (end <= visibleStart || start >= visibleStart + nbCols)
                     continue;
                 addLowerToken(
                     tokens, Token(Range(start, end), ColorScheme::QUICK_FIND));
@@ -1655,12 +1675,15 @@ void AbstractLogView::drawTextArea( QPaintDevice* paint_device, int32_t )
         }
         mergeSyntaxTokens(tokens, highlights_.colorize(line));
         /* TODO: make this configurable */
-        auto lineForSyntax = line.left(1024);
-        auto syntaxTokens
-            = StructConfigStore::get().syntaxColl().parse(lineForSyntax);
-        TRACE << "Parsed syntax:" << syntaxTokens;
-        filterTokensByScheme(syntaxTokens, colorScheme);
-        mergeSyntaxTokens(tokens, syntaxTokens);
+        // (the beginning of the line is only read if it is visible)
+        if (windowStart == 0) {
+            auto lineForSyntax = line.left(1024);
+            auto syntaxTokens
+                = StructConfigStore::get().syntaxColl().parse(lineForSyntax);
+            TRACE << "Parsed syntax:" << syntaxTokens;
+            filterTokensByScheme(syntaxTokens, colorScheme);
+            mergeSyntaxTokens(tokens, syntaxTokens);
+        }
 
         addLowerToken(tokens, Token(Range(line.length()), ColorScheme::TEXT));
         TRACE << "All  tokens" << tokens;
@@ -1670,7 +1693,7 @@ void AbstractLogView::drawTextArea( QPaintDevice* paint_device, int32_t )
                                     : colorScheme.text.background;
         drawColorizedText(painter, xPos, yPos, viewport()->width(), line,
                           CONTENT_MARGIN_WIDTH, tokens,
-                          Range::WithLength(firstCol, nbCols), lineColor);
+                          Range::WithLength(visibleStart, nbCols), lineColor);
         // Then draw the bullet
         painter.setPen( palette.color( QPalette::Text ) );
         const qreal circleSize = 5;
@@ -1715,7 +1738,10 @@ void AbstractLogView::drawTextArea( QPaintDevice* paint_device, int32_t )
         // Draw the line number
         if ( lineNumbersVisible_ ) {
             static const QString lineNumberFormat( "%1" );
-            const QString& lineNumberStr =
+            static const QString provisionalLineNumberFormat( "+%1" );
+            const QString& lineNumberStr = provisionalLineNumbers ?
+                provisionalLineNumberFormat.arg( displayLineNumber( line_index ) )
+                    .rightJustified( nbDigitsInLineNumber ) :
                 lineNumberFormat.arg( displayLineNumber( line_index ),
                         nbDigitsInLineNumber );
             painter.setPen(colorScheme.lineNumbers.foreground);
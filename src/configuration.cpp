@@ -42,6 +42,17 @@ Configuration::Configuration()
 
     loadLastSession_              = true;
 
+    parallelIndexing_             = true;
+    parallelSearch_               = true;
+    trigramIndex_                 = false;
+    memoryMapping_                = true;
+    indexCache_                   = true;
+    updateLatencyMs_              = 200;
+    tailFirstMiB_                 = 0;
+    sparseIndexStride_            = 0;
+    eliasFanoIndex_               = true;
+    memoryBudgetMiB_              = 0;
+
     overviewVisible_              = true;
     lineNumbersVisibleInMain_     = false;
     lineNumbersVisibleInFiltered_ = true;
@@ -97,6 +108,27 @@ void Configuration::retrieveFromStorage( QSettings& settings )
     if ( settings.contains( "session.loadLast" ) )
         loadLastSession_ = settings.value( "session.loadLast" ).toBool();
 
+    if ( settings.contains( "indexing.parallel" ) )
+        parallelIndexing_ = settings.value( "indexing.parallel" ).toBool();
+    if ( settings.contains( "search.parallel" ) )
+        parallelSearch_ = settings.value( "search.parallel" ).toBool();
+    if ( settings.contains( "search.trigramIndex" ) )
+        trigramIndex_ = settings.value( "search.trigramIndex" ).toBool();
+    if ( settings.contains( "indexing.memoryMapping" ) )
+        memoryMapping_ = settings.value( "indexing.memoryMapping" ).toBool();
+    if ( settings.contains( "indexing.cache" ) )
+        indexCache_ = settings.value( "indexing.cache" ).toBool();
+    if ( settings.contains( "indexing.updateLatencyMs" ) )
+        updateLatencyMs_ = settings.value( "indexing.updateLatencyMs" ).toInt();
+    if ( settings.contains( "indexing.tailFirstMiB" ) )
+        tailFirstMiB_ = settings.value( "indexing.tailFirstMiB" ).toInt();
+    if ( settings.contains( "indexing.sparseStride" ) )
+        sparseIndexStride_ = settings.value( "indexing.sparseStride" ).toInt();
+    if ( settings.contains( "indexing.eliasFano" ) )
+        eliasFanoIndex_ = settings.value( "indexing.eliasFano" ).toBool();
+    if ( settings.contains( "memory.budgetMiB" ) )
+        memoryBudgetMiB_ = settings.value( "memory.budgetMiB" ).toInt();
+
     // View settings
     if ( settings.contains( "view.overviewVisible" ) )
         overviewVisible_ = settings.value( "view.overviewVisible" ).toBool();
@@ -135,6 +167,16 @@ void Configuration::saveToStorage( QSettings& settings ) const
     settings.setValue( "polling.enabled", pollingEnabled_ );
     settings.setValue( "polling.intervalMs", pollIntervalMs_ );
     settings.setValue( "session.loadLast", loadLastSession_);
+    settings.setValue( "indexing.parallel", parallelIndexing_ );
+    settings.setValue( "search.parallel", parallelSearch_ );
+    settings.setValue( "search.trigramIndex", trigramIndex_ );
+    settings.setValue( "indexing.memoryMapping", memoryMapping_ );
+    settings.setValue( "indexing.cache", indexCache_ );
+    settings.setValue( "indexing.updateLatencyMs", updateLatencyMs_ );
+    settings.setValue( "indexing.tailFirstMiB", tailFirstMiB_ );
+    settings.setValue( "indexing.sparseStride", sparseIndexStride_ );
+    settings.setValue( "indexing.eliasFano", eliasFanoIndex_ );
+    settings.setValue( "memory.budgetMiB", memoryBudgetMiB_ );
 
     settings.setValue( "view.overviewVisible", overviewVisible_ );
     settings.setValue( "view.lineNumbersVisibleInMain", lineNumbersVisibleInMain_ );
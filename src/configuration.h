@@ -71,6 +71,46 @@ class Configuration : public Persistable {
     { return loadLastSession_; }
     void setLoadLastSession( bool enabled )
     { loadLastSession_ = enabled; }
+    bool parallelIndexing() const
+    { return parallelIndexing_; }
+    void setParallelIndexing( bool enabled )
+    { parallelIndexing_ = enabled; }
+    bool parallelSearch() const
+    { return parallelSearch_; }
+    void setParallelSearch( bool enabled )
+    { parallelSearch_ = enabled; }
+    bool trigramIndex() const
+    { return trigramIndex_; }
+    void setTrigramIndex( bool enabled )
+    { trigramIndex_ = enabled; }
+    bool memoryMapping() const
+    { return memoryMapping_; }
+    void setMemoryMapping( bool enabled )
+    { memoryMapping_ = enabled; }
+    bool indexCache() const
+    { return indexCache_; }
+    void setIndexCache( bool enabled )
+    { indexCache_ = enabled; }
+    uint32_t updateLatencyMs() const
+    { return updateLatencyMs_; }
+    void setUpdateLatencyMs( uint32_t latency )
+    { updateLatencyMs_ = latency; }
+    uint32_t tailFirstMiB() const
+    { return tailFirstMiB_; }
+    void setTailFirstMiB( uint32_t size )
+    { tailFirstMiB_ = size; }
+    int sparseIndexStride() const
+    { return sparseIndexStride_; }
+    void setSparseIndexStride( int stride )
+    { sparseIndexStride_ = stride; }
+    bool eliasFanoIndex() const
+    { return eliasFanoIndex_; }
+    void setEliasFanoIndex( bool enabled )
+    { eliasFanoIndex_ = enabled; }
+    uint32_t memoryBudgetMiB() const
+    { return memoryBudgetMiB_; }
+    void setMemoryBudgetMiB( uint32_t budget )
+    { memoryBudgetMiB_ = budget; }
 
     // View settings
     bool isOverviewVisible() const
@@ -112,6 +152,16 @@ class Configuration : public Persistable {
     bool pollingEnabled_;
     uint32_t pollIntervalMs_;
     bool loadLastSession_;
+    bool parallelIndexing_;
+    bool parallelSearch_;
+    bool trigramIndex_;
+    bool memoryMapping_;
+    bool indexCache_;
+    uint32_t updateLatencyMs_;
+    uint32_t tailFirstMiB_;
+    int sparseIndexStride_;
+    bool eliasFanoIndex_;
+    uint32_t memoryBudgetMiB_;
 
     // View settings
     bool overviewVisible_;
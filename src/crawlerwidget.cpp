@@ -47,6 +47,7 @@
 #include "regexp_filter.h"
 #include "qt_utils.h"
 #include "signal_slot.h"
+#include "data/memorygovernor.h"
 
 // Palette for error signaling (yellow background)
 const QPalette CrawlerWidget::errorPalette( QColor( "yellow" ) );
@@ -478,6 +479,37 @@ void CrawlerWidget::applyConfiguration()
     // Polling interval
     logData_->setPollingInterval(
             config->pollingEnabled() ? config->pollIntervalMs() : 0 );
+    // Rate of the updates when the file grows
+    logData_->setUpdateLatency( config->updateLatencyMs() );
+
+    // Indexing tunables (used from the next indexing)
+    IndexingOptions indexing_options;
+    if ( ! config->parallelIndexing() )
+        indexing_options.nbThreads = 1;
+    // (mapping can only be turned off, it is already off on Windows)
+    if ( ! config->memoryMapping() )
+        indexing_options.memoryMapping = false;
+    // Index huge files from their last MiB first (0 disables it)
+    indexing_options.tailFirstSize =
+        static_cast<qint64>( config->tailFirstMiB() ) * 1024 * 1024;
+    // Keep one line position every N lines (0 keeps them all)
+    indexing_options.sparseStride = config->sparseIndexStride();
+    // (the constant time coding can only be turned off, it is already
+    // off without a population count instruction)
+    if ( ! config->eliasFanoIndex() )
+        indexing_options.eliasFanoIndex = false;
+    indexing_options.indexCache = config->indexCache();
+    // Index the trigrams of the lines for the searches
+    indexing_options.trigramIndex = config->trigramIndex();
+    logData_->setIndexingOptions( indexing_options );
+    // (used from the next search)
+    logFilteredData_->setSearchThreads(
+            config->parallelSearch() ? QThread::idealThreadCount() : 1 );
+
+    // Memory held by all the tabs (0 for no limit)
+    MemoryGovernor::get().setBudget(
+            static_cast<qint64>( config->memoryBudgetMiB() ) * 1024 * 1024 );
+    MemoryGovernor::get().rebalance();
 
     // Update the SearchLine (history)
     updateSearchCombo();
@@ -543,8 +575,9 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
 
 void CrawlerWidget::fileChangedHandler( LogData::MonitoredFileStatus status )
 {
-    // Handle the case where the file has been truncated
-    if ( status == LogData::Truncated ) {
+    // Handle the case where the file has been truncated, or where the
+    // beginning of a file indexed from its tail has been indexed
+    if ( status == LogData::Truncated || status == LogData::LinesRenumbered ) {
         // Clear all marks (TODO offer the option to keep them)
         logFilteredData_->clearMarks();
         if ( ! searchInfoLine->text().isEmpty() ) {
@@ -25,6 +25,76 @@
 
 #include "abstractlogdata.h"
 
+#include <algorithm>
+
+#include "literalfinder.h"
+
+RawLines::RawLines( QTextCodec* codec )
+    : decoder_( codec ), buffer_(), begins_(), ends_()
+{
+}
+
+QString RawLines::lineString( int i ) const
+{
+    return decoder_.decode( lineData( i ), lineSize( i ) );
+}
+
+QString RawLines::expandedLineString( int i ) const
+{
+    return decoder_.decodeExpanded( lineData( i ), lineSize( i ) );
+}
+
+int RawLines::expandedLength( int i ) const
+{
+    return AbstractLogData::expandedLength( lineString( i ) );
+}
+
+// The lines follow each other in the buffer, the line an occurrence is
+// in is found from its position, and the ones crossing the end of a
+// line are skipped.
+int RawLines::findLine( int first, const LiteralFinder& literal ) const
+{
+    if ( first >= size() )
+        return size();
+
+    const char* const data = buffer_.constData();
+    const int end = ends_.back();
+    int from = begins_[first];
+    while ( true ) {
+        const int offset = literal.find( data, end, from );
+        if ( offset < 0 )
+            return size();
+
+        const int line = std::upper_bound( begins_.begin() + first, begins_.end(), offset )
+            - begins_.begin() - 1;
+        if ( offset + literal.size() <= ends_[line] )
+            return line;
+
+        from = offset + 1;
+    }
+}
+
+void RawLines::addLine( int begin, int end )
+{
+    begins_.push_back( begin );
+    ends_.push_back( end );
+}
+
+void RawLines::append( const RawLines& other )
+{
+    // (the buffer is shared, not copied)
+    if ( begins_.empty() ) {
+        *this = other;
+        return;
+    }
+
+    for ( int i = 0; i < other.size(); ++i ) {
+        const int begin = buffer_.size();
+        buffer_.append( other.lineData( i ), other.lineSize( i ) );
+        addLine( begin, buffer_.size() );
+    }
+}
+
 AbstractLogData::AbstractLogData()
 {
 }
@@ -53,6 +123,26 @@ QStringList AbstractLogData::getExpandedLines( qint64 first_line, int number ) c
     return doGetExpandedLines( first_line, number );
 }
 
+// Simple wrapper in order to use a clean Template Method
+RawLines AbstractLogData::getRawLines( qint64 first_line, int number ) const
+{
+    return doGetRawLines( first_line, number );
+}
+
+// Simple wrapper in order to use a clean Template Method
+QString AbstractLogData::getExpandedLineWindow( qint64 line,
+        int first_column, int nb_columns ) const
+{
+    return doGetExpandedLineWindow( line, first_column, nb_columns );
+}
+
+// Simple wrapper in order to use a clean Template Method
+QStringList AbstractLogData::getExpandedLineWindows( qint64 first_line, int number,
+        int first_column, int nb_columns ) const
+{
+    return doGetExpandedLineWindows( first_line, number, first_column, nb_columns );
+}
+
 // Simple wrapper in order to use a clean Template Method
 qint64 AbstractLogData::getNbLine() const
 {
@@ -71,6 +161,41 @@ int AbstractLogData::getLineLength( qint64 line ) const
     return doGetLineLength( line );
 }
 
+bool AbstractLogData::hasProvisionalLineNumbers() const
+{
+    return doHasProvisionalLineNumbers();
+}
+
+// Same as untabify, without building the string
+int AbstractLogData::expandedLength( const QString& line )
+{
+    int length = 0;
+    for ( const QChar c : line ) {
+        if ( c == '\t' )
+            length += tabStop - ( length % tabStop );
+        else
+            ++length;
+    }
+
+    return length;
+}
+
+QString AbstractLogData::doGetExpandedLineWindow( qint64 line,
+        int first_column, int nb_columns ) const
+{
+    return doGetExpandedLineString( line ).mid( first_column, nb_columns );
+}
+
+QStringList AbstractLogData::doGetExpandedLineWindows( qint64 first_line, int number,
+        int first_column, int nb_columns ) const
+{
+    QStringList windows = doGetExpandedLines( first_line, number );
+    for ( QString& window : windows )
+        window = window.mid( first_column, nb_columns );
+
+    return windows;
+}
+
 void AbstractLogData::setDisplayEncoding( Encoding encoding )
 {
     doSetDisplayEncoding( encoding );
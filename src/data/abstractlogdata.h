@@ -20,11 +20,71 @@
 #ifndef ABSTRACTLOGDATA_H
 #define ABSTRACTLOGDATA_H
 
+#include <vector>
+
+#include <QByteArray>
 #include <QObject>
 #include <QString>
 #include <QStringList>
 
 #include "utils.h"
+#include "linedecoder.h"
+
+// A set of lines as the raw bytes of the file, all in one buffer,
+// which are only decoded if and when asked for.
+// Much cheaper than a QStringList for the users that only look at
+// some of the lines, or at their bytes.
+class LiteralFinder;
+
+class RawLines
+{
+  public:
+    // The lines will be decoded with the passed codec (Latin-1 if null)
+    explicit RawLines( QTextCodec* codec = nullptr );
+
+    // Number of lines
+    int size() const { return static_cast<int>( begins_.size() ); }
+
+    // Bytes of the passed line, without its end of line
+    // (only valid as long as this object is not changed)
+    const char* lineData( int i ) const
+    { return buffer_.constData() + begins_[i]; }
+    // Number of bytes of the passed line
+    int lineSize( int i ) const
+    { return ends_[i] - begins_[i]; }
+
+    // Returns the passed line decoded
+    QString lineString( int i ) const;
+    // Returns the passed line decoded, with tabs expanded
+    QString expandedLineString( int i ) const;
+    // Returns the visible length of the passed line (tabs expanded)
+    int expandedLength( int i ) const;
+    // Whether the bytes of the passed line can be matched as UTF-8
+    bool isUtf8( int i ) const
+    { return decoder_.isUtf8( lineData( i ), lineSize( i ) ); }
+
+    // Whether the ASCII characters of the decoded lines are their
+    // ASCII bytes (so the lines can be searched with findLine)
+    bool isAsciiCompatible() const { return decoder_.isAsciiCompatible(); }
+    // Returns the first line at or after first containing the literal
+    // of the passed finder, or size() if there are none.
+    // The bytes of all the lines are scanned at once.
+    int findLine( int first, const LiteralFinder& literal ) const;
+
+    // Used to build the lines:
+    // Set the buffer the lines are in
+    void setBuffer( const QByteArray& buffer ) { buffer_ = buffer; }
+    // Add the line [begin, end) of the buffer
+    void addLine( int begin, int end );
+    // Add all the lines of the passed set (copying their bytes)
+    void append( const RawLines& other );
+
+  private:
+    LineDecoder decoder_;
+    QByteArray buffer_;
+    std::vector<int> begins_;
+    std::vector<int> ends_;
+};
 
 // Base class representing a set of data.
 // It can be either a full set or a filtered set.
@@ -44,6 +104,15 @@ class AbstractLogData : public QObject {
     QStringList getLines( qint64 first_line, int number ) const;
     // Returns a set of lines with tabs expanded
     QStringList getExpandedLines( qint64 first_line, int number ) const;
+    // Returns a set of lines without decoding them
+    RawLines getRawLines( qint64 first_line, int number ) const;
+    // Returns the columns [first_column, first_column + nb_columns) of
+    // the passed line, with tabs expanded (shorter if the line is)
+    QString getExpandedLineWindow( qint64 line,
+            int first_column, int nb_columns ) const;
+    // Returns the same window of columns of a set of lines
+    QStringList getExpandedLineWindows( qint64 first_line, int number,
+            int first_column, int nb_columns ) const;
     // Returns the total number of lines
     qint64 getNbLine() const;
     // Returns the visible length of the longest line
@@ -52,12 +121,18 @@ class AbstractLogData : public QObject {
     // Returns the visible length of the passed line
     // Tabs are expanded
     int getLineLength( qint64 line ) const;
+    // Returns whether the line numbers are relative to a part of the
+    // file that is not the beginning (which is still being indexed)
+    bool hasProvisionalLineNumbers() const;
 
     // Set the view to use the passed encoding for display
     void setDisplayEncoding( Encoding encoding );
 
     // Length of a tab stop
-    static const int tabStop = 8;
+    static const int tabStop = LineDecoder::tabStop;
+
+    // Returns the visible length of the passed line, as if untabified
+    static int expandedLength( const QString& line );
 
   protected:
     // Internal function called to get a given line
@@ -68,6 +143,14 @@ class AbstractLogData : public QObject {
     virtual QStringList doGetLines( qint64 first_line, int number ) const = 0;
     // Internal function called to get a set of expanded lines
     virtual QStringList doGetExpandedLines( qint64 first_line, int number ) const = 0;
+    // Internal function called to get a set of raw lines
+    virtual RawLines doGetRawLines( qint64 first_line, int number ) const = 0;
+    // Internal functions called to get windows of lines
+    // Not pure: by default the windows are cut from the expanded lines
+    virtual QString doGetExpandedLineWindow( qint64 line,
+            int first_column, int nb_columns ) const;
+    virtual QStringList doGetExpandedLineWindows( qint64 first_line, int number,
+            int first_column, int nb_columns ) const;
     // Internal function called to get the number of lines
     virtual qint64 doGetNbLine() const = 0;
     // Internal function called to get the maximum length
@@ -78,28 +161,11 @@ class AbstractLogData : public QObject {
     virtual void doSetDisplayEncoding( Encoding encoding ) = 0;
     // Internal function called to set the newline offsets
     virtual void doSetMultibyteEncodingOffsets( int before_cr, int after_cr ) = 0;
+    // Not pure: line numbers are usually final
+    virtual bool doHasProvisionalLineNumbers() const { return false; }
 
     static inline QString untabify( const QString& line ) {
-        QString untabified_line;
-        int total_spaces = 0;
-
-        for ( int j = 0; j < line.length(); j++ ) {
-            if ( line[j] == '\t' ) {
-                int spaces = tabStop - ( ( j + total_spaces ) % tabStop );
-                // TRACE << "Replacing tab at char " << j << " (" << spaces << " spaces)";
-                QString blanks( spaces, QChar(' ') );
-                untabified_line.append( blanks );
-                total_spaces += spaces - 1;
-            }
-            else if ( line[j] == '\0' ) {
-                untabified_line.append( QChar(' ') );
-            }
-            else {
-                untabified_line.append( line[j] );
-            }
-        }
-
-        return untabified_line;
+        return LineDecoder::expandTabs( line );
     }
 
     static inline QString untabify( const char* line ) {
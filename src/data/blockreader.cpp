@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/blockreader.h"
+
+#include <QElapsedTimer>
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_FREEBSD) || defined(Q_OS_MACOS)
+#include <fcntl.h>
+#endif
+
+#include "log.h"
+
+const int BlockReader::minBlockSize = 1*1024*1024;
+const int BlockReader::maxBlockSize = 16*1024*1024;
+
+BlockReader::BlockReader( const QString& fileName, qint64 position,
+        int initialBlockSize, int nbBuffers )
+    : fileName_( fileName ), position_( position ),
+    blockSize_( qBound( minBlockSize, initialBlockSize, maxBlockSize ) ),
+    nbBuffers_( qMax( 1, nbBuffers ) ),
+    endReached_( false ), stopRequested_( false )
+{
+    thread_ = std::thread( &BlockReader::run, this );
+}
+
+BlockReader::~BlockReader()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        stopRequested_ = true;
+    }
+    bufferAvailable_.notify_one();
+
+    thread_.join();
+}
+
+QByteArray BlockReader::nextBlock()
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    blockAvailable_.wait( lock, [this]{ return ! blocks_.empty() || endReached_; } );
+
+    if ( blocks_.empty() )
+        return QByteArray();
+
+    QByteArray block = std::move( blocks_.front() );
+    blocks_.pop_front();
+    lock.unlock();
+
+    bufferAvailable_.notify_one();
+
+    return block;
+}
+
+// Double the blocks when a read is much shorter than the time it takes
+// to scan them, halve them when it is long enough to starve the consumer.
+int BlockReader::nextBlockSize( int size, qint64 elapsed_ms )
+{
+    if ( elapsed_ms < 10 && size < maxBlockSize )
+        return qMin( size * 2, maxBlockSize );
+    else if ( elapsed_ms > 200 && size > minBlockSize )
+        return qMax( size / 2, minBlockSize );
+    else
+        return size;
+}
+
+void BlockReader::run()
+{
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::ReadOnly ) || ! file.seek( position_ ) ) {
+        LOG(logWARNING) << "BlockReader: cannot read " << fileName_.toStdString();
+        std::lock_guard<std::mutex> lock( mutex_ );
+        endReached_ = true;
+        blockAvailable_.notify_one();
+        return;
+    }
+
+    adviseSequential( &file );
+
+    QElapsedTimer timer;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock( mutex_ );
+            bufferAvailable_.wait( lock,
+                    [this]{ return blocks_.size() < nbBuffers_ || stopRequested_; } );
+            if ( stopRequested_ )
+                break;
+        }
+
+        timer.start();
+        QByteArray block = file.read( blockSize_ );
+        const qint64 elapsed_ms = timer.elapsed();
+
+        std::lock_guard<std::mutex> lock( mutex_ );
+        if ( block.isEmpty() ) {
+            endReached_ = true;
+            blockAvailable_.notify_one();
+            break;
+        }
+
+        // A short read is the end of the file, not a slow disk
+        if ( block.size() == blockSize_ )
+            blockSize_ = nextBlockSize( blockSize_, elapsed_ms );
+
+        blocks_.push_back( std::move( block ) );
+        blockAvailable_.notify_one();
+    }
+}
+
+void BlockReader::adviseSequential( QFile* file )
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_FREEBSD)
+    // Usually doubles the read-ahead window
+    posix_fadvise( file->handle(), 0, 0, POSIX_FADV_SEQUENTIAL );
+#elif defined(Q_OS_MACOS)
+    fcntl( file->handle(), F_RDAHEAD, 1 );
+#else
+    Q_UNUSED( file );
+#endif
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCKREADER_H
+#define BLOCKREADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+// Reads a file sequentially in a thread of its own, a few blocks ahead
+// of the consumer, so that the disk and the CPU scanning what has been
+// read are busy at the same time.
+// The size of the blocks follows the measured speed of the reads: big
+// blocks keep the overhead low on fast disks, smaller ones start
+// feeding the consumer earlier on slow (e.g. network) file systems.
+class BlockReader
+{
+  public:
+    // Start reading the passed file from position, with at most
+    // nbBuffers blocks read in advance.
+    BlockReader( const QString& fileName, qint64 position,
+            int initialBlockSize, int nbBuffers = 3 );
+    // Stop reading, the blocks not consumed are discarded.
+    ~BlockReader();
+
+    BlockReader( const BlockReader& ) = delete;
+    BlockReader& operator=( const BlockReader& ) = delete;
+
+    // Returns the next block of the file, waiting for it if needed,
+    // or an empty block once the end of the file (as it was when the
+    // reader got there) or an error has been reached.
+    QByteArray nextBlock();
+
+    // Returns the size of the block to read after a read of
+    // size bytes which took elapsed_ms.
+    static int nextBlockSize( int size, qint64 elapsed_ms );
+
+    // Bounds of the size of the blocks
+    static const int minBlockSize;
+    static const int maxBlockSize;
+
+  private:
+    // Run in the reader thread
+    void run();
+    // Tell the OS the file is going to be read sequentially
+    static void adviseSequential( QFile* file );
+
+    const QString fileName_;
+    qint64 position_;
+    int blockSize_;
+    const size_t nbBuffers_;
+
+    std::mutex mutex_;
+    std::condition_variable blockAvailable_;
+    std::condition_variable bufferAvailable_;
+    std::deque<QByteArray> blocks_;
+    bool endReached_;
+    bool stopRequested_;
+
+    std::thread thread_;
+};
+
+#endif
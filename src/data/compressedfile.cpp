@@ -0,0 +1,616 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/compressedfile.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QFile>
+#include <QFileInfo>
+
+#ifdef GLOGG_SUPPORTS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef GLOGG_SUPPORTS_ZSTD
+#include <zstd.h>
+#endif
+
+#include "log.h"
+
+const qint64 CompressedFile::checkpointInterval = 4*1024*1024;
+
+namespace {
+    // Size of the reads from the compressed file
+    const int inputSize = 256*1024;
+    // Size of the blocks passed to the consumer, and of what is
+    // decompressed in advance by read()
+    const int outputSize = 1024*1024;
+    // Data needed to restart the decompression of a deflate stream
+    const int windowSize = 32*1024;
+    // Number of zstd decompressions kept by read() (a few readers can
+    // read different parts of the file in turn)
+    const size_t nbKeptStreams = 8;
+}
+
+struct CompressedFile::ZstdStream
+{
+#ifdef GLOGG_SUPPORTS_ZSTD
+    ZstdStream() : stream( ZSTD_createDStream() ) { ZSTD_initDStream( stream ); }
+    ~ZstdStream() { ZSTD_freeDStream( stream ); }
+
+    ZstdStream( const ZstdStream& ) = delete;
+    ZstdStream& operator=( const ZstdStream& ) = delete;
+
+    ZSTD_DStream* stream;
+#endif
+    // Position in the compressed data of what it has been passed,
+    // and in the decompressed data of what it has produced
+    qint64 in = 0;
+    qint64 out = 0;
+};
+
+CompressedFile::Format CompressedFile::detectFormat( const QString& fileName )
+{
+    QFile file( fileName );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return Format::None;
+
+    const QByteArray magic = file.read( 4 );
+#ifdef GLOGG_SUPPORTS_ZLIB
+    if ( magic.startsWith( QByteArray( "\x1f\x8b", 2 ) ) )
+        return Format::Gzip;
+#endif
+#ifdef GLOGG_SUPPORTS_ZSTD
+    if ( magic == QByteArray( "\x28\xb5\x2f\xfd", 4 ) )
+        return Format::Zstd;
+#endif
+    Q_UNUSED( magic );
+
+    return Format::None;
+}
+
+std::shared_ptr<CompressedFile> CompressedFile::open( const QString& fileName )
+{
+    const Format format = detectFormat( fileName );
+    if ( format == Format::None )
+        return nullptr;
+
+    LOG(logINFO) << fileName.toStdString() << " is compressed";
+    return std::make_shared<CompressedFile>( fileName, format );
+}
+
+CompressedFile::CompressedFile( const QString& fileName, Format format )
+    : fileName_( fileName ), format_( format ),
+    mutex_(), checkpoints_(), compressedSize_( 0 ), size_( 0 ),
+    cacheMutex_(), cacheBeginning_( 0 ), cache_(), streams_()
+{
+}
+
+CompressedFile::~CompressedFile()
+{
+}
+
+bool CompressedFile::index(
+        const std::function<bool( const char*, int, int )>& consumer )
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        checkpoints_.clear();
+        compressedSize_ = QFileInfo( fileName_ ).size();
+        size_ = 0;
+    }
+    {
+        QMutexLocker locker( &cacheMutex_ );
+        cache_.clear();
+        streams_.clear();
+    }
+
+    // Everything can be decompressed from the beginning
+    addCheckpoint( { 0, 0, 0, QByteArray(), true } );
+
+    // The size is updated before the consumer is called, so it can
+    // read what it is passed.
+    const qint64 compressed_size = compressedSize();
+    const auto add_output = [this, &consumer, compressed_size](
+            const char* data, int length, qint64 position ) {
+        {
+            QMutexLocker locker( &mutex_ );
+            size_ += length;
+        }
+        const int progress = ( compressed_size > 0 ) ?
+            position * 100 / compressed_size : 100;
+        return consumer( data, length, progress );
+    };
+
+    switch ( format_ ) {
+        case Format::Gzip:
+            return indexGzip( add_output );
+        case Format::Zstd:
+            return indexZstd( add_output );
+        default:
+            return false;
+    }
+}
+
+qint64 CompressedFile::compressedSize() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return compressedSize_;
+}
+
+qint64 CompressedFile::size() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return size_;
+}
+
+bool CompressedFile::read( qint64 first_byte, qint64 end_byte,
+        QByteArray* data ) const
+{
+    QMutexLocker locker( &cacheMutex_ );
+
+    if ( first_byte >= cacheBeginning_
+            && end_byte <= cacheBeginning_ + cache_.size() ) {
+        *data = cache_.mid( first_byte - cacheBeginning_, end_byte - first_byte );
+        return true;
+    }
+
+    const Checkpoint checkpoint = findCheckpoint( first_byte );
+    const qint64 cache_end = qMax( end_byte, qMin( first_byte + outputSize, size() ) );
+
+    QByteArray decompressed( cache_end - first_byte, Qt::Uninitialized );
+    bool ok = false;
+    switch ( format_ ) {
+        case Format::Gzip:
+            ok = readGzip( checkpoint, first_byte, &decompressed );
+            break;
+        case Format::Zstd:
+            ok = readZstd( checkpoint, first_byte, &decompressed );
+            break;
+        default:
+            break;
+    }
+
+    if ( ! ok ) {
+        LOG(logWARNING) << "Cannot decompress " << fileName_.toStdString()
+            << " at " << first_byte;
+        return false;
+    }
+
+    cacheBeginning_ = first_byte;
+    cache_ = decompressed;
+    *data = decompressed.left( end_byte - first_byte );
+
+    return true;
+}
+
+void CompressedFile::dropCache()
+{
+    QMutexLocker locker( &cacheMutex_ );
+
+    cacheBeginning_ = 0;
+    cache_ = QByteArray();
+    streams_.clear();
+}
+
+qint64 CompressedFile::memoryUsage() const
+{
+    qint64 usage = 0;
+
+    {
+        QMutexLocker locker( &mutex_ );
+        usage += checkpoints_.capacity() * sizeof( Checkpoint );
+        for ( const auto& checkpoint : checkpoints_ )
+            usage += checkpoint.window.capacity();
+    }
+
+    QMutexLocker locker( &cacheMutex_ );
+    usage += cache_.capacity();
+#ifdef GLOGG_SUPPORTS_ZSTD
+    for ( const auto& stream : streams_ )
+        usage += sizeof( ZstdStream ) + ZSTD_sizeof_DStream( stream->stream );
+#endif
+
+    return usage;
+}
+
+void CompressedFile::addCheckpoint( Checkpoint checkpoint )
+{
+    QMutexLocker locker( &mutex_ );
+
+    checkpoints_.push_back( std::move( checkpoint ) );
+}
+
+CompressedFile::Checkpoint CompressedFile::findCheckpoint( qint64 position ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    const auto next = std::upper_bound( checkpoints_.begin(), checkpoints_.end(),
+            position, []( qint64 p, const Checkpoint& c ) { return p < c.out; } );
+
+    if ( next == checkpoints_.begin() )
+        return { 0, 0, 0, QByteArray(), true };
+    else
+        return *( next - 1 );
+}
+
+bool CompressedFile::findIndependentCheckpoint( qint64 position,
+        Checkpoint* checkpoint ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    for ( const auto& c : checkpoints_ ) {
+        if ( c.out == position && c.independent ) {
+            *checkpoint = c;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifdef GLOGG_SUPPORTS_ZLIB
+bool CompressedFile::indexGzip(
+        const OutputFunction& output_function )
+{
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    z_stream stream;
+    memset( &stream, 0, sizeof( stream ) );
+    // 47 is 15 (largest window) + 32 (detect the gzip header)
+    if ( inflateInit2( &stream, 47 ) != Z_OK )
+        return false;
+
+    QByteArray input( inputSize, Qt::Uninitialized );
+    QByteArray output( outputSize, Qt::Uninitialized );
+    // The end of the previous output block (for the windows)
+    QByteArray previous_output;
+
+    stream.next_out = reinterpret_cast<Bytef*>( output.data() );
+    stream.avail_out = outputSize;
+
+    qint64 total_in = 0;
+    qint64 total_out = 0;
+    qint64 last_checkpoint = 0;
+    bool member_beginning = true;
+    bool ok = true;
+    for (;;) {
+        if ( stream.avail_in == 0 ) {
+            const qint64 nb_read = file.read( input.data(), inputSize );
+            if ( nb_read <= 0 )
+                break;
+            stream.next_in = reinterpret_cast<Bytef*>( input.data() );
+            stream.avail_in = nb_read;
+        }
+
+        const uInt avail_in = stream.avail_in;
+        const uInt avail_out = stream.avail_out;
+        // Stop at the end of each block to consider a checkpoint
+        const int ret = inflate( &stream, Z_BLOCK );
+        total_in += avail_in - stream.avail_in;
+        total_out += avail_out - stream.avail_out;
+        if ( stream.avail_out != avail_out )
+            member_beginning = false;
+
+        if ( ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR ) {
+            // Garbage after the last member is ignored
+            ok = member_beginning && total_out > 0;
+            if ( ! ok )
+                LOG(logWARNING) << "Corrupted gzip file " << fileName_.toStdString()
+                    << " at " << total_in;
+            break;
+        }
+
+        const int filled = outputSize - stream.avail_out;
+        if ( ret == Z_STREAM_END ) {
+            // Another member might follow
+            inflateReset( &stream );
+            member_beginning = true;
+            addCheckpoint( { total_in, total_out, 0, QByteArray(), true } );
+            last_checkpoint = total_out;
+        }
+        else if ( ( stream.data_type & 128 ) && ! ( stream.data_type & 64 )
+                && total_out - last_checkpoint >= checkpointInterval ) {
+            // At the end of a block (which is not the last of its member)
+            const int from_output = qMin( filled, windowSize );
+            const QByteArray window = previous_output.right( windowSize - from_output )
+                + QByteArray( output.constData() + filled - from_output, from_output );
+            addCheckpoint( { total_in, total_out, stream.data_type & 7,
+                    qCompress( window, 1 ), false } );
+            last_checkpoint = total_out;
+        }
+
+        if ( stream.avail_out == 0 ) {
+            if ( ! output_function( output.constData(), outputSize, total_in ) ) {
+                ok = false;
+                break;
+            }
+            previous_output = output.right( windowSize );
+            stream.next_out = reinterpret_cast<Bytef*>( output.data() );
+            stream.avail_out = outputSize;
+        }
+    }
+
+    // What is left (even from an unfinished member)
+    const int filled = outputSize - stream.avail_out;
+    if ( ok && filled > 0 )
+        ok = output_function( output.constData(), filled, total_in );
+
+    inflateEnd( &stream );
+
+    return ok;
+}
+
+bool CompressedFile::readGzip( const Checkpoint& checkpoint, qint64 first_byte,
+        QByteArray* data ) const
+{
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    z_stream stream;
+    memset( &stream, 0, sizeof( stream ) );
+
+    QByteArray input( inputSize, Qt::Uninitialized );
+    QByteArray skipped( outputSize, Qt::Uninitialized );
+    const qint64 end_byte = first_byte + data->size();
+
+    Checkpoint from = checkpoint;
+    qint64 position = from.out;
+    bool ok = true;
+    bool restart = true;
+    while ( ok && restart ) {
+        restart = false;
+
+        inflateEnd( &stream );
+        if ( from.independent ) {
+            ok = ( inflateInit2( &stream, 47 ) == Z_OK ) && file.seek( from.in );
+        }
+        else {
+            // Raw deflate, resumed in the middle of the stream
+            ok = ( inflateInit2( &stream, -15 ) == Z_OK )
+                && file.seek( from.in - ( from.bits ? 1 : 0 ) );
+            if ( ok && from.bits ) {
+                char c;
+                ok = file.getChar( &c );
+                inflatePrime( &stream, from.bits,
+                        static_cast<uchar>( c ) >> ( 8 - from.bits ) );
+            }
+            const QByteArray window = qUncompress( from.window );
+            inflateSetDictionary( &stream,
+                    reinterpret_cast<const Bytef*>( window.constData() ), window.size() );
+        }
+        stream.avail_in = 0;
+
+        while ( ok && position < end_byte ) {
+            if ( stream.avail_in == 0 ) {
+                const qint64 nb_read = file.read( input.data(), inputSize );
+                if ( nb_read <= 0 ) {
+                    ok = false;
+                    break;
+                }
+                stream.next_in = reinterpret_cast<Bytef*>( input.data() );
+                stream.avail_in = nb_read;
+            }
+
+            // What precedes first_byte is decompressed in skipped
+            if ( position < first_byte ) {
+                stream.next_out = reinterpret_cast<Bytef*>( skipped.data() );
+                stream.avail_out = qMin<qint64>( outputSize, first_byte - position );
+            }
+            else {
+                stream.next_out = reinterpret_cast<Bytef*>(
+                        data->data() + ( position - first_byte ) );
+                stream.avail_out = end_byte - position;
+            }
+
+            const uInt avail_out = stream.avail_out;
+            const int ret = inflate( &stream, Z_NO_FLUSH );
+            position += avail_out - stream.avail_out;
+
+            if ( ret == Z_STREAM_END ) {
+                if ( from.independent ) {
+                    inflateReset( &stream );
+                }
+                else {
+                    // The next member starts after the trailer
+                    // of this one, which is not decoded in raw mode
+                    ok = findIndependentCheckpoint( position, &from );
+                    restart = true;
+                    break;
+                }
+            }
+            else if ( ret != Z_OK && ret != Z_BUF_ERROR ) {
+                ok = false;
+            }
+        }
+    }
+
+    inflateEnd( &stream );
+
+    return ok;
+}
+#else
+bool CompressedFile::indexGzip( const OutputFunction& )
+{
+    return false;
+}
+
+bool CompressedFile::readGzip( const Checkpoint&, qint64, QByteArray* ) const
+{
+    return false;
+}
+#endif
+
+#ifdef GLOGG_SUPPORTS_ZSTD
+bool CompressedFile::indexZstd(
+        const OutputFunction& output_function )
+{
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    ZSTD_initDStream( stream );
+
+    QByteArray input( ZSTD_DStreamInSize(), Qt::Uninitialized );
+    QByteArray output( outputSize, Qt::Uninitialized );
+    ZSTD_inBuffer in = { input.constData(), 0, 0 };
+    ZSTD_outBuffer out = { output.data(), static_cast<size_t>( outputSize ), 0 };
+
+    qint64 total_in = 0;
+    qint64 total_out = 0;
+    qint64 last_checkpoint = 0;
+    bool end_of_file = false;
+    bool ok = true;
+
+    for (;;) {
+        if ( in.pos == in.size && ! end_of_file ) {
+            const qint64 nb_read = file.read( input.data(), input.size() );
+            in.pos = 0;
+            in.size = qMax<qint64>( 0, nb_read );
+            end_of_file = ( nb_read <= 0 );
+        }
+
+        const size_t in_before = in.pos;
+        const size_t out_before = out.pos;
+        const size_t ret = ZSTD_decompressStream( stream, &out, &in );
+        if ( ZSTD_isError( ret ) ) {
+            LOG(logWARNING) << "Corrupted zstd file " << fileName_.toStdString()
+                << ": " << ZSTD_getErrorName( ret );
+            ok = false;
+            break;
+        }
+        total_in += in.pos - in_before;
+        total_out += out.pos - out_before;
+
+        // At the end of a frame, the next one is independent
+        if ( ret == 0 ) {
+            if ( total_out - last_checkpoint >= checkpointInterval ) {
+                addCheckpoint( { total_in, total_out, 0, QByteArray(), true } );
+                last_checkpoint = total_out;
+            }
+        }
+
+        if ( out.pos == out.size ) {
+            if ( ! output_function( output.constData(), out.pos, total_in ) ) {
+                ok = false;
+                break;
+            }
+            out.pos = 0;
+        }
+        else if ( end_of_file && out.pos == out_before ) {
+            // Everything has been flushed
+            break;
+        }
+    }
+
+    if ( ok && out.pos > 0 )
+        ok = output_function( output.constData(), out.pos, total_in );
+
+    ZSTD_freeDStream( stream );
+
+    return ok;
+}
+
+bool CompressedFile::readZstd( const Checkpoint& checkpoint, qint64 first_byte,
+        QByteArray* data ) const
+{
+    // Go on with the closest kept decompression between the checkpoint
+    // and first_byte, or start a new one at the checkpoint
+    auto closest = streams_.end();
+    for ( auto kept = streams_.begin(); kept != streams_.end(); ++kept ) {
+        if ( (*kept)->out >= checkpoint.out && (*kept)->out <= first_byte
+                && ( closest == streams_.end() || (*kept)->out > (*closest)->out ) )
+            closest = kept;
+    }
+
+    std::unique_ptr<ZstdStream> stream;
+    if ( closest != streams_.end() ) {
+        stream = std::move( *closest );
+        streams_.erase( closest );
+    }
+    else {
+        stream.reset( new ZstdStream );
+        stream->in = checkpoint.in;
+        stream->out = checkpoint.out;
+    }
+
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::ReadOnly ) || ! file.seek( stream->in ) )
+        return false;
+
+    QByteArray input( ZSTD_DStreamInSize(), Qt::Uninitialized );
+    QByteArray skipped( outputSize, Qt::Uninitialized );
+    ZSTD_inBuffer in = { input.constData(), 0, 0 };
+    const qint64 end_byte = first_byte + data->size();
+
+    qint64 position = stream->out;
+    bool end_of_file = false;
+    bool ok = true;
+    while ( ok && position < end_byte ) {
+        if ( in.pos == in.size && ! end_of_file ) {
+            const qint64 nb_read = file.read( input.data(), input.size() );
+            in.pos = 0;
+            in.size = qMax<qint64>( 0, nb_read );
+            end_of_file = ( nb_read <= 0 );
+        }
+
+        // What precedes first_byte is decompressed in skipped
+        ZSTD_outBuffer out;
+        if ( position < first_byte )
+            out = { skipped.data(),
+                static_cast<size_t>( qMin<qint64>( outputSize, first_byte - position ) ), 0 };
+        else
+            out = { data->data() + ( position - first_byte ),
+                static_cast<size_t>( end_byte - position ), 0 };
+
+        const size_t in_before = in.pos;
+        const size_t ret = ZSTD_decompressStream( stream->stream, &out, &in );
+        stream->in += in.pos - in_before;
+        position += out.pos;
+        ok = ! ZSTD_isError( ret ) && ! ( end_of_file && out.pos == 0 );
+    }
+
+    // Kept for the next read, which is likely to follow this one
+    if ( ok ) {
+        stream->out = position;
+        streams_.push_back( std::move( stream ) );
+        if ( streams_.size() > nbKeptStreams )
+            streams_.erase( streams_.begin() );
+    }
+
+    return ok;
+}
+#else
+bool CompressedFile::indexZstd( const OutputFunction& )
+{
+    return false;
+}
+
+bool CompressedFile::readZstd( const Checkpoint&, qint64, QByteArray* ) const
+{
+    return false;
+}
+#endif
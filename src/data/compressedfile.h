@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPRESSEDFILE_H
+#define COMPRESSEDFILE_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+
+// Random access to the decompressed content of a gzip or zstd file.
+// The file is decompressed once from the beginning by index(), which
+// records checkpoints from which the decompression can be restarted
+// every few MiB, read() then only has to decompress from the checkpoint
+// preceding what is asked for.
+// gzip checkpoints are taken at the end of deflate blocks, with the
+// 32 KiB of data preceding them (as in zlib's zran example), zstd ones
+// at the beginning of frames. A zstd frame cannot be decompressed from
+// its middle, so read() keeps its last decompressions, which the next
+// reads go on with. Reading backwards in a long frame (e.g. a file
+// compressed by the zstd command, a single frame) decompresses it again
+// from its beginning.
+// index() and read() can be called from different threads.
+class CompressedFile
+{
+  public:
+    enum class Format { None, Gzip, Zstd };
+
+    // Returns the format of the passed file if it is compressed
+    // and we can decompress it, Format::None otherwise.
+    static Format detectFormat( const QString& fileName );
+    // Returns a CompressedFile for the passed file,
+    // or null if it is not compressed (in a format we can decompress).
+    static std::shared_ptr<CompressedFile> open( const QString& fileName );
+
+    CompressedFile( const QString& fileName, Format format );
+    ~CompressedFile();
+
+    CompressedFile( const CompressedFile& ) = delete;
+    CompressedFile& operator=( const CompressedFile& ) = delete;
+
+    Format format() const { return format_; }
+
+    // Decompress the whole file, passing the data to the consumer as
+    // it is produced, along with the percentage of the file done.
+    // The consumer returns false to interrupt the decompression.
+    // Returns false if interrupted or if the file is corrupted (in
+    // which case what has been passed to the consumer is still valid).
+    bool index( const std::function<bool( const char*, int, int )>& consumer );
+
+    // Size of the compressed file when it was last indexed
+    qint64 compressedSize() const;
+    // Size of the data decompressed by the last index()
+    qint64 size() const;
+
+    // Read the decompressed bytes [first_byte, end_byte) in data.
+    // Returns false if they are not available.
+    bool read( qint64 first_byte, qint64 end_byte, QByteArray* data ) const;
+
+    // Forget what has been decompressed by the last read(), and the
+    // decompressions it has kept
+    void dropCache();
+    // Approximate memory used by the checkpoints, cache and kept
+    // decompressions (in bytes)
+    qint64 memoryUsage() const;
+
+    // Distance between two checkpoints (in decompressed bytes)
+    static const qint64 checkpointInterval;
+
+  private:
+    struct Checkpoint {
+        // Position in the compressed and decompressed data
+        qint64 in;
+        qint64 out;
+        // For gzip, the number of bits of the byte before 'in' that
+        // belong to the next block, and the (compressed) data preceding
+        // the checkpoint, needed to decompress what follows.
+        int bits;
+        QByteArray window;
+        // Beginning of a gzip member or zstd frame, nothing before
+        // is needed
+        bool independent;
+    };
+
+    // A zstd decompression, which can go on from where it has stopped
+    struct ZstdStream;
+
+    void addCheckpoint( Checkpoint checkpoint );
+    // Returns the last checkpoint before position
+    Checkpoint findCheckpoint( qint64 position ) const;
+    // Returns the independent checkpoint at position (if any)
+    bool findIndependentCheckpoint( qint64 position, Checkpoint* checkpoint ) const;
+
+    // Called with the decompressed data and the position reached in
+    // the compressed file
+    typedef std::function<bool( const char*, int, qint64 )> OutputFunction;
+
+    bool indexGzip( const OutputFunction& output_function );
+    bool indexZstd( const OutputFunction& output_function );
+    // Decompress from checkpoint, filling data with what starts at
+    // first_byte (what precedes it is discarded)
+    bool readGzip( const Checkpoint& checkpoint, qint64 first_byte,
+            QByteArray* data ) const;
+    // (from the closest kept decompression after the checkpoint)
+    bool readZstd( const Checkpoint& checkpoint, qint64 first_byte,
+            QByteArray* data ) const;
+
+    const QString fileName_;
+    const Format format_;
+
+    // Protects the checkpoints and sizes
+    mutable QMutex mutex_;
+    std::vector<Checkpoint> checkpoints_;
+    qint64 compressedSize_;
+    qint64 size_;
+
+    // What has been decompressed by the last read() (with a bit more
+    // after it, as the lines are usually read in order)
+    mutable QMutex cacheMutex_;
+    mutable qint64 cacheBeginning_;
+    mutable QByteArray cache_;
+    // The last zstd decompressions of read(), oldest first
+    // (protected by cacheMutex_ too)
+    mutable std::vector<std::unique_ptr<ZstdStream>> streams_;
+};
+
+#endif
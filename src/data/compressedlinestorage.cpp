@@ -17,6 +17,7 @@
  * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <QtEndian>
@@ -197,8 +198,11 @@ void CompressedLinePositionStorage::move_from(
     current_pos_     = orig.current_pos_;
     block_pointer_   = orig.block_pointer_;
     previous_block_pointer_ = orig.previous_block_pointer_;
+    finished_blocks_size_ = orig.finished_blocks_size_;
+    last_block_size_ = orig.last_block_size_;
 
     orig.nb_lines_   = 0;
+    orig.finished_blocks_size_ = 0;
 }
 
 // Move constructor
@@ -256,6 +260,9 @@ void CompressedLinePositionStorage::append( uint64_t pos )
         if ( first_long_line_ == UINT32_MAX ) {
             // First "big" end of line, we will start a new (64) block
             first_long_line_ = nb_lines_;
+            // (the current 32 block is left as it is)
+            if ( block_pointer_ )
+                finished_blocks_size_ += 4 + BLOCK_SIZE * 6;
             block_pointer_ = nullptr;
         }
     }
@@ -306,6 +313,9 @@ void CompressedLinePositionStorage::append( uint64_t pos )
             if ( new_location )
                 block32_index_[block_index] = static_cast<char*>( new_location );
 
+            last_block_size_ = new_location ? new_size : 4 + BLOCK_SIZE * 6;
+            finished_blocks_size_ += last_block_size_;
+
             block_pointer_ = nullptr;
             previous_block_pointer_ = static_cast<char*>( new_location ) + ( previous_block_pointer_ - block );
         }
@@ -325,6 +335,9 @@ void CompressedLinePositionStorage::append( uint64_t pos )
             if ( new_location )
                 block64_index_[block_index] = static_cast<char*>( new_location );
 
+            last_block_size_ = new_location ? new_size : 8 + BLOCK_SIZE * 10;
+            finished_blocks_size_ += last_block_size_;
+
             block_pointer_ = nullptr;
             previous_block_pointer_ = static_cast<char*>( new_location ) + ( previous_block_pointer_ - block );
         }
@@ -337,50 +350,91 @@ uint64_t CompressedLinePositionStorage::at( uint32_t index ) const
     char* ptr;
     uint64_t position;
 
-    Cache* last_read = last_read_.getPtr();
-
     if ( index < first_long_line_ ) {
-        if ( ( index == last_read->index + 1 ) && ( index % BLOCK_SIZE != 0 ) ) {
-            position = last_read->position;
-            ptr      = last_read->ptr;
+        char* block = block32_index_[ index / BLOCK_SIZE ];
+        position = block32_initial_pos( block, &ptr );
 
+        for ( uint32_t i = 0; i < index % BLOCK_SIZE; i++ ) {
+            // Go through all the lines in the block till the one we want
             position = block32_next_pos( &ptr, position );
         }
-        else {
-            char* block = block32_index_[ index / BLOCK_SIZE ];
-            position = block32_initial_pos( block, &ptr );
-
-            for ( uint32_t i = 0; i < index % BLOCK_SIZE; i++ ) {
-                // Go through all the lines in the block till the one we want
-                position = block32_next_pos( &ptr, position );
-            }
-        }
     }
     else {
         const uint32_t index_in_64 = index - first_long_line_;
-        if ( ( index == last_read->index + 1 ) && ( index_in_64 % BLOCK_SIZE != 0 ) ) {
-            position = last_read->position;
-            ptr      = last_read->ptr;
+        char* block = block64_index_[ index_in_64 / BLOCK_SIZE ];
+        position = block64_initial_pos( block, &ptr );
 
+        for ( uint32_t i = 0; i < index_in_64 % BLOCK_SIZE; i++ ) {
+            // Go through all the lines in the block till the one we want
             position = block64_next_pos( &ptr, position );
         }
-        else {
-            char* block = block64_index_[ index_in_64 / BLOCK_SIZE ];
-            position = block64_initial_pos( block, &ptr );
+    }
+
+    return position;
+}
+
+CompressedLinePositionStorage::Cursor::Cursor(
+        const CompressedLinePositionStorage& storage )
+    : storage_( storage ), last_used_( 0 )
+{
+}
 
-            for ( uint32_t i = 0; i < index_in_64 % BLOCK_SIZE; i++ ) {
-                // Go through all the lines in the block till the one we want
-                position = block64_next_pos( &ptr, position );
-            }
+uint64_t CompressedLinePositionStorage::Cursor::at( uint32_t index )
+{
+    for ( int i = 0; i < 2; i++ ) {
+        const DecodedBlock& block = blocks_[i];
+        if ( index >= block.first_line && index - block.first_line < block.positions.size() ) {
+            last_used_ = i;
+            return block.positions[ index - block.first_line ];
         }
     }
 
-    // Populate our cache ready for next consecutive read
-    last_read->index    = index;
-    last_read->position = position;
-    last_read->ptr      = ptr;
+    // Decode all the lines we have of the block, in place of the
+    // least recently used one (the following lines will be decoded
+    // when asked for, if they are added later)
+    last_used_ = 1 - last_used_;
+    DecodedBlock& block = blocks_[last_used_];
+    block.positions.clear();
+    block.positions.reserve( BLOCK_SIZE );
 
-    return position;
+    char* ptr;
+    uint64_t position;
+    if ( index < storage_.first_long_line_ ) {
+        block.first_line = index - index % BLOCK_SIZE;
+        const uint32_t end = std::min( { block.first_line + BLOCK_SIZE,
+                storage_.first_long_line_, storage_.nb_lines_ } );
+
+        position = block32_initial_pos(
+                storage_.block32_index_[ index / BLOCK_SIZE ], &ptr );
+        block.positions.push_back( position );
+        for ( uint32_t i = block.first_line + 1; i < end; i++ ) {
+            position = block32_next_pos( &ptr, position );
+            block.positions.push_back( position );
+        }
+    }
+    else {
+        const uint32_t index_in_64 = index - storage_.first_long_line_;
+        block.first_line = index - index_in_64 % BLOCK_SIZE;
+        const uint32_t end = std::min( block.first_line + BLOCK_SIZE, storage_.nb_lines_ );
+
+        position = block64_initial_pos(
+                storage_.block64_index_[ index_in_64 / BLOCK_SIZE ], &ptr );
+        block.positions.push_back( position );
+        for ( uint32_t i = block.first_line + 1; i < end; i++ ) {
+            position = block64_next_pos( &ptr, position );
+            block.positions.push_back( position );
+        }
+    }
+
+    return block.positions[ index - block.first_line ];
+}
+
+void CompressedLinePositionStorage::Cursor::reset()
+{
+    for ( auto& block : blocks_ ) {
+        block.first_line = UINT32_MAX;
+        block.positions.clear();
+    }
 }
 
 void CompressedLinePositionStorage::append_list(
@@ -399,6 +453,10 @@ void CompressedLinePositionStorage::pop_back()
     if ( previous_block_pointer_ ) {
         // The last append was a normal entry in an existing block,
         // so we can just revert the pointer
+        if ( ! block_pointer_ ) {
+            // (the block had been finished by the last append)
+            finished_blocks_size_ -= last_block_size_;
+        }
         block_pointer_ = previous_block_pointer_;
         previous_block_pointer_ = nullptr;
     }
@@ -429,3 +487,16 @@ void CompressedLinePositionStorage::pop_back()
     --nb_lines_;
     current_pos_ = at( nb_lines_ - 1 );
 }
+
+size_t CompressedLinePositionStorage::memoryUsage() const
+{
+    size_t usage = finished_blocks_size_
+        + ( block32_index_.capacity() + block64_index_.capacity() ) * sizeof( char* );
+
+    // The current block has the maximum size until it is finished
+    if ( block_pointer_ )
+        usage += ( first_long_line_ == UINT32_MAX ) ?
+            4 + BLOCK_SIZE * 6 : 8 + BLOCK_SIZE * 10;
+
+    return usage;
+}
@@ -20,8 +20,6 @@
 #include <vector>
 #include <cstdint>
 
-#include "threadprivatestore.h"
-
 // This class is a compressed storage backend for LinePositionArray
 // It emulates the interface of a vector, but take advantage of the nature
 // of the stored data (increasing end of line addresses) to apply some
@@ -88,7 +86,8 @@ class CompressedLinePositionStorage
     CompressedLinePositionStorage()
     { nb_lines_ = 0; first_long_line_ = UINT32_MAX;
       current_pos_ = 0; block_pointer_ = nullptr;
-      previous_block_pointer_ = nullptr; }
+      previous_block_pointer_ = nullptr;
+      finished_blocks_size_ = 0; last_block_size_ = 0; }
     // Copy constructor would be slow, delete!
     CompressedLinePositionStorage( const CompressedLinePositionStorage& orig ) = delete;
 
@@ -107,7 +106,8 @@ class CompressedLinePositionStorage
     // Size of the array
     uint32_t size() const
     { return nb_lines_; }
-    // Element at index
+    // Element at index (decoding the lines before it in its block,
+    // use a Cursor to read several lines)
     uint64_t at( uint32_t i ) const;
 
     // Add one list to the other
@@ -116,6 +116,37 @@ class CompressedLinePositionStorage
     // Pop the last element of the storage
     void pop_back();
 
+    // Memory allocated for the storage (in bytes)
+    size_t memoryUsage() const;
+
+    // Reads the storage for one thread, the blocks of the last lines read
+    // are kept decoded so the lines around them are read in constant time.
+    // Any number of cursors can read the same storage at once.
+    // It must be reset if the storage is modified other than by append().
+    class Cursor
+    {
+      public:
+        explicit Cursor( const CompressedLinePositionStorage& storage );
+
+        // Element at index
+        uint64_t at( uint32_t i );
+        // Forget the decoded lines
+        void reset();
+
+      private:
+        struct DecodedBlock {
+            // Index of the first line decoded (UINT32_MAX if none)
+            uint32_t first_line = UINT32_MAX;
+            std::vector<uint64_t> positions;
+        };
+
+        const CompressedLinePositionStorage& storage_;
+        // The two last blocks used (e.g. the beginning and the
+        // end of a page of lines)
+        DecodedBlock blocks_[2];
+        int last_used_;
+    };
+
   private:
     // Utility for move ctor/assign
     void move_from( CompressedLinePositionStorage&& orig );
@@ -148,21 +179,11 @@ class CompressedLinePositionStorage
     // that has just been created.
     char* previous_block_pointer_;
 
-    // Cache the last position read
-    // This is to speed up consecutive reads (whole page)
-    struct Cache {
-        Cache() {
-            index = UINT32_MAX - 1U;
-            position = 0;
-            ptr = nullptr;
-        }
-
-        uint32_t index;
-        uint64_t position;
-        char* ptr;
-    };
-    mutable ThreadPrivateStore<Cache,2> last_read_; // = { UINT32_MAX - 1U, 0, nullptr };
-    // mutable Cache last_read;
+    // Memory allocated for the blocks that are not current
+    // (finished blocks are shrunk to what they use)
+    size_t finished_blocks_size_;
+    // Size of the last finished block, in case it is reopened by pop_back
+    size_t last_block_size_;
 };
 
 #endif
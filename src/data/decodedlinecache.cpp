@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/decodedlinecache.h"
+
+const int DecodedLineCache::blockSize;
+
+DecodedLineCache::DecodedLineCache( qint64 maxMemory )
+    : mutex_(), maxMemory_( maxMemory ), blocks_(), generation_( 0 ),
+    hits_( 0 ), misses_( 0 ), memoryUsage_( 0 )
+{
+}
+
+bool DecodedLineCache::get( qint64 block, QStringList* lines )
+{
+    QMutexLocker locker( &mutex_ );
+
+    for ( auto i = blocks_.begin(); i != blocks_.end(); ++i ) {
+        if ( i->first == block ) {
+            blocks_.splice( blocks_.begin(), blocks_, i );
+            *lines = blocks_.front().second;
+            ++hits_;
+            return true;
+        }
+    }
+
+    ++misses_;
+    return false;
+}
+
+void DecodedLineCache::put( uint64_t generation, qint64 block,
+        const QStringList& lines )
+{
+    // (computed before locking, it walks all the lines)
+    const qint64 usage = blockMemoryUsage( lines );
+
+    QMutexLocker locker( &mutex_ );
+
+    if ( generation != generation_ || usage > maxMemory_ / 4 )
+        return;
+
+    // Another thread might have read it at the same time
+    for ( const Block& cached_block : blocks_ ) {
+        if ( cached_block.first == block )
+            return;
+    }
+
+    while ( ! blocks_.empty() && memoryUsage_ + usage > maxMemory_ ) {
+        memoryUsage_ -= blockMemoryUsage( blocks_.back().second );
+        blocks_.pop_back();
+    }
+    blocks_.emplace_front( block, lines );
+    memoryUsage_ += usage;
+}
+
+uint64_t DecodedLineCache::generation() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return generation_;
+}
+
+void DecodedLineCache::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    blocks_.clear();
+    memoryUsage_ = 0;
+    ++generation_;
+}
+
+qint64 DecodedLineCache::hits() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return hits_;
+}
+
+qint64 DecodedLineCache::misses() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return misses_;
+}
+
+qint64 DecodedLineCache::memoryUsage() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return memoryUsage_;
+}
+
+qint64 DecodedLineCache::blockMemoryUsage( const QStringList& lines )
+{
+    qint64 usage = sizeof( Block );
+    for ( const QString& line : lines )
+        usage += sizeof( QString ) + line.capacity() * sizeof( QChar );
+
+    return usage;
+}
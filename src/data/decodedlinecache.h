@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECODEDLINECACHE_H
+#define DECODEDLINECACHE_H
+
+#include <cstdint>
+#include <list>
+#include <utility>
+
+#include <QMutex>
+#include <QStringList>
+
+// A cache of the lines of a file as shown by the views (decoded and
+// with tabs expanded), by blocks of consecutive lines, so the views
+// of a file and the functions reading the lines around the current
+// one do not read and decode them again.
+// The least recently used blocks are dropped first, to keep the memory
+// used under a maximum. The blocks taking more than a quarter of it
+// (of very long lines) are not cached.
+// Thread-safe.
+class DecodedLineCache
+{
+  public:
+    // Number of lines of the blocks
+    static const int blockSize = 64;
+
+    // Keep blocks taking up to maxMemory bytes
+    explicit DecodedLineCache( qint64 maxMemory );
+
+    DecodedLineCache( const DecodedLineCache& ) = delete;
+    DecodedLineCache& operator=( const DecodedLineCache& ) = delete;
+
+    // Returns true, and the lines of the passed block, if it is cached
+    bool get( qint64 block, QStringList* lines );
+    // Cache the lines of the passed block (blockSize of them), unless
+    // the cache has been cleared since the passed generation was read
+    // (they might have been read with the old encoding or index).
+    void put( uint64_t generation, qint64 block, const QStringList& lines );
+
+    // Must be read before the lines to put are read
+    uint64_t generation() const;
+    // Remove all the blocks, when the lines are changed
+    void clear();
+
+    // Number of calls to get that found or did not find the block
+    qint64 hits() const;
+    qint64 misses() const;
+    // Approximate memory used (in bytes)
+    qint64 memoryUsage() const;
+
+  private:
+    typedef std::pair<qint64, QStringList> Block;
+
+    static qint64 blockMemoryUsage( const QStringList& lines );
+
+    mutable QMutex mutex_;
+    const qint64 maxMemory_;
+    // Most recently used first
+    std::list<Block> blocks_;
+    uint64_t generation_;
+    qint64 hits_;
+    qint64 misses_;
+    qint64 memoryUsage_;
+};
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/eliasfanolinestorage.h"
+
+#include <cassert>
+
+#include <QtAlgorithms>
+
+namespace {
+    // The number of low order bits is stored in the high order bits of
+    // the first word, with the initial position
+    const int lowBitsShift = 58;
+    const uint64_t initialPositionMask = ( 1ULL << lowBitsShift ) - 1;
+
+    // Number of 64 bits words needed for the passed number of bits
+    size_t nbWords( uint64_t nb_bits )
+    {
+        return ( nb_bits + 63 ) / 64;
+    }
+
+    // Number of words of a block
+    size_t blockWords( int block_size, int low_bits, uint64_t range )
+    {
+        return 1 + nbWords( static_cast<uint64_t>( block_size ) * low_bits
+                + block_size + ( range >> low_bits ) );
+    }
+
+    // Read the nb_bits bits (less than 64) at bit_index in words
+    uint64_t readBits( const uint64_t* words, uint64_t bit_index, int nb_bits )
+    {
+        const uint64_t word = bit_index / 64;
+        const int shift = bit_index % 64;
+
+        uint64_t value = words[word] >> shift;
+        if ( shift + nb_bits > 64 )
+            value |= words[word + 1] << ( 64 - shift );
+
+        return value & ( ( 1ULL << nb_bits ) - 1 );
+    }
+
+    // Write the nb_bits bits (less than 64) of value at bit_index in
+    // words (which must be 0 there)
+    void writeBits( uint64_t* words, uint64_t bit_index, int nb_bits, uint64_t value )
+    {
+        const uint64_t word = bit_index / 64;
+        const int shift = bit_index % 64;
+
+        words[word] |= value << shift;
+        if ( shift + nb_bits > 64 )
+            words[word + 1] |= value >> ( 64 - shift );
+    }
+
+    // Index of the (rank+1)-th bit set in word
+    int selectInWord( uint64_t word, int rank )
+    {
+        int index = 0;
+
+        // Halve the word to look at while it is worth it
+        for ( int width = 32; width >= 8; width /= 2 ) {
+            const int nb_set = qPopulationCount( word & ( ( 1ULL << width ) - 1 ) );
+            if ( rank >= nb_set ) {
+                rank   -= nb_set;
+                word  >>= width;
+                index  += width;
+            }
+        }
+
+        for ( ; rank > 0; --rank )
+            word &= word - 1;
+
+        return index + qCountTrailingZeroBits( word );
+    }
+
+    // Index (from bit_index) of the (rank+1)-th bit set after bit_index
+    // in the array of words (which must have that many)
+    uint64_t select( const uint64_t* words, uint64_t bit_index, int rank )
+    {
+        const uint64_t* word = words + bit_index / 64;
+        uint64_t index = ( bit_index / 64 ) * 64;
+        // (ignoring the bits before bit_index in the first word)
+        uint64_t bits = *word & ( ~0ULL << ( bit_index % 64 ) );
+
+        for ( ;; ) {
+            const int nb_set = qPopulationCount( bits );
+            if ( rank < nb_set )
+                return index + selectInWord( bits, rank ) - bit_index;
+
+            rank  -= nb_set;
+            index += 64;
+            bits   = *(++word);
+        }
+    }
+}
+
+EliasFanoLinePositionStorage::EliasFanoLinePositionStorage()
+    : blocks_(), blocksWords_( 0 ), current_()
+{
+}
+
+EliasFanoLinePositionStorage::EliasFanoLinePositionStorage(
+        EliasFanoLinePositionStorage&& orig )
+    : blocks_( std::move( orig.blocks_ ) ), blocksWords_( orig.blocksWords_ ),
+    current_( std::move( orig.current_ ) )
+{
+    orig.blocks_.clear();
+    orig.blocksWords_ = 0;
+    orig.current_.clear();
+}
+
+EliasFanoLinePositionStorage& EliasFanoLinePositionStorage::operator=(
+        EliasFanoLinePositionStorage&& orig )
+{
+    blocks_      = std::move( orig.blocks_ );
+    blocksWords_ = orig.blocksWords_;
+    current_     = std::move( orig.current_ );
+
+    orig.blocks_.clear();
+    orig.blocksWords_ = 0;
+    orig.current_.clear();
+
+    return *this;
+}
+
+void EliasFanoLinePositionStorage::append( uint64_t pos )
+{
+    // Lines must be stored in order
+    assert( current_.empty() || pos > current_.back() || pos == 0 );
+
+    if ( current_.empty() )
+        current_.reserve( blockSize );
+
+    current_.push_back( pos );
+
+    if ( current_.size() == static_cast<size_t>( blockSize ) )
+        finishBlock();
+}
+
+void EliasFanoLinePositionStorage::append_list(
+        const std::vector<uint64_t>& positions )
+{
+    for ( const auto position : positions )
+        append( position );
+}
+
+uint64_t EliasFanoLinePositionStorage::at( uint32_t index ) const
+{
+    const uint32_t block_index = index / blockSize;
+    const int rank = index % blockSize;
+
+    if ( block_index == blocks_.size() )
+        return current_[rank];
+
+    const uint64_t* block = blocks_[block_index].get();
+    const uint64_t base = block[0] & initialPositionMask;
+    const int low_bits = block[0] >> lowBitsShift;
+
+    const uint64_t high = select( block + 1, blockSize * low_bits, rank ) - rank;
+    const uint64_t low = ( low_bits > 0 ) ?
+        readBits( block + 1, rank * low_bits, low_bits ) : 0;
+
+    return base + ( ( high << low_bits ) | low );
+}
+
+void EliasFanoLinePositionStorage::pop_back()
+{
+    if ( current_.empty() )
+        reopenBlock();
+
+    current_.pop_back();
+}
+
+size_t EliasFanoLinePositionStorage::memoryUsage() const
+{
+    return blocksWords_ * sizeof( uint64_t )
+        + blocks_.capacity() * sizeof( blocks_[0] )
+        + current_.capacity() * sizeof( uint64_t );
+}
+
+void EliasFanoLinePositionStorage::finishBlock()
+{
+    const uint64_t base = current_.front();
+    const uint64_t range = current_.back() - base;
+
+    // As many low order bits as possible while keeping
+    // range >> low_bits >= blockSize
+    int low_bits = 0;
+    while ( ( range >> ( low_bits + 1 ) ) >= blockSize )
+        ++low_bits;
+
+    const size_t nb_words = blockWords( blockSize, low_bits, range );
+
+    assert( base <= initialPositionMask );
+    std::unique_ptr<uint64_t[]> block( new uint64_t[nb_words]() );
+    block[0] = base | ( static_cast<uint64_t>( low_bits ) << lowBitsShift );
+
+    const uint64_t high_bits = blockSize * low_bits;
+    for ( int i = 0; i < blockSize; ++i ) {
+        const uint64_t x = current_[i] - base;
+        if ( low_bits > 0 )
+            writeBits( block.get() + 1, i * low_bits, low_bits,
+                    x & ( ( 1ULL << low_bits ) - 1 ) );
+        writeBits( block.get() + 1, high_bits + ( x >> low_bits ) + i, 1, 1 );
+    }
+
+    blocks_.push_back( std::move( block ) );
+    blocksWords_ += nb_words;
+    current_.clear();
+}
+
+void EliasFanoLinePositionStorage::reopenBlock()
+{
+    assert( ! blocks_.empty() );
+
+    const uint32_t first_line = ( blocks_.size() - 1 ) * blockSize;
+    current_.reserve( blockSize );
+    for ( int i = 0; i < blockSize; ++i )
+        current_.push_back( at( first_line + i ) );
+
+    const int low_bits = blocks_.back()[0] >> lowBitsShift;
+    blocksWords_ -= blockWords( blockSize, low_bits,
+            current_.back() - current_.front() );
+
+    blocks_.pop_back();
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ELIASFANOLINESTORAGE_H
+#define ELIASFANOLINESTORAGE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// This class is a storage backend for LinePosition, like
+// CompressedLinePositionStorage it emulates the interface of a vector.
+// It uses about as much memory, but any element is found in constant
+// time, without decoding the ones preceding it.
+
+/* The positions are divided in blocks of blockSize lines, the positions
+ * of the last (incomplete) block are stored as they are, the complete
+ * blocks are coded using the Elias-Fano representation of their positions
+ * relative to the first one (x, from 0 to the range of the block):
+ * - the 'l' low order bits of each x are stored packed in an array,
+ *   'l' being chosen so that range >> l is close to blockSize
+ * - the high order bits (x >> l) of the i-th x are coded as a 1 at index
+ *   i + ( x >> l ) in a bit array (so the high order bits of the i-th x are
+ *   the number of 0 before the (i+1)-th 1)
+ * As range >> l is between blockSize and twice blockSize, it takes l + 2
+ * or 3 bits per line (about a byte for 60 bytes lines, plus one bit each
+ * time the average length doubles).
+ *
+ * Block (64 bits words)
+ * 00 - Absolute position of the first line (58 bits) and l (6 bits)
+ * 01 - Low order bits ( blockSize * l bits )
+ *      High order bits ( blockSize + ( range >> l ) bits )
+ */
+
+class EliasFanoLinePositionStorage
+{
+  public:
+    EliasFanoLinePositionStorage();
+    // Copy constructor would be slow, delete!
+    EliasFanoLinePositionStorage( const EliasFanoLinePositionStorage& orig ) = delete;
+
+    EliasFanoLinePositionStorage( EliasFanoLinePositionStorage&& orig );
+    EliasFanoLinePositionStorage& operator=( EliasFanoLinePositionStorage&& orig );
+
+    // Append the passed end-of-line to the storage
+    void append( uint64_t pos );
+    void push_back( uint64_t pos )
+    { append( pos ); }
+    // Size of the array
+    uint32_t size() const
+    { return blocks_.size() * blockSize + current_.size(); }
+    // Element at index
+    uint64_t at( uint32_t i ) const;
+
+    // Add one list to the other
+    void append_list( const std::vector<uint64_t>& positions );
+
+    // Pop the last element of the storage
+    void pop_back();
+
+    // Memory allocated for the storage (in bytes)
+    size_t memoryUsage() const;
+
+  private:
+    static const int blockSize = 256;
+
+    // Code the current block and start a new one
+    void finishBlock();
+    // Decode the last complete block as the current one
+    void reopenBlock();
+
+    // The complete blocks
+    std::vector<std::unique_ptr<uint64_t[]>> blocks_;
+    // Total number of words of the complete blocks
+    size_t blocksWords_;
+    // Positions of the last (incomplete) block
+    std::vector<uint64_t> current_;
+};
+
+#endif
@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// An entry of the cache is a file made of a fixed size header, the
+// name of the file it indexes, then the end of line positions, each one
+// coded as its distance to the previous one in a little-endian base
+// 128 varint.
+
+#include "data/indexcache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+#include "log.h"
+
+#include "data/logdataworkerthread.h"
+
+const qint64 IndexCache::minFileSize = 64 * 1024 * 1024;
+const qint64 IndexCache::maxDirectorySize = 1024 * 1024 * 1024;
+
+namespace {
+    const quint32 cacheMagic   = 0x676c4958; // "glIX"
+    const quint32 cacheVersion = 3;
+
+    // The fixed part of the header is padded to this size
+    const qint64 headerSize = 128;
+    // Size of the blocks at the beginning and end of the file
+    // whose hash is checked
+    const qint64 hashedBlockSize = 64 * 1024;
+    // Size of the blocks of positions read/written at once
+    const int ioBlockSize = 1024 * 1024;
+    // Number of lines passed at once to the indexing data when loading
+    const int loadBatchSize = 1024 * 1024;
+
+    struct FileIdentity {
+        quint64 inode = 0;
+        qint64 size = 0;
+        qint64 mtime = 0;
+    };
+
+    struct Header {
+        quint32 magic = 0;
+        quint32 version = 0;
+        // The file when the entry was saved
+        FileIdentity file;
+        // End of the last line
+        qint64 indexedSize = 0;
+        QByteArray headHash;
+        QByteArray tailHash;
+        qint32 maxLength = 0;
+        qint32 encoding = 0;
+        quint64 nbLines = 0;
+        // Size of the positions following the header
+        qint64 bodySize = 0;
+        // Absolute name of the indexed file
+        QString fileName;
+        // Where the positions start (when read)
+        qint64 bodyOffset = 0;
+    };
+
+    bool getFileIdentity( const QString& fileName, FileIdentity* identity )
+    {
+        const QFileInfo info( fileName );
+        if ( ! info.exists() )
+            return false;
+
+        identity->size  = info.size();
+        identity->mtime = info.lastModified().toMSecsSinceEpoch();
+#ifdef Q_OS_UNIX
+        struct stat file_stat;
+        if ( stat( QFile::encodeName( fileName ).constData(), &file_stat ) == 0 )
+            identity->inode = file_stat.st_ino;
+#endif
+
+        return true;
+    }
+
+    // Whether the header can be the one of the current content of its
+    // file (only its hashes can tell for sure)
+    bool matchesFile( const Header& header, const QString& fileName )
+    {
+        FileIdentity file;
+        return getFileIdentity( fileName, &file )
+            && ( file.inode == header.file.inode )
+            && ( file.size >= header.indexedSize )
+            && ( file.size != header.file.size || file.mtime == header.file.mtime );
+    }
+
+    void writeHeader( QIODevice* device, const Header& header )
+    {
+        QDataStream out( device );
+        out.setVersion( QDataStream::Qt_5_0 );
+
+        out << header.magic << header.version
+            << header.file.inode << header.file.size << header.file.mtime
+            << header.indexedSize;
+        out.writeRawData( header.headHash.constData(), header.headHash.size() );
+        out.writeRawData( header.tailHash.constData(), header.tailHash.size() );
+        out << header.maxLength << header.encoding
+            << header.nbLines << header.bodySize;
+
+        device->seek( headerSize );
+        out << header.fileName;
+    }
+
+    bool readHeader( QIODevice* device, Header* header )
+    {
+        QDataStream in( device );
+        in.setVersion( QDataStream::Qt_5_0 );
+
+        const int hash_size = QCryptographicHash::hashLength( QCryptographicHash::Sha1 );
+        header->headHash.resize( hash_size );
+        header->tailHash.resize( hash_size );
+
+        in >> header->magic >> header->version
+            >> header->file.inode >> header->file.size >> header->file.mtime
+            >> header->indexedSize;
+        in.readRawData( header->headHash.data(), hash_size );
+        in.readRawData( header->tailHash.data(), hash_size );
+        in >> header->maxLength >> header->encoding
+            >> header->nbLines >> header->bodySize;
+
+        device->seek( headerSize );
+        in >> header->fileName;
+        header->bodyOffset = device->pos();
+
+        return ( in.status() == QDataStream::Ok )
+            && ( header->magic == cacheMagic )
+            && ( header->version == cacheVersion );
+    }
+
+    void appendVarint( QByteArray* bytes, quint64 value )
+    {
+        while ( value >= 0x80 ) {
+            bytes->append( static_cast<char>( ( value & 0x7F ) | 0x80 ) );
+            value >>= 7;
+        }
+        bytes->append( static_cast<char>( value ) );
+    }
+}
+
+IndexCache::IndexCache( const QString& fileName, const QString& directory )
+    : fileName_( fileName ), savedLines_( 0 ),
+    savedPosition_( 0 ), savedBodySize_( 0 )
+{
+    const QByteArray key = QCryptographicHash::hash(
+            QFileInfo( fileName ).absoluteFilePath().toUtf8(),
+            QCryptographicHash::Sha1 ).toHex();
+
+    cacheFileName_ = QDir( directory ).filePath( QString::fromLatin1( key ) + ".idx" );
+}
+
+bool IndexCache::load( IndexingData* indexing_data )
+{
+    QFile cache( cacheFileName_ );
+    if ( ! cache.open( QIODevice::ReadOnly ) )
+        return false;
+
+    Header header;
+    if ( ! readHeader( &cache, &header ) ) {
+        LOG(logWARNING) << "Invalid index cache " << cacheFileName_.toStdString();
+        return false;
+    }
+
+    if ( ! matchesFile( header, fileName_ ) ) {
+        LOG(logINFO) << "Cached index for " << fileName_.toStdString() << " is stale";
+        return false;
+    }
+
+    QByteArray head_hash, tail_hash;
+    if ( ( ! hashFile( header.indexedSize, &head_hash, &tail_hash ) )
+            || ( head_hash != header.headHash ) || ( tail_hash != header.tailHash ) ) {
+        LOG(logINFO) << "Cached index for " << fileName_.toStdString()
+            << " does not match its content";
+        return false;
+    }
+
+    const auto encoding = static_cast<EncodingSpeculator::Encoding>( header.encoding );
+
+    FastLinePositionArray positions;
+    quint64 nb_lines = 0;
+    qint64 position = 0;
+    qint64 batch_beginning = 0;
+    quint64 delta = 0;
+    int shift = 0;
+
+    cache.seek( header.bodyOffset );
+    qint64 left = header.bodySize;
+    while ( left > 0 && shift < 64 ) {
+        const QByteArray block = cache.read( qMin<qint64>( left, ioBlockSize ) );
+        if ( block.isEmpty() )
+            break;
+        left -= block.size();
+
+        for ( const char c : block ) {
+            delta |= static_cast<quint64>( c & 0x7F ) << shift;
+            if ( c & 0x80 ) {
+                shift += 7;
+                continue;
+            }
+
+            position += delta;
+            delta = 0;
+            shift = 0;
+
+            positions.append( position );
+            ++nb_lines;
+
+            if ( positions.size() == loadBatchSize ) {
+                indexing_data->addAll( position - batch_beginning, 0, positions, encoding );
+                batch_beginning = position;
+                positions = FastLinePositionArray();
+            }
+        }
+    }
+    indexing_data->addAll( position - batch_beginning, header.maxLength,
+            positions, encoding );
+
+    if ( ( left != 0 ) || ( shift != 0 )
+            || ( nb_lines != header.nbLines ) || ( position != header.indexedSize ) ) {
+        LOG(logWARNING) << "Corrupted index cache " << cacheFileName_.toStdString();
+        indexing_data->clear();
+        return false;
+    }
+
+    savedLines_    = nb_lines;
+    savedPosition_ = header.indexedSize;
+    savedBodySize_ = header.bodySize;
+
+    // Recently used, as far as trim is concerned
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 10, 0 )
+    cache.setFileTime( QDateTime::currentDateTime(), QFileDevice::FileModificationTime );
+#endif
+
+    LOG(logINFO) << "Loaded " << nb_lines << " lines from the index cache of "
+        << fileName_.toStdString();
+
+    return true;
+}
+
+void IndexCache::save( const IndexingData& indexing_data )
+{
+    // Not until the beginning of the file is indexed, and never for
+    // sparse indexes (the cache is still loaded in them)
+    if ( indexing_data.getStartPosition() != 0 || indexing_data.isSparse() )
+        return;
+
+    // (everything is read from the same snapshot of the index)
+    IndexingData::Cursor cursor( indexing_data );
+    const qint64 indexed_size = indexing_data.getSize();
+    LineNumber nb_lines = cursor.getNbLines();
+
+    // A fake final LF is past the indexed size
+    if ( nb_lines > 0 && cursor.getPosForLine( nb_lines - 1 ) > indexed_size )
+        --nb_lines;
+
+    if ( nb_lines <= savedLines_ )
+        return;
+
+    Header header;
+    header.magic       = cacheMagic;
+    header.version     = cacheVersion;
+    header.indexedSize = cursor.getPosForLine( nb_lines - 1 );
+    header.maxLength   = indexing_data.getMaxLength();
+    header.encoding    = static_cast<qint32>( indexing_data.getEncodingGuess() );
+    header.nbLines     = nb_lines;
+
+    if ( ( ! getFileIdentity( fileName_, &header.file ) )
+            || ( ! hashFile( header.indexedSize, &header.headHash, &header.tailHash ) ) )
+        return;
+
+    header.fileName = QFileInfo( fileName_ ).absoluteFilePath();
+
+    // The positions already saved are copied from the entry, unless
+    // another instance has replaced it since
+    QFile previous_entry( cacheFileName_ );
+    Header previous_header;
+    LineNumber first_line = savedLines_;
+    qint64 previous = savedPosition_;
+    qint64 body_size = savedBodySize_;
+    if ( savedLines_ > 0 && ! ( previous_entry.open( QIODevice::ReadOnly )
+                && readHeader( &previous_entry, &previous_header )
+                && previous_header.nbLines == savedLines_
+                && previous_header.indexedSize == savedPosition_
+                && previous_header.bodySize == savedBodySize_ ) ) {
+        first_line = 0;
+        previous = 0;
+        body_size = 0;
+    }
+
+    const QString directory = QFileInfo( cacheFileName_ ).absolutePath();
+    QDir().mkpath( directory );
+    QSaveFile cache( cacheFileName_ );
+    if ( ! cache.open( QIODevice::WriteOnly ) ) {
+        LOG(logWARNING) << "Cannot write index cache " << cacheFileName_.toStdString();
+        return;
+    }
+
+    // (written again once the size of the positions is known)
+    writeHeader( &cache, header );
+
+    bool ok = true;
+    if ( first_line > 0 ) {
+        previous_entry.seek( previous_header.bodyOffset );
+        for ( qint64 left = body_size; ok && left > 0; ) {
+            const QByteArray block =
+                previous_entry.read( qMin<qint64>( left, ioBlockSize ) );
+            ok = ! block.isEmpty() && cache.write( block ) == block.size();
+            left -= block.size();
+        }
+    }
+    previous_entry.close();
+
+    QByteArray body;
+    for ( LineNumber line = first_line; ok && line < nb_lines; ++line ) {
+        const qint64 position = cursor.getPosForLine( line );
+        appendVarint( &body, position - previous );
+        previous = position;
+
+        if ( body.size() >= ioBlockSize || line == nb_lines - 1 ) {
+            ok = cache.write( body ) == body.size();
+            body_size += body.size();
+            body.clear();
+        }
+    }
+
+    header.bodySize = body_size;
+    if ( ok ) {
+        cache.seek( 0 );
+        writeHeader( &cache, header );
+    }
+
+    // (the entry is only replaced if everything has been written)
+    if ( ! ok || ! cache.commit() ) {
+        LOG(logWARNING) << "Cannot write index cache " << cacheFileName_.toStdString();
+        return;
+    }
+
+    savedLines_    = nb_lines;
+    savedPosition_ = header.indexedSize;
+    savedBodySize_ = body_size;
+
+    LOG(logDEBUG) << "Saved " << nb_lines << " lines in the index cache of "
+        << fileName_.toStdString();
+
+    trim( directory, maxDirectorySize );
+}
+
+void IndexCache::clear()
+{
+    QFile::remove( cacheFileName_ );
+
+    savedLines_    = 0;
+    savedPosition_ = 0;
+    savedBodySize_ = 0;
+}
+
+QString IndexCache::defaultDirectory()
+{
+    return QDir( QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) )
+        .filePath( "index" );
+}
+
+void IndexCache::trim( const QString& directory, qint64 max_size )
+{
+    // (most recent first)
+    const QFileInfoList entries = QDir( directory ).entryInfoList(
+            QStringList() << "*.idx", QDir::Files, QDir::Time );
+
+    qint64 total_size = 0;
+    for ( const QFileInfo& entry : entries ) {
+        QFile cache( entry.absoluteFilePath() );
+        Header header;
+        const bool valid = cache.open( QIODevice::ReadOnly )
+            && readHeader( &cache, &header )
+            && matchesFile( header, header.fileName );
+        cache.close();
+
+        if ( valid && total_size + entry.size() <= max_size ) {
+            total_size += entry.size();
+        }
+        else {
+            LOG(logDEBUG) << "Removing index cache " << entry.fileName().toStdString();
+            QFile::remove( entry.absoluteFilePath() );
+        }
+    }
+}
+
+// Hash the first and last blocks of the file before end
+bool IndexCache::hashFile( qint64 end,
+        QByteArray* head_hash, QByteArray* tail_hash ) const
+{
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    const qint64 length = qMin( end, hashedBlockSize );
+    const QByteArray head = file.read( length );
+    file.seek( end - length );
+    const QByteArray tail = file.read( length );
+
+    if ( head.size() != length || tail.size() != length )
+        return false;
+
+    *head_hash = QCryptographicHash::hash( head, QCryptographicHash::Sha1 );
+    *tail_hash = QCryptographicHash::hash( tail, QCryptographicHash::Sha1 );
+
+    return true;
+}
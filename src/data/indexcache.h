@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INDEXCACHE_H
+#define INDEXCACHE_H
+
+#include <QString>
+
+#include "utils.h"
+
+class IndexingData;
+
+// The index of a file saved on disk so it does not have to be rebuilt
+// when the file is opened again.
+// Only complete lines are saved: the cached index covers the file up
+// to its last end of line, the rest has to be indexed again.
+// An entry is valid as long as the file has the same inode, has not been
+// modified in place (same size but different modification time) and still
+// has the same first and last bytes (before the end of the cached index);
+// the file can have been appended to since.
+// Saving after the first time only encodes the new lines, the others are
+// copied from the entry. The entries are written to a temporary file which
+// then replaces the previous one, so several instances can share the cache.
+// Once the cache is bigger than maxDirectorySize, the least recently used
+// entries are removed (see trim).
+class IndexCache
+{
+  public:
+    // Files smaller than this are fast enough to index to not be cached
+    static const qint64 minFileSize;
+    // Size the cache directory is trimmed to after each save
+    static const qint64 maxDirectorySize;
+
+    // Cache the index of the passed file in the passed directory
+    IndexCache( const QString& fileName,
+            const QString& directory = defaultDirectory() );
+
+    // Fill the passed (empty) indexing data from the cache.
+    // Returns false if there is no valid entry for the file.
+    bool load( IndexingData* indexing_data );
+    // Save the complete lines of the passed indexing data
+    // (which must start with what was loaded or saved before).
+    void save( const IndexingData& indexing_data );
+    // Remove the entry (the index is going to be rebuilt).
+    void clear();
+
+    // Name of the file holding the entry
+    QString cacheFileName() const { return cacheFileName_; }
+
+    // The per-user cache directory
+    static QString defaultDirectory();
+    // Remove the entries of the passed directory whose file has been
+    // deleted or replaced, then the least recently saved or loaded ones
+    // until the others take at most max_size bytes.
+    static void trim( const QString& directory, qint64 max_size );
+
+  private:
+    bool hashFile( qint64 end, QByteArray* head_hash, QByteArray* tail_hash ) const;
+
+    QString fileName_;
+    QString cacheFileName_;
+
+    // What is already in the entry
+    LineNumber savedLines_;
+    qint64 savedPosition_;
+    qint64 savedBodySize_;
+};
+
+#endif
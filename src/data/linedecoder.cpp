@@ -0,0 +1,522 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/linedecoder.h"
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <QTextCodec>
+
+namespace {
+    // MIB enums of the codecs
+    const int latin1Mib  = 4;
+    const int utf8Mib    = 106;
+    const int utf16BEMib = 1013;
+    const int utf16LEMib = 1014;
+
+    // Whether the byte must be handled by decodeLine itself
+    template <bool Utf8, bool Expand>
+    inline bool isSpecial( uchar byte )
+    {
+        return ( Utf8 && byte >= 0x80 ) || ( Expand && ( byte == '\t' || byte == '\0' ) );
+    }
+
+    // Copy the bytes as they are (widened to UTF-16) up to the first
+    // special one, returns the number of bytes copied.
+    template <bool Utf8, bool Expand>
+    int copyPlainBytes( const uchar* bytes, int size, ushort** out )
+    {
+        int i = 0;
+        ushort* output = *out;
+
+#ifdef __SSE2__
+        // 16 bytes at a time
+        const __m128i zeros = _mm_setzero_si128();
+        const __m128i tabs  = _mm_set1_epi8( '\t' );
+        while ( i + 16 <= size ) {
+            const __m128i chunk =
+                _mm_loadu_si128( reinterpret_cast<const __m128i*>( bytes + i ) );
+
+            int special = 0;
+            if ( Utf8 )
+                special = _mm_movemask_epi8( chunk );
+            if ( Expand )
+                special |= _mm_movemask_epi8( _mm_or_si128(
+                            _mm_cmpeq_epi8( chunk, tabs ), _mm_cmpeq_epi8( chunk, zeros ) ) );
+            if ( special )
+                break;
+
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( output ),
+                    _mm_unpacklo_epi8( chunk, zeros ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( output + 8 ),
+                    _mm_unpackhi_epi8( chunk, zeros ) );
+            output += 16;
+            i += 16;
+        }
+#endif
+
+        while ( i < size && ! isSpecial<Utf8, Expand>( bytes[i] ) )
+            *output++ = bytes[i++];
+
+        *out = output;
+        return i;
+    }
+
+    inline bool isContinuation( uchar byte )
+    {
+        return ( byte & 0xC0 ) == 0x80;
+    }
+
+    // Decode the UTF-8 sequence at the beginning of bytes, returns its
+    // length, or 0 if it is not valid or is something QTextCodec
+    // handles in its own way (a noncharacter).
+    int decodeUtf8Sequence( const uchar* bytes, int size, uint* code_point )
+    {
+        const uchar first = bytes[0];
+        int length;
+        uint minimum;
+
+        if ( first >= 0xC2 && first <= 0xDF ) {
+            length = 2;
+            minimum = 0x80;
+            *code_point = first & 0x1F;
+        }
+        else if ( first >= 0xE0 && first <= 0xEF ) {
+            length = 3;
+            minimum = 0x800;
+            *code_point = first & 0x0F;
+        }
+        else if ( first >= 0xF0 && first <= 0xF4 ) {
+            length = 4;
+            minimum = 0x10000;
+            *code_point = first & 0x07;
+        }
+        else
+            return 0;
+
+        if ( size < length )
+            return 0;
+
+        for ( int i = 1; i < length; ++i ) {
+            if ( ! isContinuation( bytes[i] ) )
+                return 0;
+            *code_point = ( *code_point << 6 ) | ( bytes[i] & 0x3F );
+        }
+
+        const uint c = *code_point;
+        if ( c < minimum || c > 0x10FFFF
+                || ( c >= 0xD800 && c <= 0xDFFF )
+                || ( c >= 0xFDD0 && c <= 0xFDEF ) || ( c & 0xFFFE ) == 0xFFFE )
+            return 0;
+
+        return length;
+    }
+
+    // Decode the line (and expand its tabs, the line starting at column)
+    // in one pass, returns false if it must be decoded by the codec.
+    template <bool Utf8, bool Expand>
+    bool decodeLine( const uchar* bytes, int size, int column, QString* result )
+    {
+        // The codec removes a leading BOM
+        if ( Utf8 && size >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF )
+            return false;
+
+        // The decoded line is never longer than the bytes, but for the tabs
+        const int nb_tabs = Expand ? std::count( bytes, bytes + size, '\t' ) : 0;
+        QString line( size + nb_tabs * ( LineDecoder::tabStop - 1 ), Qt::Uninitialized );
+        ushort* const begin = reinterpret_cast<ushort*>( line.data() );
+        ushort* out = begin;
+
+        int i = 0;
+        while ( true ) {
+            i += copyPlainBytes<Utf8, Expand>( bytes + i, size - i, &out );
+            if ( i == size )
+                break;
+
+            const uchar byte = bytes[i];
+            if ( Expand && byte == '\t' ) {
+                const int spaces = LineDecoder::tabStop
+                    - ( column + ( out - begin ) ) % LineDecoder::tabStop;
+                std::fill( out, out + spaces, ushort( ' ' ) );
+                out += spaces;
+                ++i;
+            }
+            else if ( Expand && byte == '\0' ) {
+                *out++ = ' ';
+                ++i;
+            }
+            else {
+                uint code_point;
+                const int length = decodeUtf8Sequence( bytes + i, size - i, &code_point );
+                if ( length == 0 )
+                    return false;
+
+                if ( QChar::requiresSurrogates( code_point ) ) {
+                    *out++ = QChar::highSurrogate( code_point );
+                    *out++ = QChar::lowSurrogate( code_point );
+                }
+                else
+                    *out++ = code_point;
+                i += length;
+            }
+        }
+
+        line.resize( out - begin );
+        *result = line;
+        return true;
+    }
+
+    template <bool BigEndian>
+    inline ushort readUnit( const uchar* bytes )
+    {
+        return BigEndian ? ( bytes[0] << 8 ) | bytes[1] : bytes[0] | ( bytes[1] << 8 );
+    }
+
+    // Whether the code unit must be handled by decodeUtf16Line itself
+    template <bool Expand>
+    inline bool isSpecialUnit( ushort unit )
+    {
+        return QChar::isSurrogate( unit ) || ( Expand && ( unit == '\t' || unit == 0 ) );
+    }
+
+    // Copy the code units as they are (in the native order) up to the
+    // first special one, returns the number of units copied.
+    template <bool BigEndian, bool Expand>
+    int copyPlainUnits( const uchar* bytes, int nb_units, ushort** out )
+    {
+        int i = 0;
+        ushort* output = *out;
+
+#ifdef __SSE2__
+        // 8 code units at a time
+        const __m128i zeros          = _mm_setzero_si128();
+        const __m128i tabs           = _mm_set1_epi16( '\t' );
+        const __m128i surrogate_mask = _mm_set1_epi16( static_cast<short>( 0xF800 ) );
+        const __m128i surrogates     = _mm_set1_epi16( static_cast<short>( 0xD800 ) );
+        while ( i + 8 <= nb_units ) {
+            __m128i chunk =
+                _mm_loadu_si128( reinterpret_cast<const __m128i*>( bytes + 2 * i ) );
+            if ( BigEndian )
+                chunk = _mm_or_si128( _mm_slli_epi16( chunk, 8 ), _mm_srli_epi16( chunk, 8 ) );
+
+            __m128i special = _mm_cmpeq_epi16(
+                    _mm_and_si128( chunk, surrogate_mask ), surrogates );
+            if ( Expand )
+                special = _mm_or_si128( special, _mm_or_si128(
+                            _mm_cmpeq_epi16( chunk, tabs ), _mm_cmpeq_epi16( chunk, zeros ) ) );
+            if ( _mm_movemask_epi8( special ) )
+                break;
+
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( output ), chunk );
+            output += 8;
+            i += 8;
+        }
+#endif
+
+        while ( i < nb_units ) {
+            const ushort unit = readUnit<BigEndian>( bytes + 2 * i );
+            if ( isSpecialUnit<Expand>( unit ) )
+                break;
+            *output++ = unit;
+            ++i;
+        }
+
+        *out = output;
+        return i;
+    }
+
+    // Same as decodeLine for UTF-16
+    template <bool BigEndian, bool Expand>
+    bool decodeUtf16Line( const uchar* bytes, int size, int column, QString* result )
+    {
+        // The codec handles the incomplete code units and removes a
+        // leading BOM
+        if ( size % 2 != 0
+                || ( size >= 2 && readUnit<BigEndian>( bytes ) == 0xFEFF ) )
+            return false;
+
+        const int nb_units = size / 2;
+        int nb_tabs = 0;
+        if ( Expand ) {
+            for ( int i = 0; i < nb_units; ++i )
+                nb_tabs += ( readUnit<BigEndian>( bytes + 2 * i ) == '\t' );
+        }
+        QString line( nb_units + nb_tabs * ( LineDecoder::tabStop - 1 ), Qt::Uninitialized );
+        ushort* const begin = reinterpret_cast<ushort*>( line.data() );
+        ushort* out = begin;
+
+        int i = 0;
+        while ( true ) {
+            i += copyPlainUnits<BigEndian, Expand>( bytes + 2 * i, nb_units - i, &out );
+            if ( i == nb_units )
+                break;
+
+            const ushort unit = readUnit<BigEndian>( bytes + 2 * i );
+            if ( Expand && unit == '\t' ) {
+                const int spaces = LineDecoder::tabStop
+                    - ( column + ( out - begin ) ) % LineDecoder::tabStop;
+                std::fill( out, out + spaces, ushort( ' ' ) );
+                out += spaces;
+                ++i;
+            }
+            else if ( Expand && unit == 0 ) {
+                *out++ = ' ';
+                ++i;
+            }
+            else {
+                // Only the complete surrogate pairs are ours
+                if ( ! QChar::isHighSurrogate( unit ) || i + 1 == nb_units
+                        || ! QChar::isLowSurrogate( readUnit<BigEndian>( bytes + 2 * i + 2 ) ) )
+                    return false;
+                *out++ = unit;
+                *out++ = readUnit<BigEndian>( bytes + 2 * i + 2 );
+                i += 2;
+            }
+        }
+
+        line.resize( out - begin );
+        *result = line;
+        return true;
+    }
+}
+
+LineDecoder::LineDecoder( QTextCodec* codec )
+    : codec_( codec ), kind_( Kind::Other )
+{
+    if ( ! codec_ || codec_->mibEnum() == latin1Mib )
+        kind_ = Kind::Latin1;
+    else if ( codec_->mibEnum() == utf8Mib )
+        kind_ = Kind::Utf8;
+    else if ( codec_->mibEnum() == utf16LEMib )
+        kind_ = Kind::Utf16LE;
+    else if ( codec_->mibEnum() == utf16BEMib )
+        kind_ = Kind::Utf16BE;
+}
+
+QString LineDecoder::decode( const char* bytes, int size ) const
+{
+    QString line;
+
+    switch ( kind_ ) {
+        case Kind::Latin1:
+            return QString::fromLatin1( bytes, size );
+        case Kind::Utf8:
+            if ( decodeLine<true, false>( reinterpret_cast<const uchar*>( bytes ),
+                        size, 0, &line ) )
+                return line;
+            break;
+        case Kind::Utf16LE:
+            if ( decodeUtf16Line<false, false>( reinterpret_cast<const uchar*>( bytes ),
+                        size, 0, &line ) )
+                return line;
+            break;
+        case Kind::Utf16BE:
+            if ( decodeUtf16Line<true, false>( reinterpret_cast<const uchar*>( bytes ),
+                        size, 0, &line ) )
+                return line;
+            break;
+        case Kind::Other:
+            break;
+    }
+
+    return codec_->toUnicode( bytes, size );
+}
+
+QString LineDecoder::decodeExpanded( const char* bytes, int size, int column ) const
+{
+    QString line;
+
+    switch ( kind_ ) {
+        case Kind::Latin1:
+            // (all the bytes are valid)
+            decodeLine<false, true>( reinterpret_cast<const uchar*>( bytes ),
+                    size, column, &line );
+            return line;
+        case Kind::Utf8:
+            if ( decodeLine<true, true>( reinterpret_cast<const uchar*>( bytes ),
+                        size, column, &line ) )
+                return line;
+            break;
+        case Kind::Utf16LE:
+            if ( decodeUtf16Line<false, true>( reinterpret_cast<const uchar*>( bytes ),
+                        size, column, &line ) )
+                return line;
+            break;
+        case Kind::Utf16BE:
+            if ( decodeUtf16Line<true, true>( reinterpret_cast<const uchar*>( bytes ),
+                        size, column, &line ) )
+                return line;
+            break;
+        case Kind::Other:
+            break;
+    }
+
+    return expandTabs( codec_->toUnicode( bytes, size ), column );
+}
+
+bool LineDecoder::isUtf8( const char* bytes, int size ) const
+{
+    const uchar* const data = reinterpret_cast<const uchar*>( bytes );
+
+    switch ( kind_ ) {
+        case Kind::Utf8:
+            // (the codec removes a leading BOM)
+            return ! ( size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF );
+        case Kind::Latin1: {
+            // Only ASCII is the same in both
+            int i = 0;
+#ifdef __SSE2__
+            for ( ; i + 16 <= size; i += 16 ) {
+                if ( _mm_movemask_epi8( _mm_loadu_si128(
+                                reinterpret_cast<const __m128i*>( data + i ) ) ) )
+                    return false;
+            }
+#endif
+            for ( ; i < size; ++i ) {
+                if ( data[i] >= 0x80 )
+                    return false;
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// The characters are counted the way decodeExpanded outputs them, the
+// invalid UTF-8 bytes (which the codec replaces) count as one column.
+int LineDecoder::skipColumns( const char* bytes, int size,
+        int* column, int target_column ) const
+{
+    if ( kind_ == Kind::Utf16LE || kind_ == Kind::Utf16BE )
+        return skipUtf16Columns( bytes, size, column, target_column );
+
+    const uchar* const data = reinterpret_cast<const uchar*>( bytes );
+    int current = *column;
+    int i = 0;
+
+    while ( i < size ) {
+        const uchar byte = data[i];
+        int length = 1;
+        int width = 1;
+
+        if ( byte == '\t' )
+            width = tabStop - current % tabStop;
+        else if ( kind_ == Kind::Utf8 && byte >= 0xC0 ) {
+            const int expected = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+            while ( length < expected && i + length < size
+                    && isContinuation( data[i + length] ) )
+                ++length;
+            // (outside of the BMP, as a surrogate pair)
+            if ( byte >= 0xF0 )
+                width = 2;
+        }
+
+        if ( current + width > target_column )
+            break;
+
+        current += width;
+        i += length;
+    }
+
+    *column = current;
+    return i;
+}
+
+// A surrogate pair is one character taking two columns, as in UTF-8.
+int LineDecoder::skipUtf16Columns( const char* bytes, int size,
+        int* column, int target_column ) const
+{
+    const uchar* const data = reinterpret_cast<const uchar*>( bytes );
+    const auto unit_at = [&]( int i ) -> ushort {
+        return ( kind_ == Kind::Utf16BE ) ?
+            readUnit<true>( data + i ) : readUnit<false>( data + i );
+    };
+    int current = *column;
+    int i = 0;
+
+    while ( i + 2 <= size ) {
+        const ushort unit = unit_at( i );
+        int length = 2;
+        int width = 1;
+
+        if ( unit == '\t' )
+            width = tabStop - current % tabStop;
+        else if ( QChar::isHighSurrogate( unit ) && i + 4 <= size
+                && QChar::isLowSurrogate( unit_at( i + 2 ) ) ) {
+            length = 4;
+            width = 2;
+        }
+
+        if ( current + width > target_column )
+            break;
+
+        current += width;
+        i += length;
+    }
+
+    *column = current;
+    return i;
+}
+
+int LineDecoder::nextCharacter( const char* bytes, int size, int position ) const
+{
+    if ( kind_ == Kind::Utf8 ) {
+        while ( position < size
+                && isContinuation( static_cast<uchar>( bytes[position] ) ) )
+            ++position;
+    }
+    else if ( kind_ == Kind::Utf16LE || kind_ == Kind::Utf16BE ) {
+        // (the second half of a surrogate pair is not a character)
+        const uchar* const data = reinterpret_cast<const uchar*>( bytes );
+        position = qMin( size, position + position % 2 );
+        if ( position + 2 <= size && QChar::isLowSurrogate( kind_ == Kind::Utf16BE ?
+                    readUnit<true>( data + position ) : readUnit<false>( data + position ) ) )
+            position += 2;
+    }
+
+    return position;
+}
+
+QString LineDecoder::expandTabs( const QString& line, int column )
+{
+    const int nb_tabs = line.count( QChar( '\t' ) );
+    QString expanded( line.size() + nb_tabs * ( tabStop - 1 ), Qt::Uninitialized );
+    QChar* const begin = expanded.data();
+    QChar* out = begin;
+
+    for ( const QChar c : line ) {
+        if ( c == QChar( '\t' ) ) {
+            const int spaces = tabStop - ( column + ( out - begin ) ) % tabStop;
+            std::fill( out, out + spaces, QChar( ' ' ) );
+            out += spaces;
+        }
+        else if ( c == QChar( '\0' ) )
+            *out++ = QChar( ' ' );
+        else
+            *out++ = c;
+    }
+
+    expanded.resize( out - begin );
+    return expanded;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINEDECODER_H
+#define LINEDECODER_H
+
+#include <QString>
+
+class QTextCodec;
+
+// Converts the bytes of the lines of a file to text.
+// For Latin-1, UTF-8 and UTF-16, the bytes are decoded and the tabs are
+// expanded in a single pass, without QTextCodec, the other encodings
+// (and the invalid UTF-8 or UTF-16) are left to the codec.
+class LineDecoder
+{
+  public:
+    // Length of a tab stop
+    static const int tabStop = 8;
+
+    // Decode with the passed codec (Latin-1 if null)
+    explicit LineDecoder( QTextCodec* codec );
+
+    // Returns the passed bytes decoded
+    QString decode( const char* bytes, int size ) const;
+    // Returns the passed bytes decoded, with the tabs expanded
+    // and the NULs replaced by spaces, the bytes starting at the
+    // passed column of their line
+    QString decodeExpanded( const char* bytes, int size, int column = 0 ) const;
+
+    // Whether the passed bytes, taken as UTF-8, are the characters they
+    // decode to (the validity of UTF-8 itself is not checked)
+    bool isUtf8( const char* bytes, int size ) const;
+    // Whether the ASCII characters decoded are always ASCII bytes
+    // (and the other bytes never decode to ASCII characters)
+    bool isAsciiCompatible() const
+    { return kind_ == Kind::Latin1 || kind_ == Kind::Utf8; }
+
+    // Whether the columns can be counted without decoding the bytes
+    // (then the functions below can be used)
+    bool countsColumns() const { return kind_ != Kind::Other; }
+    // Move over the characters at the beginning of the bytes as long
+    // as they end at or before target_column, starting at *column.
+    // Returns the number of bytes moved over, *column is updated.
+    int skipColumns( const char* bytes, int size,
+            int* column, int target_column ) const;
+    // Returns the first beginning of a character at or after position
+    int nextCharacter( const char* bytes, int size, int position ) const;
+
+    // Expand the tabs and replace the NULs by spaces
+    static QString expandTabs( const QString& line, int column = 0 );
+
+  private:
+    enum class Kind { Latin1, Utf8, Utf16LE, Utf16BE, Other };
+
+    int skipUtf16Columns( const char* bytes, int size,
+            int* column, int target_column ) const;
+
+    QTextCodec* codec_;
+    Kind kind_;
+};
+
+#endif
@@ -23,9 +23,41 @@
 #include <vector>
 
 #include "data/compressedlinestorage.h"
+#include "data/eliasfanolinestorage.h"
 
 typedef std::vector<uint64_t> SimpleLinePositionStorage;
 
+// Memory allocated by the storages (in bytes)
+inline size_t storageMemoryUsage( const SimpleLinePositionStorage& storage )
+{ return storage.capacity() * sizeof( uint64_t ); }
+inline size_t storageMemoryUsage( const CompressedLinePositionStorage& storage )
+{ return storage.memoryUsage(); }
+inline size_t storageMemoryUsage( const EliasFanoLinePositionStorage& storage )
+{ return storage.memoryUsage(); }
+
+// Reads a storage for one thread (see CompressedLinePositionStorage::Cursor),
+// the other storages are read in constant time so they need no state.
+template <typename Storage>
+class StorageCursor
+{
+  public:
+    explicit StorageCursor( const Storage& storage ) : storage_( storage ) {}
+
+    uint64_t at( uint32_t i ) { return storage_.at( i ); }
+    void reset() {}
+
+  private:
+    const Storage& storage_;
+};
+
+template <>
+class StorageCursor<CompressedLinePositionStorage>
+    : public CompressedLinePositionStorage::Cursor
+{
+  public:
+    using CompressedLinePositionStorage::Cursor::Cursor;
+};
+
 // This class is a list of end of lines position,
 // in addition to a list of uint64_t (positions within the files)
 // it can keep track of whether the final LF was added (for non-LF terminated
@@ -70,6 +102,31 @@ class LinePosition
     // Must be used after 'append'-ing a fake LF at the end.
     void setFakeFinalLF( bool finalLF=true )
     { fakeFinalLF_ = finalLF; }
+    // Whether the last position is a fake final LF
+    bool hasFakeFinalLF() const
+    { return fakeFinalLF_; }
+    // Memory allocated for the positions (in bytes)
+    size_t memoryUsage() const
+    { return storageMemoryUsage( array ); }
+
+    // Reads the positions for one thread, faster than at() for
+    // consecutive positions.
+    // It must be reset if a fake final LF is replaced or the array is
+    // assigned to.
+    class Cursor
+    {
+      public:
+        explicit Cursor( const LinePosition& line_position )
+            : cursor_( line_position.array ) {}
+
+        uint64_t at( int i )
+        { return cursor_.at( i ); }
+        void reset()
+        { cursor_.reset(); }
+
+      private:
+        StorageCursor<Storage> cursor_;
+    };
 
     // Add another list to this one, removing any fake LF on this list.
     // Invariant: all pos in other must be greater than any pos in this
@@ -98,5 +155,7 @@ typedef LinePosition<SimpleLinePositionStorage> FastLinePositionArray;
 //typedef LinePosition<SimpleLinePositionStorage> LinePositionArray;
 
 typedef LinePosition<CompressedLinePositionStorage> LinePositionArray;
+// Constant time access, about the same size (see linepositionarrayPerfTest)
+typedef LinePosition<EliasFanoLinePositionStorage> EliasFanoLinePositionArray;
 
 #endif
@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/linescanner.h"
+
+#include <cstring>
+
+#include "data/abstractlogdata.h"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define GLOGG_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+    // Current state of the scan, kept in locals for speed
+    struct ScanState {
+        qint64 pos;
+        int additional_spaces;
+        int max_length;
+    };
+
+    // The code units, with the values of the LF and tab ones as loaded
+    // in (little endian) vector registers.
+    struct ByteUnit {
+        static const int size = 1;
+        static const int lineFeed = '\n';
+        static const int tab = '\t';
+
+        static inline int read( const char* unit )
+        { return static_cast<uchar>( *unit ); }
+    };
+
+    template <bool BigEndian>
+    struct Utf16Unit {
+        static const int size = 2;
+        static const int lineFeed = BigEndian ? 0x0A00 : 0x000A;
+        static const int tab = BigEndian ? 0x0900 : 0x0009;
+
+        // (as loaded, so it can be compared with the constants above)
+        static inline int read( const char* unit )
+        { return static_cast<uchar>( unit[0] ) | ( static_cast<uchar>( unit[1] ) << 8 ); }
+    };
+
+    // Process one code unit which is known to be a LF or a tab
+    template <typename Unit>
+    inline void processSpecialUnit( const char* unit, qint64 position,
+            ScanState* state, FastLinePositionArray* line_positions )
+    {
+        const int column = ( position - state->pos ) / Unit::size
+            + state->additional_spaces;
+
+        if ( Unit::read( unit ) == Unit::lineFeed ) {
+            // When a end of line has been found...
+            if ( column > state->max_length )
+                state->max_length = column;
+            state->pos = position + Unit::size;
+            state->additional_spaces = 0;
+            line_positions->append( state->pos );
+        }
+        else {
+            state->additional_spaces += AbstractLogData::tabStop -
+                ( column % AbstractLogData::tabStop ) - 1;
+        }
+    }
+
+    // Reference implementation, one code unit at a time
+    template <typename Unit>
+    void scanScalar( const char* block, int from, int size, qint64 block_beginning,
+            ScanState* state, FastLinePositionArray* line_positions )
+    {
+        for ( int i = from; i + Unit::size <= size; i += Unit::size ) {
+            const int unit = Unit::read( block + i );
+            if ( unit == Unit::lineFeed || unit == Unit::tab )
+                processSpecialUnit<Unit>( block + i, block_beginning + i,
+                        state, line_positions );
+        }
+    }
+
+#ifdef GLOGG_X86_KERNELS
+    // Process the special code units of a vector, given as a bit mask
+    // of their first bytes
+    template <typename Unit, typename Mask>
+    inline void processMask( Mask mask, const char* block, int offset,
+            qint64 block_beginning, ScanState* state,
+            FastLinePositionArray* line_positions )
+    {
+        while ( mask ) {
+            const int i = offset + __builtin_ctz( mask );
+            processSpecialUnit<Unit>( block + i, block_beginning + i,
+                    state, line_positions );
+            mask &= mask - 1;
+        }
+    }
+
+    template <typename Unit>
+    __attribute__(( target( "sse2" ) ))
+    void scanSSE2( const char* block, int size, qint64 block_beginning,
+            ScanState* state, FastLinePositionArray* line_positions )
+    {
+        const __m128i lf  = Unit::size == 1 ?
+            _mm_set1_epi8( Unit::lineFeed ) : _mm_set1_epi16( Unit::lineFeed );
+        const __m128i tab = Unit::size == 1 ?
+            _mm_set1_epi8( Unit::tab ) : _mm_set1_epi16( Unit::tab );
+
+        int i = 0;
+        for ( ; i + 16 <= size; i += 16 ) {
+            const __m128i v = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>( block + i ) );
+            unsigned mask;
+            if ( Unit::size == 1 )
+                mask = _mm_movemask_epi8( _mm_or_si128(
+                            _mm_cmpeq_epi8( v, lf ), _mm_cmpeq_epi8( v, tab ) ) );
+            else
+                mask = _mm_movemask_epi8( _mm_or_si128(
+                            _mm_cmpeq_epi16( v, lf ), _mm_cmpeq_epi16( v, tab ) ) )
+                    & 0x5555;
+            processMask<Unit>( mask, block, i, block_beginning, state, line_positions );
+        }
+
+        scanScalar<Unit>( block, i, size, block_beginning, state, line_positions );
+    }
+
+    template <typename Unit>
+    __attribute__(( target( "avx2" ) ))
+    void scanAVX2( const char* block, int size, qint64 block_beginning,
+            ScanState* state, FastLinePositionArray* line_positions )
+    {
+        const __m256i lf  = Unit::size == 1 ?
+            _mm256_set1_epi8( Unit::lineFeed ) : _mm256_set1_epi16( Unit::lineFeed );
+        const __m256i tab = Unit::size == 1 ?
+            _mm256_set1_epi8( Unit::tab ) : _mm256_set1_epi16( Unit::tab );
+
+        int i = 0;
+        for ( ; i + 32 <= size; i += 32 ) {
+            const __m256i v = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>( block + i ) );
+            unsigned mask;
+            if ( Unit::size == 1 )
+                mask = _mm256_movemask_epi8( _mm256_or_si256(
+                            _mm256_cmpeq_epi8( v, lf ), _mm256_cmpeq_epi8( v, tab ) ) );
+            else
+                mask = _mm256_movemask_epi8( _mm256_or_si256(
+                            _mm256_cmpeq_epi16( v, lf ), _mm256_cmpeq_epi16( v, tab ) ) )
+                    & 0x55555555;
+            processMask<Unit>( mask, block, i, block_beginning, state, line_positions );
+        }
+
+        scanScalar<Unit>( block, i, size, block_beginning, state, line_positions );
+    }
+#endif
+
+    template <typename Unit>
+    void scanWith( LineScanner::Kernel kernel, const char* block, int size,
+            qint64 block_beginning, ScanState* state,
+            FastLinePositionArray* line_positions )
+    {
+        switch ( kernel ) {
+#ifdef GLOGG_X86_KERNELS
+            case LineScanner::Kernel::AVX2:
+                scanAVX2<Unit>( block, size, block_beginning, state, line_positions );
+                break;
+            case LineScanner::Kernel::SSE2:
+                scanSSE2<Unit>( block, size, block_beginning, state, line_positions );
+                break;
+#endif
+            default:
+                scanScalar<Unit>( block, 0, size, block_beginning, state, line_positions );
+                break;
+        }
+    }
+
+    template <typename Unit>
+    int findUnit( const char* block, int size, int value )
+    {
+        for ( int i = 0; i + Unit::size <= size; i += Unit::size ) {
+            if ( Unit::read( block + i ) == value )
+                return i;
+        }
+
+        return -1;
+    }
+}
+
+bool LineScanner::isSupported( Kernel kernel )
+{
+    switch ( kernel ) {
+        case Kernel::Scalar:
+            return true;
+#ifdef GLOGG_X86_KERNELS
+        case Kernel::SSE2:
+            return __builtin_cpu_supports( "sse2" );
+        case Kernel::AVX2:
+            return __builtin_cpu_supports( "avx2" );
+#endif
+        default:
+            return false;
+    }
+}
+
+LineScanner::Kernel LineScanner::bestKernel()
+{
+    static const Kernel best =
+        isSupported( Kernel::AVX2 ) ? Kernel::AVX2 :
+        isSupported( Kernel::SSE2 ) ? Kernel::SSE2 : Kernel::Scalar;
+
+    return best;
+}
+
+LineScanner::CodeUnit LineScanner::codeUnitOf( const char* beginning, int size )
+{
+    if ( size >= 2 ) {
+        const uchar first = beginning[0];
+        const uchar second = beginning[1];
+        if ( first == 0xFF && second == 0xFE )
+            return CodeUnit::Utf16LE;
+        else if ( first == 0xFE && second == 0xFF )
+            return CodeUnit::Utf16BE;
+    }
+
+    return CodeUnit::Byte;
+}
+
+void LineScanner::scan( const char* block, int size, qint64 block_beginning,
+        qint64* pos, int* additional_spaces, int* max_length,
+        FastLinePositionArray* line_positions ) const
+{
+    ScanState state = { *pos, *additional_spaces, *max_length };
+
+    // The current line might start after the beginning of the block
+    const int from = qBound( 0LL, *pos - block_beginning, static_cast<qint64>( size ) );
+    block += from;
+    size -= from;
+    block_beginning += from;
+
+    switch ( unit_ ) {
+        case CodeUnit::Utf16LE:
+            scanWith<Utf16Unit<false>>( kernel_, block, size, block_beginning,
+                    &state, line_positions );
+            break;
+        case CodeUnit::Utf16BE:
+            scanWith<Utf16Unit<true>>( kernel_, block, size, block_beginning,
+                    &state, line_positions );
+            break;
+        default:
+            scanWith<ByteUnit>( kernel_, block, size, block_beginning,
+                    &state, line_positions );
+            break;
+    }
+
+    *pos = state.pos;
+    *additional_spaces = state.additional_spaces;
+    *max_length = state.max_length;
+}
+
+int LineScanner::findLineFeed( const char* block, int size ) const
+{
+    switch ( unit_ ) {
+        case CodeUnit::Utf16LE:
+            return findUnit<Utf16Unit<false>>( block, size, Utf16Unit<false>::lineFeed );
+        case CodeUnit::Utf16BE:
+            return findUnit<Utf16Unit<true>>( block, size, Utf16Unit<true>::lineFeed );
+        default: {
+            const char* lf = static_cast<const char*>( memchr( block, '\n', size ) );
+            return lf ? lf - block : -1;
+        }
+    }
+}
+
+int LineScanner::findTab( const char* block, int size ) const
+{
+    switch ( unit_ ) {
+        case CodeUnit::Utf16LE:
+            return findUnit<Utf16Unit<false>>( block, size, Utf16Unit<false>::tab );
+        case CodeUnit::Utf16BE:
+            return findUnit<Utf16Unit<true>>( block, size, Utf16Unit<true>::tab );
+        default: {
+            const char* tab = static_cast<const char*>( memchr( block, '\t', size ) );
+            return tab ? tab - block : -1;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINESCANNER_H
+#define LINESCANNER_H
+
+#include "data/linepositionarray.h"
+
+// This class finds the end of lines in a block of the file being
+// indexed, calculating the length of the lines (with tabs expanded)
+// on the way.
+// Most of the bytes are neither LF nor tab, so the vectorised kernels
+// look for them 16 (SSE2) or 32 (AVX2) bytes at a time and only
+// process the interesting ones.
+// The lines of UTF-16 files are looked for on whole code units, so
+// the LF and tab bytes inside other characters are not mistaken for
+// them, and their length is counted in characters, not bytes.
+class LineScanner
+{
+  public:
+    enum class Kernel { Scalar, SSE2, AVX2 };
+    // Code units the files are scanned by
+    enum class CodeUnit { Byte, Utf16LE, Utf16BE };
+
+    // Construct a scanner using the passed kernel
+    // (which must be supported by the CPU)
+    LineScanner( Kernel kernel = bestKernel(), CodeUnit unit = CodeUnit::Byte )
+        : kernel_( kernel ), unit_( unit ) {}
+
+    // Returns whether the passed kernel can run on this CPU
+    static bool isSupported( Kernel kernel );
+    // Returns the fastest kernel supported by this CPU
+    static Kernel bestKernel();
+
+    // Returns the code units of a file starting with the passed bytes,
+    // UTF-16 if they are a byte order mark.
+    static CodeUnit codeUnitOf( const char* beginning, int size );
+
+    CodeUnit codeUnit() const { return unit_; }
+    // Size of the code units (in bytes)
+    int unitSize() const { return unit_ == CodeUnit::Byte ? 1 : 2; }
+
+    // Scans the passed block (whose first byte is at block_beginning in
+    // the file) for end of lines, appending them to line_positions.
+    // pos is the position of the beginning of the current line and
+    // additional_spaces the spaces added so far by expanding its tabs,
+    // they are updated so the scan can carry on with the next block.
+    // max_length is updated with the length of the complete lines.
+    // Only the whole code units of the block are scanned (block_beginning
+    // must be the beginning of one), see alignedSize.
+    void scan( const char* block, int size, qint64 block_beginning,
+            qint64* pos, int* additional_spaces, int* max_length,
+            FastLinePositionArray* line_positions ) const;
+
+    // Returns the size of the whole code units at the beginning of a
+    // block of the passed size (the rest must be scanned with the next)
+    int alignedSize( int size ) const { return size - size % unitSize(); }
+
+    // Returns the offset of the first LF (or tab) code unit of the
+    // passed block (which must start with a code unit), or -1.
+    int findLineFeed( const char* block, int size ) const;
+    int findTab( const char* block, int size ) const;
+
+  private:
+    Kernel kernel_;
+    CodeUnit unit_;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/literalfinder.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+LiteralFinder::LiteralFinder( const QByteArray& literal, bool case_insensitive )
+    : literal_( literal ), foldMasks_( literal.size(), '\0' )
+{
+    // (ASCII letters only differ in case by 0x20)
+    if ( case_insensitive ) {
+        for ( int i = 0; i < literal_.size(); ++i ) {
+            const char c = literal_[i];
+            if ( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) ) {
+                literal_[i] = c | 0x20;
+                foldMasks_[i] = 0x20;
+            }
+        }
+    }
+}
+
+int LiteralFinder::find( const char* block, int size, int from ) const
+{
+    const int length = literal_.size();
+    if ( length == 0 )
+        return -1;
+
+    // Last offset an occurrence can start at
+    const int last = size - length;
+    int i = qMax( from, 0 );
+
+#ifdef __SSE2__
+    const __m128i first_char = _mm_set1_epi8( literal_[0] );
+    const __m128i first_mask = _mm_set1_epi8( foldMasks_[0] );
+    const __m128i last_char = _mm_set1_epi8( literal_[length - 1] );
+    const __m128i last_mask = _mm_set1_epi8( foldMasks_[length - 1] );
+
+    for ( ; i + 15 <= last; i += 16 ) {
+        const __m128i firsts = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>( block + i ) );
+        const __m128i lasts = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>( block + i + length - 1 ) );
+        int mask = _mm_movemask_epi8( _mm_and_si128(
+                    _mm_cmpeq_epi8( _mm_or_si128( firsts, first_mask ), first_char ),
+                    _mm_cmpeq_epi8( _mm_or_si128( lasts, last_mask ), last_char ) ) );
+        while ( mask ) {
+            const int offset = i + __builtin_ctz( mask );
+            if ( matchesAt( block + offset ) )
+                return offset;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for ( ; i <= last; ++i ) {
+        if ( matchesAt( block + i ) )
+            return i;
+    }
+
+    return -1;
+}
+
+bool LiteralFinder::matchesAt( const char* bytes ) const
+{
+    const char* const literal = literal_.constData();
+    const char* const masks = foldMasks_.constData();
+
+    for ( int i = 0; i < literal_.size(); ++i ) {
+        if ( ( bytes[i] | masks[i] ) != literal[i] )
+            return false;
+    }
+
+    return true;
+}
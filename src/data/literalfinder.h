@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LITERALFINDER_H
+#define LITERALFINDER_H
+
+#include <QByteArray>
+
+// This class looks for a string of ASCII characters in blocks of bytes,
+// optionally ignoring the case of the letters.
+// It is used to find the lines a search can match before running the
+// regular expression on them: the vectorised kernel compares the
+// first and last characters of the string 16 bytes at a time and only
+// checks the whole string where both are found.
+class LiteralFinder
+{
+  public:
+    // An empty finder, which finds nothing
+    LiteralFinder() = default;
+    // Find the passed printable ASCII characters
+    LiteralFinder( const QByteArray& literal, bool case_insensitive );
+
+    bool isEmpty() const { return literal_.isEmpty(); }
+    // Returns the characters looked for (in lower case if the case
+    // is ignored)
+    const QByteArray& literal() const { return literal_; }
+    int size() const { return literal_.size(); }
+
+    // Returns the offset of the first occurrence starting at or after
+    // from in the passed block, or -1
+    int find( const char* block, int size, int from = 0 ) const;
+
+  private:
+    bool matchesAt( const char* bytes ) const;
+
+    QByteArray literal_;
+    // Bits OR-ed to the bytes before comparing them with the literal
+    // (0x20 for the letters whose case is ignored)
+    QByteArray foldMasks_;
+};
+
+#endif
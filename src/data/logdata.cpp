@@ -22,28 +22,37 @@
 #include <iostream>
 
 #include <cassert>
+#include <cstring>
+#include <limits>
 
 #include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include "log.h"
 #include "signal_slot.h"
 
 #include "logdata.h"
 #include "logfiltereddata.h"
+#include "memorygovernor.h"
 #if defined(GLOGG_SUPPORTS_INOTIFY) || defined(GLOGG_SUPPORTS_KQUEUE) || defined(WIN32)
 #include "platformfilewatcher.h"
 #else
 #include "qtfilewatcher.h"
 #endif
 
+const int LogData::fallbackSparseStride = 64;
+// About 40K lines of 100 characters
+const qint64 LogData::lineCacheSize = 8 * 1024 * 1024;
+const int LogData::longLineIndexLines = 16;
+
 // Implementation of the 'start' functions for each operation
 
 void LogData::AttachOperation::doStart(
         LogDataWorkerThread& workerThread ) const
 {
     LOG(logDEBUG) << "Attaching " << filename_.toStdString();
-    workerThread.attachFile( filename_ );
-    workerThread.indexAll();
+    workerThread.attachFile( filename_, compressedFile_ );
+    workerThread.indexAll( true );
 }
 
 void LogData::FullIndexOperation::doStart(
@@ -64,15 +73,24 @@ void LogData::PartialIndexOperation::doStart(
 // Constructs an empty log file.
 // It must be displayed without error.
 LogData::LogData() : AbstractLogData(), indexing_data_(),
-    fileMutex_(), workerThread_( &indexing_data_ )
+    lineCache_( lineCacheSize ), longLines_( longLineIndexLines ),
+    trigramIndex_(), trigramPool_(), trigramInterrupt_( false ),
+    fileLock_(), workerThread_( &indexing_data_ )
 {
     // Start with an "empty" log
     attached_file_ = nullptr;
     currentOperation_ = nullptr;
     nextOperation_    = nullptr;
 
+    updateLatency_ms_    = 0;
+    partialIndexPending_ = false;
+    partialIndexTimer_.setSingleShot( true );
+    CONNECT(&partialIndexTimer_, timeout, this, startPartialIndex);
+
     codec_ = QTextCodec::codecForName( "ISO-8859-1" );
 
+    trigramPool_.setMaxThreadCount( 1 );
+
 #if defined(GLOGG_SUPPORTS_INOTIFY) || defined(GLOGG_SUPPORTS_KQUEUE) || defined(WIN32)
     fileWatcher_ = std::make_shared<PlatformFileWatcher>();
 #else
@@ -85,6 +103,7 @@ LogData::LogData() : AbstractLogData(), indexing_data_(),
     // Forward the update signal
     CONNECT(&workerThread_, indexingProgressed, this, loadingProgressed);
     CONNECT(&workerThread_, indexingFinished, this, indexingFinished);
+    CONNECT(&workerThread_, prefixIndexed, this, prefixIndexed);
 
     // Starts the worker thread
     workerThread_.start();
@@ -92,6 +111,8 @@ LogData::LogData() : AbstractLogData(), indexing_data_(),
 
 LogData::~LogData()
 {
+    stopTrigramIndexing();
+
     // Remove the current file from the watch list
     if ( attached_file_ )
         fileWatcher_->removeFile( attached_file_->fileName() );
@@ -113,10 +134,19 @@ void LogData::attachFile( const QString& fileName )
         throw CantReattachErr();
     }
 
-    attached_file_.reset( new QFile( fileName ) );
-    attached_file_->open( QIODevice::ReadOnly );
+    attached_file_.reset( new PositionalFile( fileName ) );
+    attached_file_->open();
+
+    // Compressed files are decompressed on the fly
+    compressedFile_ = CompressedFile::open( fileName );
 
-    std::shared_ptr<const LogDataOperation> operation( new AttachOperation( fileName ) );
+    if ( memoryMapping_ && ! compressedFile_ ) {
+        QWriteLocker locker( &fileLock_ );
+        mapping_.open( fileName );
+    }
+
+    std::shared_ptr<const LogDataOperation> operation(
+            new AttachOperation( fileName, compressedFile_ ) );
     enqueueOperation( std::move( operation ) );
 }
 
@@ -158,6 +188,34 @@ void LogData::setPollingInterval( uint32_t interval_ms )
     fileWatcher_->setPollingInterval( interval_ms );
 }
 
+void LogData::setUpdateLatency( uint32_t latency_ms )
+{
+    updateLatency_ms_ = latency_ms;
+}
+
+void LogData::setIndexingOptions( const IndexingOptions& options )
+{
+    indexingOptions_ = options;
+    workerThread_.setIndexingOptions( options );
+
+    if ( options.trigramIndex ) {
+        startTrigramIndexing();
+    }
+    else {
+        stopTrigramIndexing();
+        trigramIndex_.clear();
+    }
+
+    QWriteLocker locker( &fileLock_ );
+    if ( options.memoryMapping != memoryMapping_ ) {
+        memoryMapping_ = options.memoryMapping;
+        if ( memoryMapping_ && attached_file_ && ! compressedFile_ )
+            mapping_.open( attached_file_->fileName() );
+        else
+            mapping_.close();
+    }
+}
+
 //
 // Private functions
 //
@@ -188,11 +246,82 @@ void LogData::startOperation()
     {
         LOG(logDEBUG) << "startOperation found something to do.";
 
+        // The lines are not indexed while they change
+        stopTrigramIndexing();
+        if ( ! currentOperation_->keepsLines() )
+            trigramIndex_.clear();
+
         // Let the operation do its stuff
         currentOperation_->start( workerThread_ );
     }
 }
 
+// Index the data added to the file, unless an update is ongoing or has
+// been started less than updateLatency_ms_ ago, in which case it is done
+// (with everything added in the meantime) once it is possible.
+void LogData::schedulePartialIndex()
+{
+    if ( currentOperation_ ) {
+        partialIndexPending_ = true;
+        return;
+    }
+
+    if ( partialIndexTimer_.isActive() )
+        return;
+
+    const qint64 elapsed = lastPartialIndex_.isValid() ?
+        lastPartialIndex_.elapsed() : updateLatency_ms_;
+
+    if ( elapsed >= updateLatency_ms_ )
+        startPartialIndex();
+    else
+        partialIndexTimer_.start( updateLatency_ms_ - elapsed );
+}
+
+// Only the complete file is indexed, so the line numbers are final,
+// as long as no operation changes them (they are not indexed meanwhile).
+// The last line is never indexed, it is completed when the file grows.
+void LogData::startTrigramIndexing()
+{
+    if ( ! indexingOptions_.trigramIndex || currentOperation_
+            || doHasProvisionalLineNumbers()
+            || trigramIndex_.nbBlocks() >= ( doGetNbLine() - 1 ) / TrigramIndex::blockLines )
+        return;
+
+    // (a thread already indexing is restarted, it might have missed the
+    // last lines)
+    stopTrigramIndexing();
+    trigramInterrupt_ = false;
+    QtConcurrent::run( &trigramPool_, [this]() { indexTrigrams(); } );
+}
+
+void LogData::stopTrigramIndexing()
+{
+    trigramInterrupt_ = true;
+    trigramPool_.waitForDone();
+}
+
+void LogData::indexTrigrams()
+{
+    const uint64_t generation = trigramIndex_.generation();
+    qint64 block = trigramIndex_.nbBlocks();
+
+    LOG(logDEBUG) << "Indexing the trigrams from block " << block;
+
+    for ( ; ! trigramInterrupt_; ++block ) {
+        const qint64 first_line = block * TrigramIndex::blockLines;
+        if ( first_line + TrigramIndex::blockLines >= doGetNbLine() )
+            break;
+
+        const RawLines lines = doGetRawLines( first_line, TrigramIndex::blockLines );
+        if ( lines.size() < TrigramIndex::blockLines
+                || ! trigramIndex_.append( generation, block, TrigramIndex::bitmapOf( lines ) ) )
+            break;
+    }
+
+    LOG(logDEBUG) << "Trigrams indexed up to block " << block;
+}
+
 //
 // Slots
 //
@@ -216,7 +345,7 @@ void LogData::fileChangedOnDisk()
     // This is a crude heuristic but necessary for notification services that do not
     // give details (e.g. kqueues)
     if ( ( info.size() != attached_file_->size() )
-            || ( attached_file_->openMode() == QIODevice::NotOpen ) ) {
+            || ( ! attached_file_->isOpen() ) ) {
         LOG(logINFO) << "Inconsistent size, the file might have changed, re-opening";
         reOpenFile();
 
@@ -227,28 +356,45 @@ void LogData::fileChangedOnDisk()
         // and with a size greater than the old one (should be rare in practice).
     }
 
-    std::shared_ptr<LogDataOperation> newOperation;
-
     qint64 real_file_size = attached_file_->size();
-    if ( real_file_size < file_size ) {
+    // A compressed file cannot be indexed partially, any change
+    // is handled as a truncation.
+    const bool truncated = compressedFile_ ?
+        ( real_file_size != compressedFile_->compressedSize() ) :
+        ( real_file_size < file_size );
+    const bool unchanged = compressedFile_ ?
+        ! truncated : ( real_file_size == file_size );
+
+    if ( truncated ) {
         fileChangedOnDisk_ = Truncated;
         LOG(logINFO) << "File truncated";
-        newOperation = std::make_shared<FullIndexOperation>();
+        lineCache_.clear();
+        longLines_.clear();
+
+        // A pending update is superseded by the reindexing
+        partialIndexTimer_.stop();
+        partialIndexPending_ = false;
+
+        enqueueOperation( std::make_shared<FullIndexOperation>() );
+        lastModifiedDate_ = info.lastModified();
+
+        emit fileChanged( fileChangedOnDisk_ );
     }
-    else if ( real_file_size == file_size ) {
+    else if ( unchanged ) {
         LOG(logINFO) << "No change in file";
     }
-    else if ( fileChangedOnDisk_ != DataAdded ) {
-        fileChangedOnDisk_ = DataAdded;
-        LOG(logINFO) << "New data on disk";
-        newOperation = std::make_shared<PartialIndexOperation>();
-    }
-
-    if ( newOperation ) {
-        enqueueOperation( newOperation );
+    else {
+        // All the notifications received until the update is started
+        // are merged in it.
         lastModifiedDate_ = info.lastModified();
+        if ( fileChangedOnDisk_ != DataAdded ) {
+            fileChangedOnDisk_ = DataAdded;
+            LOG(logINFO) << "New data on disk";
 
-        emit fileChanged( fileChangedOnDisk_ );
+            emit fileChanged( fileChangedOnDisk_ );
+        }
+
+        schedulePartialIndex();
     }
 }
 
@@ -258,6 +404,16 @@ void LogData::indexingFinished( LoadingStatus status )
         ( status == LoadingStatus::Successful ) <<
         ", found " << indexing_data_.getNbLines() << " lines.";
 
+    LOG(logDEBUG) << "Decoded line cache: " << lineCache_.hits() << " hits, "
+        << lineCache_.misses() << " misses.";
+
+    // The file might not contain the same lines anymore
+    // (the lines read during the indexing are dropped too)
+    if ( ! ( currentOperation_ && currentOperation_->keepsLines() ) ) {
+        lineCache_.clear();
+        longLines_.clear();
+    }
+
     if ( status == LoadingStatus::Successful ) {
         // Start watching we watch the file for updates
         fileChangedOnDisk_ = Unchanged;
@@ -265,10 +421,24 @@ void LogData::indexingFinished( LoadingStatus status )
 
         // Update the modified date/time if the file exists
         lastModifiedDate_ = QDateTime();
-        QFileInfo fileInfo( *attached_file_ );
+        QFileInfo fileInfo( attached_file_->fileName() );
         if ( fileInfo.exists() )
             lastModifiedDate_ = fileInfo.lastModified();
     }
+    else if ( status == LoadingStatus::NoMemory && ! compressedFile_
+            && indexingOptions_.sparseStride <= 1 ) {
+        // Rather than giving up, we try again with less memory
+        LOG(logWARNING) << "Out of memory, indexing again with a sparse index";
+        MemoryGovernor& governor = MemoryGovernor::get();
+        governor.shrinkTo( governor.memoryUsage() / 2 );
+
+        indexingOptions_.sparseStride = fallbackSparseStride;
+        workerThread_.setIndexingOptions( indexingOptions_ );
+
+        currentOperation_ = std::make_shared<FullIndexOperation>();
+        startOperation();
+        return;
+    }
 
     // FIXME be cleverer here as a notification might have arrived whilst we
     // were indexing.
@@ -277,6 +447,9 @@ void LogData::indexingFinished( LoadingStatus status )
     LOG(logDEBUG) << "Sending indexingFinished.";
     emit loadingFinished( status );
 
+    // The index has grown
+    MemoryGovernor::get().rebalance();
+
     // So now the operation is done, let's see if there is something
     // else to do, in which case, do it!
     assert( currentOperation_ );
@@ -288,6 +461,41 @@ void LogData::indexingFinished( LoadingStatus status )
         LOG(logDEBUG) << "indexingFinished is performing the next operation";
         startOperation();
     }
+    else {
+        startTrigramIndexing();
+    }
+
+    // Data added whilst we were indexing
+    if ( partialIndexPending_ ) {
+        partialIndexPending_ = false;
+        schedulePartialIndex();
+    }
+}
+
+void LogData::prefixIndexed()
+{
+    LOG(logDEBUG) << "prefixIndexed: " << indexing_data_.getNbLines() << " lines.";
+
+    lineCache_.clear();
+    longLines_.clear();
+
+    // The lines we had are now after the beginning of the file
+    emit fileChanged( LinesRenumbered );
+    emit loadingFinished( LoadingStatus::Successful );
+}
+
+void LogData::startPartialIndex()
+{
+    // Never delay an operation already queued
+    if ( currentOperation_ ) {
+        partialIndexPending_ = true;
+        return;
+    }
+
+    LOG(logDEBUG) << "Starting the update";
+
+    lastPartialIndex_.start();
+    enqueueOperation( std::make_shared<PartialIndexOperation>() );
 }
 
 //
@@ -303,11 +511,26 @@ int LogData::doGetMaxLength() const
     return indexing_data_.getMaxLength();
 }
 
+bool LogData::doHasProvisionalLineNumbers() const
+{
+    return indexing_data_.getStartPosition() != 0;
+}
+
 int LogData::doGetLineLength( qint64 line ) const
 {
-    if ( line >= indexing_data_.getNbLines() ) { return 0; /* exception? */ }
+    // (read before the index, see LongLineIndex::put)
+    const uint64_t generation = longLines_.generation();
+    IndexingData::Cursor cursor( indexing_data_ );
+    if ( line >= cursor.getNbLines() ) { return 0; /* exception? */ }
+
+    // The end of a long line is known from its checkpoints
+    const LineDecoder decoder( codec_ );
+    if ( isLongLine( cursor, decoder, line ) ) {
+        const auto checkpoints = lineCheckpoints( cursor, decoder, generation, line );
+        return checkpoints ? checkpoints->back().column : 0;
+    }
 
-    int length = doGetExpandedLineString( line ).length();
+    int length = doGetRawLines( line, 1 ).expandedLength( 0 );
 
     return length;
 }
@@ -376,6 +599,9 @@ void LogData::doSetDisplayEncoding( Encoding encoding )
 
     doSetMultibyteEncodingOffsets( before_cr, after_cr );
     codec_ = QTextCodec::codecForName( qt_encoding );
+    // (after the codec is changed, see DecodedLineCache::put)
+    lineCache_.clear();
+    longLines_.clear();
 }
 
 void LogData::doSetMultibyteEncodingOffsets( int before_cr, int after_cr )
@@ -386,47 +612,37 @@ void LogData::doSetMultibyteEncodingOffsets( int before_cr, int after_cr )
 
 QString LogData::doGetLineString( qint64 line ) const
 {
-    if ( line >= indexing_data_.getNbLines() ) { return 0; /* exception? */ }
-
-    fileMutex_.lock();
+    IndexingData::Cursor cursor( indexing_data_ );
+    if ( line >= cursor.getNbLines() ) { return 0; /* exception? */ }
 
     // end_byte is non-inclusive.(is not read)
-    const qint64 first_byte = (line == 0) ?
-        0 : ( indexing_data_.getPosForLine( line-1 ) + after_cr_offset_ );
-    const qint64 end_byte  = endOfLinePosition( line );
-
-    attached_file_->seek( first_byte );
+    const qint64 first_byte = beginningOfLine( cursor, line );
+    const qint64 end_byte  = endOfLinePosition( cursor, line );
 
-    QString string = codec_->toUnicode( attached_file_->read( end_byte - first_byte ) );
+    const LineDecoder decoder( codec_ );
+    QString string;
+    const bool complete = readRawBytes( first_byte, end_byte, [&]( const char* bytes ) {
+        string = decoder.decode( bytes, end_byte - first_byte );
+    } );
 
-    fileMutex_.unlock();
+    // The file has been truncated under us, the reindexing will follow
+    if ( ! complete )
+        string.clear();
 
     return string;
 }
 
 QString LogData::doGetExpandedLineString( qint64 line ) const
 {
-    if ( line >= indexing_data_.getNbLines() ) { return 0; /* exception? */ }
-
-    fileMutex_.lock();
-
-    // end_byte is non-inclusive.(is not read) We also exclude the final \r.
-    const qint64 first_byte = (line == 0) ?
-        0 : ( indexing_data_.getPosForLine( line-1 ) + after_cr_offset_ );
-    const qint64 end_byte  = endOfLinePosition( line );
-
-    attached_file_->seek( first_byte );
-
-    // LOG(logDEBUG) << "LogData::doGetExpandedLineString first_byte:" << first_byte << " end_byte:" << end_byte;
-    QByteArray rawString = attached_file_->read( end_byte - first_byte );
-
-    fileMutex_.unlock();
-
-    QString string = untabify( codec_->toUnicode( rawString ) );
-
-    // LOG(logDEBUG) << "doGetExpandedLineString Line is: " << string.toStdString();
-
-    return string;
+    touch();
+    // (read before the index, see DecodedLineCache::put)
+    const uint64_t generation = lineCache_.generation();
+    IndexingData::Cursor cursor( indexing_data_ );
+    if ( line >= cursor.getNbLines() ) { return 0; /* exception? */ }
+
+    const qint64 block = line / DecodedLineCache::blockSize;
+    return expandedBlock( cursor, generation, block )
+        .at( line - block * DecodedLineCache::blockSize );
 }
 
 // Note this function is also called from the LogFilteredDataWorker thread, so
@@ -435,6 +651,7 @@ QString LogData::doGetExpandedLineString( qint64 line ) const
 QStringList LogData::doGetLines( qint64 first_line, int number ) const
 {
     QStringList list;
+    touch();
     const qint64 last_line = first_line + number - 1;
 
     // LOG(logDEBUG) << "LogData::doGetLines first_line:" << first_line << " nb:" << number;
@@ -443,32 +660,35 @@ QStringList LogData::doGetLines( qint64 first_line, int number ) const
         return QStringList();
     }
 
-    if ( last_line >= indexing_data_.getNbLines() ) {
+    IndexingData::Cursor cursor( indexing_data_ );
+    if ( last_line >= cursor.getNbLines() ) {
         LOG(logWARNING) << "LogData::doGetLines Lines out of bound asked for";
         return QStringList(); /* exception? */
     }
 
-    fileMutex_.lock();
-
-    const qint64 first_byte = (first_line == 0) ?
-        0 : ( indexing_data_.getPosForLine( first_line-1 ) + after_cr_offset_ );
-    const qint64 end_byte  = endOfLinePosition( last_line );
+    const qint64 first_byte = beginningOfLine( cursor, first_line );
+    const qint64 end_byte  = endOfLinePosition( cursor, last_line );
     // LOG(logDEBUG) << "LogData::doGetLines first_byte:" << first_byte << " end_byte:" << end_byte;
-    attached_file_->seek( first_byte );
-    QByteArray blob = attached_file_->read( end_byte - first_byte );
 
-    fileMutex_.unlock();
-
-    qint64 beginning = 0;
-    qint64 end = 0;
-    for ( qint64 line = first_line; (line <= last_line); line++ ) {
-        end = endOfLinePosition( line ) - first_byte;
-        // LOG(logDEBUG) << "Getting line " << line << " beginning " << beginning << " end " << end;
-        QByteArray this_line = blob.mid( beginning, end - beginning );
-        // LOG(logDEBUG) << "Line is: " << QString( this_line ).toStdString();
-        list.append( codec_->toUnicode( this_line ) );
-        beginning = beginningOfNextLine( end );
-    }
+    const LineDecoder decoder( codec_ );
+    list.reserve( number );
+    const bool complete = readRawBytes( first_byte, end_byte, [&]( const char* blob ) {
+        qint64 beginning = 0;
+        qint64 end = 0;
+        for ( qint64 line = first_line; (line <= last_line); line++ ) {
+            end = endOfLinePosition( cursor, line ) - first_byte;
+            // LOG(logDEBUG) << "Getting line " << line << " beginning " << beginning << " end " << end;
+            list.append( decoder.decode( blob + beginning, end - beginning ) );
+            beginning = beginningOfNextLine( cursor, end );
+        }
+    } );
+
+    if ( ! complete )
+        list.clear();
+
+    // The file has been truncated under us, the reindexing will follow
+    while ( list.size() < number )
+        list.append( QString() );
 
     return list;
 }
@@ -476,69 +696,438 @@ QStringList LogData::doGetLines( qint64 first_line, int number ) const
 QStringList LogData::doGetExpandedLines( qint64 first_line, int number ) const
 {
     QStringList list;
+    touch();
     const qint64 last_line = first_line + number - 1;
 
     if ( number == 0 ) {
         return QStringList();
     }
 
-    if ( last_line >= indexing_data_.getNbLines() ) {
+    // (read before the index, see DecodedLineCache::put)
+    const uint64_t generation = lineCache_.generation();
+    IndexingData::Cursor cursor( indexing_data_ );
+    if ( last_line >= cursor.getNbLines() ) {
         LOG(logWARNING) << "LogData::doGetExpandedLines Lines out of bound asked for";
         return QStringList(); /* exception? */
     }
 
-    fileMutex_.lock();
+    list.reserve( number );
+    const int block_size = DecodedLineCache::blockSize;
+    for ( qint64 block = first_line / block_size;
+            block <= last_line / block_size; ++block ) {
+        const QStringList lines = expandedBlock( cursor, generation, block );
+        const qint64 block_first_line = block * block_size;
+        const int begin = qMax( first_line, block_first_line ) - block_first_line;
+        const int end = qMin( last_line + 1, block_first_line + lines.size() )
+            - block_first_line;
+        list.append( lines.mid( begin, end - begin ) );
+    }
+
+    return list;
+}
+
+// The long lines are read from their checkpoints, the others are cut
+// from the expanded lines.
+QString LogData::doGetExpandedLineWindow( qint64 line,
+        int first_column, int nb_columns ) const
+{
+    touch();
+    const uint64_t generation = longLines_.generation();
+    IndexingData::Cursor cursor( indexing_data_ );
+    if ( line >= cursor.getNbLines() ) { return 0; /* exception? */ }
+
+    const LineDecoder decoder( codec_ );
+    if ( isLongLine( cursor, decoder, line ) )
+        return readLineWindow( cursor, decoder, generation, line,
+                first_column, nb_columns );
+    else
+        return doGetExpandedLineString( line ).mid( first_column, nb_columns );
+}
+
+QStringList LogData::doGetExpandedLineWindows( qint64 first_line, int number,
+        int first_column, int nb_columns ) const
+{
+    QStringList list;
+    touch();
+    const qint64 end_line = first_line + number;
+
+    const uint64_t generation = longLines_.generation();
+    IndexingData::Cursor cursor( indexing_data_ );
+    if ( end_line > cursor.getNbLines() ) {
+        LOG(logWARNING) << "LogData::doGetExpandedLineWindows Lines out of bound asked for";
+        return QStringList(); /* exception? */
+    }
+
+    const LineDecoder decoder( codec_ );
+    bool has_long_lines = false;
+    for ( qint64 line = first_line; line < end_line && ! has_long_lines; ++line )
+        has_long_lines = isLongLine( cursor, decoder, line );
+
+    // Usual case, through the cache
+    if ( ! has_long_lines )
+        return AbstractLogData::doGetExpandedLineWindows(
+                first_line, number, first_column, nb_columns );
+
+    // Otherwise, the runs of short lines are read directly, not by blocks
+    // which would include the long lines.
+    list.reserve( number );
+    qint64 line = first_line;
+    while ( line < end_line ) {
+        qint64 end_of_run = line;
+        while ( end_of_run < end_line && ! isLongLine( cursor, decoder, end_of_run ) )
+            ++end_of_run;
+
+        if ( end_of_run > line ) {
+            const QStringList lines = readExpandedLines( cursor, line, end_of_run - line );
+            for ( const QString& expanded_line : lines )
+                list.append( expanded_line.mid( first_column, nb_columns ) );
+            // (the file has been truncated under us)
+            if ( lines.isEmpty() )
+                break;
+            line = end_of_run;
+        }
+        else {
+            list.append( readLineWindow( cursor, decoder, generation, line,
+                        first_column, nb_columns ) );
+            ++line;
+        }
+    }
 
-    // end_byte is non-inclusive.(is not read)
-    const qint64 first_byte = (first_line == 0) ?
-        0 : ( indexing_data_.getPosForLine( first_line-1 ) + after_cr_offset_ );
-    const qint64 end_byte  = endOfLinePosition( last_line );
-    LOG(logDEBUG) << "LogData::doGetExpandedLines first_byte:" << first_byte << " end_byte:" << end_byte;
-
-    attached_file_->seek( first_byte );
-    QByteArray blob = attached_file_->read( end_byte - first_byte );
-
-    fileMutex_.unlock();
-
-    qint64 beginning = 0;
-    qint64 end = 0;
-    for ( qint64 line = first_line; (line <= last_line); line++ ) {
-        // end is non-inclusive
-        // LOG(logDEBUG) << "EoL " << line << ": " << indexing_data_.getPosForLine( line );
-        end = endOfLinePosition( line ) - first_byte;
-        // LOG(logDEBUG) << "Getting line " << line << " beginning " << beginning << " end " << end;
-        QByteArray this_line = blob.mid( beginning, end - beginning );
-        QString conv_line = codec_->toUnicode( this_line );
-        // LOG(logDEBUG) << "Line is: " << conv_line.toStdString();
-        list.append( untabify( conv_line ) );
-        beginning = beginningOfNextLine( end );
+    // The file has been truncated under us, the reindexing will follow
+    while ( list.size() < number )
+        list.append( QString() );
+
+    return list;
+}
+
+// Only the encodings whose columns can be counted on the bytes can be
+// read by windows.
+bool LogData::isLongLine( IndexingData::Cursor& cursor,
+        const LineDecoder& decoder, qint64 line ) const
+{
+    return decoder.countsColumns() && endOfLinePosition( cursor, line )
+        - beginningOfLine( cursor, line ) > LongLineIndex::longLineSize;
+}
+
+// Returns the checkpoints of the passed line, computing them if they are
+// not known, or null if the file cannot be read.
+std::shared_ptr<const LongLineIndex::Checkpoints> LogData::lineCheckpoints(
+        IndexingData::Cursor& cursor, const LineDecoder& decoder,
+        uint64_t generation, qint64 line ) const
+{
+    auto checkpoints = longLines_.get( line );
+    if ( checkpoints )
+        return checkpoints;
+
+    const qint64 line_begin = beginningOfLine( cursor, line );
+    const qint64 line_end  = endOfLinePosition( cursor, line );
+
+    auto new_checkpoints = std::make_shared<LongLineIndex::Checkpoints>();
+    new_checkpoints->push_back( { 0, 0 } );
+
+    // A stride at a time, plus the end of the character it cuts,
+    // the line is never held in memory.
+    qint64 offset = 0;
+    int column = 0;
+    while ( line_begin + offset < line_end ) {
+        const qint64 piece_begin = line_begin + offset;
+        const qint64 piece_end = qMin( line_end, piece_begin + LongLineIndex::stride + 3 );
+        int piece_size = 0;
+        const bool complete = readRawBytes( piece_begin, piece_end, [&]( const char* bytes ) {
+            const int size = piece_end - piece_begin;
+            piece_size = decoder.nextCharacter( bytes, size,
+                    qMin( size, LongLineIndex::stride ) );
+            decoder.skipColumns( bytes, piece_size, &column,
+                    std::numeric_limits<int>::max() );
+        } );
+
+        if ( ! complete )
+            return nullptr;
+
+        offset += piece_size;
+        new_checkpoints->push_back( { offset, column } );
     }
 
+    // The last line is not kept as it might not be complete yet
+    if ( line + 1 < cursor.getNbLines() )
+        longLines_.put( generation, line, new_checkpoints );
+
+    return new_checkpoints;
+}
+
+// Read the columns [first_column, first_column + nb_columns) of a long
+// line, from the closest checkpoint before them.
+QString LogData::readLineWindow( IndexingData::Cursor& cursor,
+        const LineDecoder& decoder, uint64_t generation,
+        qint64 line, int first_column, int nb_columns ) const
+{
+    const auto checkpoints = lineCheckpoints( cursor, decoder, generation, line );
+    if ( ! checkpoints || first_column >= checkpoints->back().column )
+        return QString();
+
+    const LongLineIndex::Checkpoint from =
+        LongLineIndex::closest( *checkpoints, first_column );
+
+    // About a stride to skip to the first column, then at most 4 bytes
+    // per column (plus the ends of the characters cut by both).
+    const qint64 max_window_bytes = 4LL * ( nb_columns + 1 );
+    const qint64 begin = beginningOfLine( cursor, line ) + from.offset;
+    const qint64 end = qMin( endOfLinePosition( cursor, line ),
+            begin + LongLineIndex::stride + max_window_bytes + 6 );
+
+    QString window;
+    const bool complete = readRawBytes( begin, end, [&]( const char* bytes ) {
+        const int size = end - begin;
+        int column = from.column;
+        const int skipped = decoder.skipColumns( bytes, size, &column, first_column );
+        const int window_end = decoder.nextCharacter( bytes, size,
+                qMin<qint64>( size, skipped + max_window_bytes ) );
+
+        // (the first column might be in the middle of a tab)
+        window = decoder.decodeExpanded( bytes + skipped, window_end - skipped, column )
+            .mid( first_column - column, nb_columns );
+    } );
+
+    // (the file has been truncated under us)
+    if ( ! complete )
+        window.clear();
+
+    return window;
+}
+
+// Returns the lines of the passed block from the cache, or reads them
+// and caches them if they cannot change anymore.
+// The lines missing because the file has been truncated are empty.
+QStringList LogData::expandedBlock( IndexingData::Cursor& cursor,
+        uint64_t generation, qint64 block ) const
+{
+    QStringList lines;
+    if ( lineCache_.get( block, &lines ) )
+        return lines;
+
+    const qint64 nb_lines = cursor.getNbLines();
+    const qint64 first_line = block * DecodedLineCache::blockSize;
+    const int number = qMin<qint64>( DecodedLineCache::blockSize, nb_lines - first_line );
+
+    lines = readExpandedLines( cursor, first_line, number );
+
+    // The last line is not cached as it might not be complete yet
+    if ( lines.size() == number && first_line + number < nb_lines )
+        lineCache_.put( generation, block, lines );
+
+    // The file has been truncated under us, the reindexing will follow
+    while ( lines.size() < number )
+        lines.append( QString() );
+
+    return lines;
+}
+
+// Read the lines from the file, returns less of them if they cannot
+// all be read.
+QStringList LogData::readExpandedLines( IndexingData::Cursor& cursor,
+        qint64 first_line, int number ) const
+{
+    QStringList list;
+    const qint64 last_line = first_line + number - 1;
+
+    // end_byte is non-inclusive.(is not read)
+    const qint64 first_byte = beginningOfLine( cursor, first_line );
+    const qint64 end_byte  = endOfLinePosition( cursor, last_line );
+    LOG(logDEBUG) << "LogData::readExpandedLines first_byte:" << first_byte << " end_byte:" << end_byte;
+
+    const LineDecoder decoder( codec_ );
+    list.reserve( number );
+    const bool complete = readRawBytes( first_byte, end_byte, [&]( const char* blob ) {
+        qint64 beginning = 0;
+        qint64 end = 0;
+        for ( qint64 line = first_line; (line <= last_line); line++ ) {
+            // end is non-inclusive
+            // LOG(logDEBUG) << "EoL " << line << ": " << indexing_data_.getPosForLine( line );
+            end = endOfLinePosition( cursor, line ) - first_byte;
+            // LOG(logDEBUG) << "Getting line " << line << " beginning " << beginning << " end " << end;
+            // (decoded and untabified in one pass)
+            list.append( decoder.decodeExpanded( blob + beginning, end - beginning ) );
+            beginning = beginningOfNextLine( cursor, end );
+        }
+    } );
+
+    // (interrupted halfway)
+    if ( ! complete )
+        list.clear();
+
     return list;
 }
 
+// The lines are copied at once in a buffer, and not decoded.
+RawLines LogData::doGetRawLines( qint64 first_line, int number ) const
+{
+    RawLines lines( codec_ );
+    touch();
+    const qint64 last_line = first_line + number - 1;
+
+    if ( number == 0 ) {
+        return lines;
+    }
+
+    IndexingData::Cursor cursor( indexing_data_ );
+    if ( last_line >= cursor.getNbLines() ) {
+        LOG(logWARNING) << "LogData::doGetRawLines Lines out of bound asked for";
+        return lines; /* exception? */
+    }
+
+    const qint64 first_byte = beginningOfLine( cursor, first_line );
+    const qint64 end_byte  = endOfLinePosition( cursor, last_line );
+
+    // (the buffer is shared with the lines, not copied)
+    QByteArray buffer;
+    if ( readRawBytes( first_byte, end_byte, &buffer ) ) {
+        lines.setBuffer( buffer );
+        qint64 beginning = 0;
+        for ( qint64 line = first_line; line <= last_line; line++ ) {
+            const qint64 end = endOfLinePosition( cursor, line ) - first_byte;
+            lines.addLine( beginning, end );
+            beginning = beginningOfNextLine( cursor, end );
+        }
+    }
+
+    // The file has been truncated under us, the reindexing will follow
+    while ( lines.size() < number )
+        lines.addLine( 0, 0 );
+
+    return lines;
+}
+
+// The trigrams are those of the bytes, they only contain the ones of
+// the ASCII characters of the lines with these encodings.
+bool LogData::mayContainTrigrams( qint64 line,
+        const TrigramIndex::Trigrams& trigrams ) const
+{
+    return trigrams.empty() || ! LineDecoder( codec_ ).isAsciiCompatible()
+        || trigramIndex_.mayContain( line / TrigramIndex::blockLines, trigrams );
+}
+
 EncodingSpeculator::Encoding LogData::getDetectedEncoding() const
 {
     return indexing_data_.getEncodingGuess();
 }
 
+// Given a line number, returns the position (offset in file) of
+// its first byte.
+qint64 LogData::beginningOfLine( IndexingData::Cursor& cursor, qint64 line ) const
+{
+    if ( line == 0 ) {
+        // Only the tail of the file might be indexed so far
+        const qint64 start = cursor.getStartPosition();
+        return ( start == 0 ) ? 0 : start + afterLineFeed( cursor );
+    }
+
+    return cursor.getPosForLine( line-1 ) + afterLineFeed( cursor );
+}
+
 // Given a line number, returns the position (offset in file) of
 // the byte immediately past its end.
 // e.g. in utf-16: T e s t \n2 n d l i n e \n
 //                 --------------------------
 //                           ^
 //                   endOfLinePosition( 0 )
-qint64 LogData::endOfLinePosition( qint64 line ) const
+qint64 LogData::endOfLinePosition( IndexingData::Cursor& cursor, qint64 line ) const
 {
-    return indexing_data_.getPosForLine( line ) - 1 - before_cr_offset_;
+    return cursor.getPosForLine( line ) - 1 - beforeLineFeed( cursor );
 }
 
 // Given the position (offset in file) of the end of a line, returns
 // the position of the beginning of the following, taking into account
 // encoding and newline signalling.
-qint64 LogData::beginningOfNextLine( qint64 end_pos ) const
+qint64 LogData::beginningOfNextLine( IndexingData::Cursor& cursor,
+        qint64 end_pos ) const
+{
+    return end_pos + 1 + beforeLineFeed( cursor ) + afterLineFeed( cursor );
+}
+
+// A file indexed by UTF-16 code units has its end of lines right
+// after the two bytes of the LF, whatever its byte order.
+int LogData::beforeLineFeed( const IndexingData::Cursor& cursor ) const
+{
+    return ( cursor.getCodeUnit() == LineScanner::CodeUnit::Byte ) ?
+        before_cr_offset_ : 1;
+}
+
+int LogData::afterLineFeed( const IndexingData::Cursor& cursor ) const
+{
+    return ( cursor.getCodeUnit() == LineScanner::CodeUnit::Byte ) ?
+        after_cr_offset_ : 0;
+}
+
+// Calls the passed function with the bytes [first_byte, end_byte) of the
+// file, read in place from the mapping if there is one or from the file.
+// Returns false if they cannot all be read (the file has been truncated),
+// in which case the function might have been called with zeros instead
+// of the missing bytes (what it has done must be discarded).
+bool LogData::readRawBytes( qint64 first_byte, qint64 end_byte,
+        const std::function<void( const char* )>& function ) const
+{
+    if ( ! compressedFile_ ) {
+        QReadLocker locker( &fileLock_ );
+        // (decoded in place, the mapping cannot change while we hold
+        // the lock)
+        if ( isMapped( &locker, first_byte, end_byte ) )
+            return mapping_.access( first_byte, end_byte - first_byte, function );
+    }
+
+    // (decoded outside of the lock)
+    QByteArray blob;
+    if ( ! readRawBytes( first_byte, end_byte, &blob ) )
+        return false;
+
+    function( blob.constData() );
+    return true;
+}
+
+// Returns the bytes [first_byte, end_byte) of the file in bytes, copied
+// from the mapping if there is one or read (or decompressed) straight
+// into it, or false if they cannot all be read.
+bool LogData::readRawBytes( qint64 first_byte, qint64 end_byte,
+        QByteArray* bytes ) const
+{
+    // (CompressedFile does its own locking)
+    if ( compressedFile_ )
+        return compressedFile_->read( first_byte, end_byte, bytes );
+
+    const qint64 length = end_byte - first_byte;
+    *bytes = QByteArray( length, Qt::Uninitialized );
+
+    QReadLocker locker( &fileLock_ );
+    if ( isMapped( &locker, first_byte, end_byte ) )
+        return mapping_.access( first_byte, length, [&]( const char* data ) {
+            std::memcpy( bytes->data(), data, length );
+        } );
+    else
+        return attached_file_->read( first_byte, length, bytes->data() );
+}
+
+// Returns true if the bytes [first_byte, end_byte) can be read from the
+// mapping, which is extended first if the file has grown (or mapped
+// again if it has been truncated) since it was mapped.
+// The passed lock is released meanwhile, as the other readers must
+// be out of the mapping.
+bool LogData::isMapped( QReadLocker* locker,
+        qint64 first_byte, qint64 end_byte ) const
 {
-    return end_pos + 1 + before_cr_offset_ + after_cr_offset_;
+    if ( ! memoryMapping_ )
+        return false;
+
+    if ( end_byte > mapping_.size() || mapping_.isTruncated() ) {
+        locker->unlock();
+        {
+            QWriteLocker write_locker( &fileLock_ );
+            if ( end_byte > mapping_.size() || mapping_.isTruncated() )
+                mapping_.remap();
+        }
+        locker->relock();
+    }
+
+    // (the options might have changed while unlocked)
+    return memoryMapping_ && mapping_.contains( first_byte, end_byte - first_byte );
 }
 
 // Close and reopen the file.
@@ -546,10 +1135,12 @@ qint64 LogData::beginningOfNextLine( qint64 end_pos ) const
 // inode but really want the one now associated with the name)
 void LogData::reOpenFile()
 {
-    auto reopened = std::make_unique<QFile>( attached_file_->fileName() );
-    reopened->open( QIODevice::ReadOnly );
-    QMutexLocker locker( &fileMutex_ );
+    auto reopened = std::make_unique<PositionalFile>( attached_file_->fileName() );
+    reopened->open();
+    QWriteLocker locker( &fileLock_ );
     attached_file_ = std::move( reopened );      // This will close the old one and open the new
+    if ( memoryMapping_ && ! compressedFile_ )
+        mapping_.open( attached_file_->fileName() );
 }
 
 QString LogData::attachedFilename() const
@@ -558,3 +1149,40 @@ QString LogData::attachedFilename() const
         return attached_file_->fileName();
     return QString();
 }
+
+qint64 LogData::memoryUsage() const
+{
+    return indexing_data_.memoryUsage()
+        + lineCache_.memoryUsage()
+        + trigramIndex_.memoryUsage()
+        + ( compressedFile_ ? compressedFile_->memoryUsage() : 0 );
+}
+
+void LogData::releaseMemory( Release level )
+{
+    switch ( level ) {
+        case Release::Caches:
+            indexing_data_.dropCaches();
+            lineCache_.clear();
+            longLines_.clear();
+            if ( compressedFile_ )
+                compressedFile_->dropCache();
+            break;
+        case Release::Compact:
+            // The index is always compact
+            break;
+        case Release::Sparse:
+            // Blocks are read again from the file, so it cannot be
+            // compressed, and the worker must not be changing the index
+            if ( attached_file_ && ! compressedFile_ && ! currentOperation_
+                    && indexing_data_.makeSparse( attached_file_->fileName(),
+                        fallbackSparseStride, indexingOptions_.sparseCachedBlocks ) ) {
+                LOG(logINFO) << "Index of " << attached_file_->fileName().toStdString()
+                    << " made sparse to save memory";
+                // Keep it sparse when reindexing
+                indexingOptions_.sparseStride = fallbackSparseStride;
+                workerThread_.setIndexingOptions( indexingOptions_ );
+            }
+            break;
+    }
+}
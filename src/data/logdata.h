@@ -20,22 +20,33 @@
 #ifndef LOGDATA_H
 #define LOGDATA_H
 
+#include <atomic>
+#include <functional>
 #include <memory>
 
 #include <QObject>
 #include <QString>
 #include <QFile>
 #include <QVector>
-#include <QMutex>
+#include <QReadWriteLock>
 #include <QDateTime>
 #include <QTextCodec>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QThreadPool>
 
 #include "utils.h"
 
 #include "abstractlogdata.h"
 #include "logdataworkerthread.h"
+#include "mappedfile.h"
+#include "positionalfile.h"
 #include "filewatcher.h"
 #include "loadingstatus.h"
+#include "memorygovernor.h"
+#include "decodedlinecache.h"
+#include "longlineindex.h"
+#include "trigramindex.h"
 
 class LogFilteredData;
 
@@ -44,7 +55,7 @@ class CantReattachErr {};
 
 // Represents a complete set of data to be displayed (ie. a log file content)
 // This class is thread-safe.
-class LogData : public AbstractLogData {
+class LogData : public AbstractLogData, public MemoryConsumer {
   Q_OBJECT
 
   public:
@@ -53,7 +64,9 @@ class LogData : public AbstractLogData {
     // Destroy an object
     ~LogData();
 
-    enum MonitoredFileStatus { Unchanged, DataAdded, Truncated };
+    // LinesRenumbered is sent when the beginning of a file indexed
+    // tail-first has been indexed.
+    enum MonitoredFileStatus { Unchanged, DataAdded, Truncated, LinesRenumbered };
 
     // Attaches the LogData to a file on disk
     // It starts the asynchronous indexing and returns (almost) immediately
@@ -77,12 +90,40 @@ class LogData : public AbstractLogData {
 
     // Update the polling interval (in ms, 0 means disabled)
     void setPollingInterval( uint32_t interval_ms );
+    // Set the minimum delay between two updates when data are added
+    // to the file (in ms, 0 means as soon as notified), the growth
+    // notified in between is indexed in one go.
+    void setUpdateLatency( uint32_t latency_ms );
+
+    // Set the tunables used by the next indexing operations
+    void setIndexingOptions( const IndexingOptions& options );
 
     // Get the auto-detected encoding for the indexed text.
     EncodingSpeculator::Encoding getDetectedEncoding() const;
 
     QString attachedFilename() const;
 
+    // MemoryConsumer interface (the index can be made sparse)
+    qint64 memoryUsage() const override;
+    void releaseMemory( Release level ) override;
+
+    // Stride of the index when it has to be made sparse to save memory
+    static const int fallbackSparseStride;
+    // Maximum memory used by the decoded line cache (in bytes)
+    static const qint64 lineCacheSize;
+    // Number of long lines whose checkpoints are kept
+    static const int longLineIndexLines;
+
+    // Cache of the expanded lines, shared by all the views
+    const DecodedLineCache& decodedLineCache() const { return lineCache_; }
+
+    // Returns whether the block of lines of the trigram index containing
+    // the passed line might contain all the passed trigrams (always true
+    // if it is not indexed yet, or the encoding doesn't allow it).
+    // Can be called by any thread.
+    bool mayContainTrigrams( qint64 line,
+            const TrigramIndex::Trigrams& trigrams ) const;
+
   signals:
     // Sent during the 'attach' process to signal progress
     // percent being the percentage of completion.
@@ -98,6 +139,10 @@ class LogData : public AbstractLogData {
     void fileChangedOnDisk();
     // Called when the worker thread signals the current operation ended
     void indexingFinished( LoadingStatus status );
+    // Index the data added since the last update
+    void startPartialIndex();
+    // Called when the worker thread has indexed the beginning of the file
+    void prefixIndexed();
 
   private:
     // This class models an indexing operation.
@@ -112,6 +157,8 @@ class LogData : public AbstractLogData {
         void start( LogDataWorkerThread& workerThread ) const
         { doStart( workerThread ); }
         const QString& getFilename() const { return filename_; }
+        // Whether the lines already indexed are left as they are
+        virtual bool keepsLines() const { return false; }
 
       protected:
         virtual void doStart( LogDataWorkerThread& workerThread ) const = 0;
@@ -121,12 +168,17 @@ class LogData : public AbstractLogData {
     // Attaching a new file (change name + full index)
     class AttachOperation : public LogDataOperation {
       public:
-        AttachOperation( const QString& fileName )
-            : LogDataOperation( fileName ) {}
+        AttachOperation( const QString& fileName,
+                std::shared_ptr<CompressedFile> compressedFile )
+            : LogDataOperation( fileName ),
+            compressedFile_( std::move( compressedFile ) ) {}
         ~AttachOperation() {};
 
       protected:
         void doStart( LogDataWorkerThread& workerThread ) const;
+
+      private:
+        std::shared_ptr<CompressedFile> compressedFile_;
     };
 
     // Reindexing the current file
@@ -145,6 +197,8 @@ class LogData : public AbstractLogData {
         PartialIndexOperation() : LogDataOperation( QString() ) {}
         ~PartialIndexOperation() {};
 
+        bool keepsLines() const override { return true; }
+
       protected:
         void doStart( LogDataWorkerThread& workerThread ) const;
     };
@@ -157,41 +211,107 @@ class LogData : public AbstractLogData {
     QString doGetExpandedLineString( qint64 line ) const override;
     QStringList doGetLines( qint64 first, int number ) const override;
     QStringList doGetExpandedLines( qint64 first, int number ) const override;
+    RawLines doGetRawLines( qint64 first, int number ) const override;
+    QString doGetExpandedLineWindow( qint64 line,
+            int first_column, int nb_columns ) const override;
+    QStringList doGetExpandedLineWindows( qint64 first_line, int number,
+            int first_column, int nb_columns ) const override;
     qint64 doGetNbLine() const override;
     int doGetMaxLength() const override;
     int doGetLineLength( qint64 line ) const override;
+    bool doHasProvisionalLineNumbers() const override;
     void doSetDisplayEncoding( Encoding encoding ) override;
     void doSetMultibyteEncodingOffsets( int before_cr, int after_cr ) override;
 
     void enqueueOperation( std::shared_ptr<const LogDataOperation> newOperation );
     void startOperation();
     void reOpenFile();
-
-    qint64 endOfLinePosition( qint64 line ) const;
-    qint64 beginningOfNextLine( qint64 end_pos ) const;
+    void schedulePartialIndex();
+    // Index the trigrams of the blocks of lines not indexed yet, in the
+    // background, if enabled and no operation is ongoing
+    void startTrigramIndexing();
+    // Interrupt the background indexing of the trigrams and wait for it
+    void stopTrigramIndexing();
+    // (run by trigramPool_)
+    void indexTrigrams();
+    bool readRawBytes( qint64 first_byte, qint64 end_byte,
+            const std::function<void( const char* )>& function ) const;
+    bool readRawBytes( qint64 first_byte, qint64 end_byte,
+            QByteArray* bytes ) const;
+    bool isMapped( QReadLocker* locker, qint64 first_byte, qint64 end_byte ) const;
+
+    QStringList expandedBlock( IndexingData::Cursor& cursor,
+            uint64_t generation, qint64 block ) const;
+    QStringList readExpandedLines( IndexingData::Cursor& cursor,
+            qint64 first_line, int number ) const;
+    bool isLongLine( IndexingData::Cursor& cursor,
+            const LineDecoder& decoder, qint64 line ) const;
+    std::shared_ptr<const LongLineIndex::Checkpoints> lineCheckpoints(
+            IndexingData::Cursor& cursor, const LineDecoder& decoder,
+            uint64_t generation, qint64 line ) const;
+    QString readLineWindow( IndexingData::Cursor& cursor,
+            const LineDecoder& decoder, uint64_t generation,
+            qint64 line, int first_column, int nb_columns ) const;
+
+    // (the positions are read with the passed cursor)
+    qint64 beginningOfLine( IndexingData::Cursor& cursor, qint64 line ) const;
+    qint64 endOfLinePosition( IndexingData::Cursor& cursor, qint64 line ) const;
+    qint64 beginningOfNextLine( IndexingData::Cursor& cursor,
+            qint64 end_pos ) const;
+    // Bytes of the LF code unit before and after the position of the
+    // end of lines (a UTF-16 index points after the whole LF)
+    int beforeLineFeed( const IndexingData::Cursor& cursor ) const;
+    int afterLineFeed( const IndexingData::Cursor& cursor ) const;
 
     QString indexingFileName_;
-    std::unique_ptr<QFile> attached_file_;
+    // (read by any number of threads at once)
+    std::unique_ptr<PositionalFile> attached_file_;
+    // Mapping of the attached file, used instead of it
+    // to read lines if memoryMapping_ is set.
+    mutable MappedFile mapping_;
+    bool memoryMapping_ = IndexingOptions().memoryMapping;
+    // Last passed to the worker thread
+    IndexingOptions indexingOptions_;
+    // Used instead of both if the file is compressed
+    std::shared_ptr<CompressedFile> compressedFile_;
 
     // Indexing data, read by us, written by the worker thread
     IndexingData indexing_data_;
+    // Lines returned by doGetExpandedLines(s)
+    mutable DecodedLineCache lineCache_;
+    // Checkpoints of the long lines, read by windows
+    mutable LongLineIndex longLines_;
+    // Trigrams of the blocks of lines, indexed in the background
+    // by a single thread once the whole file has been indexed
+    TrigramIndex trigramIndex_;
+    QThreadPool trigramPool_;
+    std::atomic<bool> trigramInterrupt_;
 
     QDateTime lastModifiedDate_;
     std::shared_ptr<const LogDataOperation> currentOperation_;
     std::shared_ptr<const LogDataOperation> nextOperation_;
 
+    // Coalescing of the updates
+    uint32_t updateLatency_ms_;
+    QTimer partialIndexTimer_;
+    QElapsedTimer lastPartialIndex_;
+    // Data have been added during the current operation
+    bool partialIndexPending_;
+
     // Codec to decode text
     QTextCodec* codec_;
 
     // Offset to apply to the newline character
+    // (when the file has been indexed by bytes)
     int before_cr_offset_ = 0;
     int after_cr_offset_  = 0;
 
-    // To protect the file:
-    mutable QMutex fileMutex_;
+    // To protect the file (and its mapping): the readers lock it for
+    // reading, so they do not wait for each other, and it is locked
+    // for writing to replace the file or change the mapping.
+    mutable QReadWriteLock fileLock_;
     // (are mutable to allow 'const' function to touch it,
     // while remaining const)
-    // When acquiring both, data should be help before locking file.
 
     LogDataWorkerThread workerThread_;
 };
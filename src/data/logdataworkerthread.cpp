@@ -17,50 +17,161 @@
  * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+#include <deque>
+
 #include <QFile>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include "log.h"
 
 #include "logdata.h"
 #include "logdataworkerthread.h"
+#include "blockreader.h"
+#include "indexcache.h"
+#include "linescanner.h"
 #include "signal_slot.h"
 
 // Size of the chunk to read (5 MiB)
 const int IndexOperation::sizeChunk = 5*1024*1024;
+// Save the index in the cache every 512 MiB
+const qint64 IndexOperation::checkpointInterval = 512*1024*1024;
+
+// Small enough for the tail to be copied quickly by each change
+const int IndexingData::segmentSize = 16 * 1024;
+
+// The entries are only set once, by the snapshot which has reserved
+// them by incrementing nbUsed (the others only read the ones before).
+struct IndexingData::SegmentDirectory
+{
+    explicit SegmentDirectory( size_t capacity )
+        : entries( new std::shared_ptr<const Segment>[ capacity ] ),
+        capacity( capacity ), nbUsed( 0 ) {}
+
+    std::unique_ptr<std::shared_ptr<const Segment>[]> entries;
+    const size_t capacity;
+    std::atomic<size_t> nbUsed;
+};
+
+IndexingData::IndexingData()
+    : writeMutex_(), snapshot_(),
+    sparseFileName_(), sparseStride_( 0 ), sparseCachedBlocks_( 0 ),
+    codeUnit_( LineScanner::CodeUnit::Byte ), eliasFano_( false )
+{
+    publish( emptySnapshot() );
+}
 
 qint64 IndexingData::getSize() const
 {
-    QMutexLocker locker( &dataMutex_ );
+    return snapshot()->indexedSize;
+}
 
-    return indexedSize_;
+qint64 IndexingData::getStartPosition() const
+{
+    return snapshot()->startPosition;
 }
 
 int IndexingData::getMaxLength() const
 {
-    QMutexLocker locker( &dataMutex_ );
-
-    return maxLength_;
+    return snapshot()->maxLength;
 }
 
 LineNumber IndexingData::getNbLines() const
 {
-    QMutexLocker locker( &dataMutex_ );
-
-    return linePosition_.size();
+    return snapshot()->nbLines;
 }
 
 qint64 IndexingData::getPosForLine( LineNumber line ) const
 {
-    QMutexLocker locker( &dataMutex_ );
+    return posForLine( *snapshot(), line );
+}
+
+IndexingData::Cursor::Cursor( const IndexingData& indexing_data )
+    : indexing_data_( indexing_data ), snapshot_( indexing_data.snapshot() ),
+    segment_( -1 ), segmentCursor_()
+{
+}
+
+LineNumber IndexingData::Cursor::getNbLines() const
+{
+    return snapshot_->nbLines;
+}
+
+qint64 IndexingData::Cursor::getStartPosition() const
+{
+    return snapshot_->startPosition;
+}
 
-    return linePosition_.at( line );
+LineScanner::CodeUnit IndexingData::Cursor::getCodeUnit() const
+{
+    return snapshot_->codeUnit;
+}
+
+qint64 IndexingData::Cursor::getPosForLine( LineNumber line )
+{
+    const size_t segment = line / segmentSize;
+
+    if ( snapshot_->sparse || segment >= snapshot_->nbSegments
+            || ! snapshot_->segments->entries[segment]->compressed() )
+        return indexing_data_.posForLine( *snapshot_, line );
+
+    if ( static_cast<int>( segment ) != segment_ ) {
+        segmentCursor_.reset( new LinePositionArray::Cursor(
+                    *snapshot_->segments->entries[segment]->compressed() ) );
+        segment_ = static_cast<int>( segment );
+    }
+
+    return segmentCursor_->at( line % segmentSize );
+}
+
+bool IndexingData::isSparse() const
+{
+    return snapshot()->sparse != nullptr;
 }
 
 EncodingSpeculator::Encoding IndexingData::getEncodingGuess() const
 {
-    QMutexLocker locker( &dataMutex_ );
+    const std::shared_ptr<const Snapshot> current = snapshot();
+    const EncodingSpeculator::Encoding encoding = current->encoding;
+    const EncodingSpeculator::Encoding prefix_encoding = current->prefixEncoding;
+
+    // If the beginning of the file has been indexed separately, the
+    // guesses are combined (the BOM, if any, is in the beginning).
+    switch ( prefix_encoding ) {
+        case EncodingSpeculator::Encoding::ASCII7:
+            return encoding;
+        case EncodingSpeculator::Encoding::UTF16LE:
+        case EncodingSpeculator::Encoding::UTF16BE:
+            return prefix_encoding;
+        default:
+            if ( encoding == EncodingSpeculator::Encoding::ASCII7
+                    || encoding == prefix_encoding )
+                return prefix_encoding;
+            else
+                return EncodingSpeculator::Encoding::ASCII8;
+    }
+}
 
-    return encoding_;
+LineScanner::CodeUnit IndexingData::getCodeUnit() const
+{
+    return snapshot()->codeUnit;
+}
+
+void IndexingData::setCodeUnit( LineScanner::CodeUnit unit )
+{
+    QMutexLocker locker( &writeMutex_ );
+
+    codeUnit_ = unit;
+
+    publish( emptySnapshot() );
+}
+
+void IndexingData::setEliasFano( bool enabled )
+{
+    QMutexLocker locker( &writeMutex_ );
+
+    eliasFano_ = enabled;
 }
 
 void IndexingData::addAll( qint64 size, int length,
@@ -68,21 +179,276 @@ void IndexingData::addAll( qint64 size, int length,
         EncodingSpeculator::Encoding encoding )
 
 {
-    QMutexLocker locker( &dataMutex_ );
+    QMutexLocker locker( &writeMutex_ );
 
-    indexedSize_  += size;
-    maxLength_     = qMax( maxLength_, length );
-    linePosition_.append_list( linePosition );
+    std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>( *snapshot() );
+    next->indexedSize += size;
+    next->maxLength    = qMax( next->maxLength, length );
+    appendLines( next.get(), linePosition );
+    next->encoding     = encoding;
 
-    encoding_      = encoding;
+    publish( std::move( next ) );
 }
 
 void IndexingData::clear()
 {
-    maxLength_   = 0;
-    indexedSize_ = 0;
-    linePosition_ = LinePositionArray();
-    encoding_    = EncodingSpeculator::Encoding::ASCII7;
+    QMutexLocker locker( &writeMutex_ );
+
+    publish( emptySnapshot() );
+}
+
+void IndexingData::setSparse( const QString& fileName, int stride,
+        int nbCachedBlocks )
+{
+    QMutexLocker locker( &writeMutex_ );
+
+    sparseFileName_     = fileName;
+    sparseStride_       = ( stride > 1 ) ? stride : 0;
+    sparseCachedBlocks_ = nbCachedBlocks;
+
+    publish( emptySnapshot() );
+}
+
+bool IndexingData::makeSparse( const QString& fileName, int stride,
+        int nbCachedBlocks )
+{
+    QMutexLocker locker( &writeMutex_ );
+
+    const std::shared_ptr<const Snapshot> current = snapshot();
+    if ( current->sparse || current->startPosition != 0 || stride <= 1 )
+        return false;
+
+    sparseFileName_     = fileName;
+    sparseStride_       = stride;
+    sparseCachedBlocks_ = nbCachedBlocks;
+
+    std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>( *current );
+    next->segments.reset();
+    next->nbSegments     = 0;
+    next->tail           = std::make_shared<FastLinePositionArray>();
+    next->segmentsMemory = 0;
+    next->sparse         = std::make_shared<SparseLinePositionArray>(
+            fileName, stride, nbCachedBlocks, current->codeUnit );
+
+    // Copied by chunks so we do not need much more memory
+    // than we are going to free
+    const LineNumber chunk_size = 64 * 1024;
+    Cursor cursor( *this );
+    for ( LineNumber i = 0; i < current->nbLines; i += chunk_size ) {
+        const LineNumber chunk_end = qMin( i + chunk_size, current->nbLines );
+        FastLinePositionArray chunk;
+        for ( LineNumber j = i; j < chunk_end; ++j )
+            chunk.append( cursor.getPosForLine( j ) );
+        if ( chunk_end == current->nbLines )
+            chunk.setFakeFinalLF( current->tail->hasFakeFinalLF() );
+        next->sparse->append_list( chunk );
+    }
+    next->tail    = next->sparse->tail();
+    next->nbLines = next->sparse->size();
+
+    publish( std::move( next ) );
+
+    return true;
+}
+
+void IndexingData::dropCaches()
+{
+    const std::shared_ptr<const Snapshot> current = snapshot();
+
+    if ( current->sparse )
+        current->sparse->dropCachedBlocks();
+}
+
+qint64 IndexingData::memoryUsage() const
+{
+    const std::shared_ptr<const Snapshot> current = snapshot();
+
+    if ( current->sparse )
+        return current->sparse->memoryUsage();
+
+    qint64 usage = current->segmentsMemory + current->tail->memoryUsage();
+    if ( current->segments )
+        usage += current->segments->capacity * sizeof( std::shared_ptr<const Segment> );
+
+    return usage;
+}
+
+void IndexingData::startAt( qint64 position )
+{
+    QMutexLocker locker( &writeMutex_ );
+
+    std::shared_ptr<Snapshot> next = emptySnapshot();
+    next->indexedSize   = position;
+    next->startPosition = position;
+
+    publish( std::move( next ) );
+}
+
+void IndexingData::splicePrefix( IndexingData* prefix )
+{
+    QMutexLocker locker( &writeMutex_ );
+
+    const std::shared_ptr<const Snapshot> current = snapshot();
+
+    // Our lines are appended to the prefix (there are usually
+    // a lot less of them), whose segments are shared
+    FastLinePositionArray lines;
+    Cursor cursor( *this );
+    for ( LineNumber i = 0; i < current->nbLines; ++i )
+        lines.append( cursor.getPosForLine( i ) );
+    lines.setFakeFinalLF( current->tail->hasFakeFinalLF() );
+
+    std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>( *prefix->snapshot() );
+    appendLines( next.get(), lines );
+    next->indexedSize    = current->indexedSize;
+    next->maxLength      = qMax( current->maxLength, next->maxLength );
+    next->prefixEncoding = next->encoding;
+    next->encoding       = current->encoding;
+    next->startPosition  = 0;
+    next->codeUnit       = current->codeUnit;
+
+    publish( std::move( next ) );
+}
+
+std::shared_ptr<const IndexingData::Snapshot> IndexingData::snapshot() const
+{
+    return std::atomic_load( &snapshot_ );
+}
+
+void IndexingData::publish( std::shared_ptr<const Snapshot> snapshot )
+{
+    std::atomic_store( &snapshot_, std::move( snapshot ) );
+}
+
+std::shared_ptr<IndexingData::Snapshot> IndexingData::emptySnapshot() const
+{
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+
+    snapshot->tail     = std::make_shared<FastLinePositionArray>();
+    snapshot->codeUnit = codeUnit_;
+    if ( sparseStride_ > 1 )
+        snapshot->sparse = std::make_shared<SparseLinePositionArray>(
+                sparseFileName_, sparseStride_, sparseCachedBlocks_, codeUnit_ );
+
+    return snapshot;
+}
+
+void IndexingData::appendLines( Snapshot* snapshot,
+        const FastLinePositionArray& linePosition ) const
+{
+    if ( snapshot->sparse ) {
+        snapshot->sparse->append_list( linePosition );
+        snapshot->tail    = snapshot->sparse->tail();
+        snapshot->nbLines = snapshot->sparse->size();
+        return;
+    }
+
+    // The current tail (without its fake final LF) followed
+    // by the new lines
+    const FastLinePositionArray& tail = *snapshot->tail;
+    const int tail_size = tail.size() - ( tail.hasFakeFinalLF() ? 1 : 0 );
+    std::vector<uint64_t> lines;
+    lines.reserve( tail_size + linePosition.size() );
+    for ( int i = 0; i < tail_size; ++i )
+        lines.push_back( tail.at( i ) );
+    for ( int i = 0; i < linePosition.size(); ++i )
+        lines.push_back( linePosition.at( i ) );
+
+    // The full segments are moved out of the tail, always
+    // leaving the last line in it
+    const size_t segment_size = segmentSize;
+    size_t first = 0;
+    while ( lines.size() - first > segment_size ) {
+        std::shared_ptr<const Segment> segment =
+            std::make_shared<const Segment>( &lines[first], eliasFano_ );
+        snapshot->segmentsMemory += segment->memoryUsage();
+        appendSegment( snapshot, std::move( segment ) );
+        first += segment_size;
+    }
+
+    std::shared_ptr<FastLinePositionArray> new_tail =
+        std::make_shared<FastLinePositionArray>();
+    for ( size_t i = first; i < lines.size(); ++i )
+        new_tail->append( lines[i] );
+    new_tail->setFakeFinalLF( linePosition.hasFakeFinalLF() );
+
+    snapshot->tail    = std::move( new_tail );
+    snapshot->nbLines = snapshot->nbSegments * segment_size
+        + snapshot->tail->size();
+}
+
+void IndexingData::appendSegment( Snapshot* snapshot,
+        std::shared_ptr<const Segment> segment )
+{
+    const size_t nb_segments = snapshot->nbSegments;
+
+    size_t expected = nb_segments;
+    if ( ! ( snapshot->segments && nb_segments < snapshot->segments->capacity
+                && snapshot->segments->nbUsed.compare_exchange_strong(
+                    expected, nb_segments + 1 ) ) ) {
+        auto segments = std::make_shared<SegmentDirectory>(
+                qMax<size_t>( 16, 2 * ( nb_segments + 1 ) ) );
+        for ( size_t i = 0; i < nb_segments; ++i )
+            segments->entries[i] = snapshot->segments->entries[i];
+        segments->nbUsed = nb_segments + 1;
+        snapshot->segments = std::move( segments );
+    }
+
+    snapshot->segments->entries[ nb_segments ] = std::move( segment );
+    snapshot->nbSegments = nb_segments + 1;
+}
+
+qint64 IndexingData::posForLine( const Snapshot& snapshot, LineNumber line ) const
+{
+    if ( snapshot.sparse ) {
+        // (the complete blocks are never changed, only the tail)
+        const LineNumber tail_beginning = snapshot.nbLines - snapshot.tail->size();
+        if ( line < tail_beginning )
+            return snapshot.sparse->at( line );
+        else
+            return snapshot.tail->at( line - tail_beginning );
+    }
+
+    const size_t segment = line / segmentSize;
+    if ( segment < snapshot.nbSegments )
+        return snapshot.segments->entries[segment]->at( line % segmentSize );
+    else
+        return snapshot.tail->at( line - snapshot.nbSegments * segmentSize );
+}
+
+IndexingData::Segment::Segment( const uint64_t* positions, bool elias_fano )
+    : compressed_(), eliasFano_(), isEliasFano_( false )
+{
+    for ( int i = 0; i < segmentSize; ++i )
+        compressed_.append( positions[i] );
+
+    // Elias-Fano usually takes less memory, but not for lines of a few
+    // tens of bytes, which the default coding stores on a byte each
+    if ( elias_fano ) {
+        for ( int i = 0; i < segmentSize; ++i )
+            eliasFano_.append( positions[i] );
+
+        isEliasFano_ = eliasFano_.memoryUsage() <= compressed_.memoryUsage();
+        if ( isEliasFano_ )
+            compressed_ = LinePositionArray();
+        else
+            eliasFano_ = EliasFanoLinePositionArray();
+    }
+}
+
+uint64_t IndexingData::Segment::at( int i ) const
+{
+    return isEliasFano_ ? eliasFano_.at( i ) : compressed_.at( i );
+}
+
+size_t IndexingData::Segment::memoryUsage() const
+{
+    return isEliasFano_ ? eliasFano_.memoryUsage() : compressed_.memoryUsage();
+}
+
+const LinePositionArray* IndexingData::Segment::compressed() const
+{
+    return isEliasFano_ ? nullptr : &compressed_;
 }
 
 LogDataWorkerThread::LogDataWorkerThread( IndexingData* indexing_data )
@@ -91,6 +457,7 @@ LogDataWorkerThread::LogDataWorkerThread( IndexingData* indexing_data )
 {
     terminate_          = false;
     interruptRequested_ = false;
+    prefixInterruptRequested_ = false;
     operationRequested_ = NULL;
 }
 
@@ -102,16 +469,49 @@ LogDataWorkerThread::~LogDataWorkerThread()
         operationRequestedCond_.wakeAll();
     }
     wait();
+
+    stopPrefixIndexing();
 }
 
-void LogDataWorkerThread::attachFile( const QString& fileName )
+void LogDataWorkerThread::attachFile( const QString& fileName,
+        std::shared_ptr<CompressedFile> compressedFile )
 {
     QMutexLocker locker( &mutex_ );  // to protect fileName_
 
     fileName_ = fileName;
+    compressedFile_ = std::move( compressedFile );
+    // (the positions in a compressed file are not checked by the cache)
+    if ( ! compressedFile_ )
+        indexCache_.reset( new IndexCache( fileName ) );
+}
+
+// Called with mutex_ held
+void LogDataWorkerThread::startPrefixIndexing( qint64 prefix_size )
+{
+    LOG(logDEBUG) << "Indexing the first " << prefix_size << " bytes in the background";
+
+    QMutexLocker options_locker( &optionsMutex_ );
+
+    const QString file_name = fileName_;
+    const IndexingOptions options = options_;
+
+    prefixInterruptRequested_ = false;
+    prefixIndexing_ = QtConcurrent::run( [=]() {
+        PrefixIndexOperation operation( file_name, options, prefix_size,
+                indexing_data_, &prefixInterruptRequested_ );
+        if ( operation.start() )
+            emit prefixIndexed();
+    } );
+}
+
+// Called with mutex_ held (or the thread finished)
+void LogDataWorkerThread::stopPrefixIndexing()
+{
+    prefixInterruptRequested_ = true;
+    prefixIndexing_.waitForFinished();
 }
 
-void LogDataWorkerThread::indexAll()
+void LogDataWorkerThread::indexAll( bool from_cache )
 {
     QMutexLocker locker( &mutex_ );  // to protect operationRequested_
 
@@ -121,8 +521,15 @@ void LogDataWorkerThread::indexAll()
     while ( (operationRequested_ != NULL) )
         nothingToDoCond_.wait( &mutex_ );
 
+    // The index is going to be rebuilt
+    stopPrefixIndexing();
+
+    QMutexLocker options_locker( &optionsMutex_ );
+
     interruptRequested_ = false;
-    operationRequested_ = new FullIndexOperation( fileName_,
+    operationRequested_ = new FullIndexOperation( fileName_, options_,
+            options_.indexCache ? indexCache_.get() : nullptr, from_cache,
+            compressedFile_.get(),
             indexing_data_, &interruptRequested_, &encodingSpeculator_ );
     operationRequestedCond_.wakeAll();
 }
@@ -137,12 +544,23 @@ void LogDataWorkerThread::indexAdditionalLines()
     while ( (operationRequested_ != NULL) )
         nothingToDoCond_.wait( &mutex_ );
 
+    QMutexLocker options_locker( &optionsMutex_ );
+
     interruptRequested_ = false;
-    operationRequested_ = new PartialIndexOperation( fileName_,
+    operationRequested_ = new PartialIndexOperation( fileName_, options_,
+            options_.indexCache ? indexCache_.get() : nullptr,
+            compressedFile_.get(),
             indexing_data_, &interruptRequested_, &encodingSpeculator_ );
     operationRequestedCond_.wakeAll();
 }
 
+void LogDataWorkerThread::setIndexingOptions( const IndexingOptions& options )
+{
+    QMutexLocker locker( &optionsMutex_ );
+
+    options_ = options;
+}
+
 void LogDataWorkerThread::interrupt()
 {
     LOG(logDEBUG) << "Load interrupt requested";
@@ -174,6 +592,10 @@ void LogDataWorkerThread::run()
                 if ( operationRequested_->start() ) {
                     LOG(logDEBUG) << "... finished copy in workerThread.";
                     emit indexingFinished( LoadingStatus::Successful );
+
+                    const qint64 prefix_size = operationRequested_->unindexedPrefix();
+                    if ( prefix_size > 0 )
+                        startPrefixIndexing( prefix_size );
                 }
                 else {
                     emit indexingFinished( LoadingStatus::Interrupted );
@@ -196,9 +618,13 @@ void LogDataWorkerThread::run()
 //
 
 IndexOperation::IndexOperation( const QString& fileName,
+        const IndexingOptions& options, IndexCache* indexCache,
+        CompressedFile* compressedFile,
         IndexingData* indexingData, bool* interruptRequest,
         EncodingSpeculator* encodingSpeculator )
-    : fileName_( fileName )
+    : fileName_( fileName ), options_( options ),
+    index_cache_( indexCache ), compressed_file_( compressedFile ),
+    lastCheckpoint_( 0 ), scanner_()
 {
     interruptRequest_ = interruptRequest;
     indexing_data_ = indexingData;
@@ -208,70 +634,111 @@ IndexOperation::IndexOperation( const QString& fileName,
 void IndexOperation::doIndex( IndexingData* indexing_data,
         EncodingSpeculator* encoding_speculator, qint64 initialPosition )
 {
+    if ( compressed_file_ ) {
+        doIndexCompressed( indexing_data, encoding_speculator );
+        return;
+    }
+
     qint64 pos = initialPosition; // Absolute position of the start of current line
-    qint64 end = 0;               // Absolute position of the end of current line
     int additional_spaces = 0;    // Additional spaces due to tabs
 
+    scanner_ = LineScanner( LineScanner::bestKernel(), indexing_data->getCodeUnit() );
+
     QFile file( fileName_ );
     if ( file.open( QIODevice::ReadOnly ) ) {
+        // If possible the blocks are scanned in place in the mapping
+        // of the file, they are neither read nor copied, and the next
+        // one is paged in by the OS while one is scanned.
+        MappedFile mapping;
+        if ( options_.memoryMapping ) {
+            mapping.open( fileName_ );
+            mapping.adviseSequential();
+        }
+
+        // Otherwise they are read ahead in another thread, while
+        // the previous ones are scanned.
+        std::unique_ptr<BlockReader> reader;
+
+        // The bulk of a big file is shared between several threads,
+        // the sequential loop below then finishes the job (including
+        // what might have been added to the file in the meantime)
+        qint64 read_position = initialPosition;
+        const qint64 end_position = file.size();
+        if ( options_.nbThreads > 1
+                && ( end_position - read_position ) > 2 * sizeChunk ) {
+            doParallelIndex( indexing_data, encoding_speculator,
+                    mapping.isMapped() ? &mapping : nullptr, end_position,
+                    &read_position, &pos, &additional_spaces );
+        }
+
         // Count the number of lines and max length
         // (read big chunks to speed up reading from disk)
-        file.seek( pos );
-        while ( !file.atEnd() ) {
+        while ( read_position < file.size() ) {
             FastLinePositionArray line_positions;
             int max_length = 0;
 
             if ( *interruptRequest_ )   // a bool is always read/written atomically isn't it?
                 break;
 
-            // Read a chunk of 5MB
-            const qint64 block_beginning = file.pos();
-            const QByteArray block = file.read( sizeChunk );
+            // Read a chunk of 5MB (the reader adapts its size)
+            const qint64 block_beginning = read_position;
+            if ( options_.memoryMapping && ! reader
+                    && ! mapping.contains( block_beginning, 1 ) )
+                mapping.remap();    // The file has grown
+
+            // (once started, the reader is used until the end)
+            const bool mapped = ! reader && mapping.contains( block_beginning, 1 );
+            QByteArray block;
+            int size;
+            if ( mapped ) {
+                size = qMin<qint64>( sizeChunk, mapping.size() - block_beginning );
+            }
+            else {
+                if ( ! reader )
+                    reader.reset( new BlockReader( fileName_, block_beginning, sizeChunk ) );
+                block = reader->nextBlock();
+                size = block.size();
+            }
+
+            // (a code unit cut at the end is read again with the next block)
+            const int scanned = scanner_.alignedSize( size );
+            if ( scanned == 0 )
+                break;
+            if ( scanned < size )
+                reader.reset();     // (restarted from the cut code unit)
 
             // Count the number of lines in each chunk
-            qint64 pos_within_block = 0;
-            while ( pos_within_block != -1 ) {
-                pos_within_block = qMax( pos - block_beginning, 0LL);
-                // Looking for the next \n, expanding tabs in the process
-                do {
-                    if ( pos_within_block < block.length() ) {
-                        const char c = block.at(pos_within_block);
-                        encoding_speculator->inject_byte( c );
-                        if ( c == '\n' )
-                            break;
-                        else if ( c == '\t' )
-                            additional_spaces += AbstractLogData::tabStop -
-                                ( ( ( block_beginning - pos ) + pos_within_block
-                                    + additional_spaces ) % AbstractLogData::tabStop ) - 1;
-
-                        pos_within_block++;
-                    }
-                    else {
-                        pos_within_block = -1;
-                    }
-                } while ( pos_within_block != -1 );
-
-                // When a end of line has been found...
-                if ( pos_within_block != -1 ) {
-                    end = pos_within_block + block_beginning;
-                    const int length = end-pos + additional_spaces;
-                    if ( length > max_length )
-                        max_length = length;
-                    pos = end + 1;
-                    additional_spaces = 0;
-                    line_positions.append( pos );
-                }
+            const auto scan = [&]( const char* data ) {
+                encoding_speculator->inject_block( data, scanned );
+                scanBlock( data, scanned, block_beginning,
+                        &pos, &additional_spaces, &max_length, &line_positions );
+            };
+            if ( mapped )
+                mapping.adviseWillNeed( block_beginning + scanned, sizeChunk );
+
+            if ( ! mapped )
+                scan( block.constData() );
+            else if ( ! mapping.access( block_beginning, scanned, scan ) ) {
+                // Truncated under us, a full reindex will follow
+                LOG(logWARNING) << "File truncated during indexing";
+                break;
             }
 
             // Update the shared data
-            indexing_data->addAll( block.length(), max_length, line_positions,
+            indexing_data->addAll( scanned, max_length, line_positions,
                    encoding_speculator->guess() );
+            read_position += scanned;
+            checkpoint( *indexing_data );
 
             // Update the caller for progress indication
             int progress = ( file.size() > 0 ) ? pos*100 / file.size() : 100;
             emit indexingProgressed( progress );
         }
 
+        // Save what has been indexed, even if interrupted
+        if ( index_cache_ && file.size() >= IndexCache::minFileSize )
+            index_cache_->save( *indexing_data );
+
         // Check if there is a non LF terminated line at the end of the file
         qint64 file_size = file.size();
         if ( !*interruptRequest_ && file_size > pos ) {
@@ -279,7 +746,7 @@ void IndexOperation::doIndex( IndexingData* indexing_data,
                 "Non LF terminated file, adding a fake end of line";
 
             FastLinePositionArray line_position;
-            line_position.append( file_size + 1 );
+            line_position.append( file_size + scanner_.unitSize() );
             line_position.setFakeFinalLF();
 
             indexing_data->addAll( 0, 0, line_position, encoding_speculator->guess() );
@@ -294,6 +761,298 @@ void IndexOperation::doIndex( IndexingData* indexing_data,
     }
 }
 
+// The file is decompressed (in the worker thread) and the decompressed
+// blocks are scanned as they come.
+void IndexOperation::doIndexCompressed( IndexingData* indexing_data,
+        EncodingSpeculator* encoding_speculator )
+{
+    qint64 pos = 0;
+    int additional_spaces = 0;
+    qint64 read_position = 0;
+    // Beginning of a code unit cut at the end of the previous block
+    QByteArray carry;
+
+    compressed_file_->index( [&]( const char* data, int length, int progress ) {
+        if ( *interruptRequest_ )
+            return false;
+
+        // The code units are known from the first bytes decompressed
+        if ( read_position == 0 && carry.isEmpty() ) {
+            indexing_data->setCodeUnit( LineScanner::codeUnitOf( data, length ) );
+            scanner_ = LineScanner( LineScanner::bestKernel(),
+                    indexing_data->getCodeUnit() );
+        }
+
+        QByteArray block = QByteArray::fromRawData( data, length );
+        if ( ! carry.isEmpty() )
+            block = carry + block;
+        const int scanned = scanner_.alignedSize( block.size() );
+        carry = block.mid( scanned );
+
+        FastLinePositionArray line_positions;
+        int max_length = 0;
+
+        encoding_speculator->inject_block( block.constData(), scanned );
+        scanBlock( block.constData(), scanned, read_position,
+                &pos, &additional_spaces, &max_length, &line_positions );
+
+        indexing_data->addAll( scanned, max_length, line_positions,
+                encoding_speculator->guess() );
+        read_position += scanned;
+
+        emit indexingProgressed( progress );
+        return true;
+    } );
+
+    // Check if there is a non LF terminated line at the end of the file
+    // (including a code unit cut by its end, if any)
+    read_position += carry.size();
+    if ( !*interruptRequest_ && read_position > pos ) {
+        LOG( logDEBUG ) <<
+            "Non LF terminated file, adding a fake end of line";
+
+        FastLinePositionArray line_position;
+        line_position.append( read_position + scanner_.unitSize() );
+        line_position.setFakeFinalLF();
+
+        indexing_data->addAll( carry.size(), 0, line_position,
+                encoding_speculator->guess() );
+    }
+}
+
+// Look for the end of lines in [read_position, end_position) using
+// a pool of threads, each scanning one chunk of the file.
+// The chunks are merged in order in the indexing data as soon as they
+// are available, read_position, pos and additional_spaces are updated
+// exactly as the sequential loop would have.
+void IndexOperation::doParallelIndex( IndexingData* indexing_data,
+        EncodingSpeculator* encoding_speculator,
+        const MappedFile* mapping, qint64 end_position,
+        qint64* read_position, qint64* pos, int* additional_spaces )
+{
+    LOG(logDEBUG) << "Parallel indexing on " << options_.nbThreads
+        << " threads up to " << end_position;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount( options_.nbThreads );
+
+    // Only a few chunks are read in advance to bound memory usage
+    const int max_in_flight = 2 * options_.nbThreads;
+    std::deque<QFuture<std::shared_ptr<ChunkIndex>>> in_flight;
+
+    const QString file_name = fileName_;
+    const bool* interrupt_request = interruptRequest_;
+    const LineScanner scanner = scanner_;
+    const int unit_size = scanner.unitSize();
+    qint64 next_chunk = *read_position;
+
+    while ( !in_flight.empty() || next_chunk < end_position ) {
+        while ( ( in_flight.size() < static_cast<size_t>( max_in_flight ) )
+                && ( next_chunk < end_position ) && !*interruptRequest_ ) {
+            const qint64 beginning = next_chunk;
+            const qint64 length = qMin<qint64>( sizeChunk, end_position - next_chunk );
+            in_flight.push_back( QtConcurrent::run( &pool, [=]() {
+                return indexChunk( scanner, file_name, mapping, beginning, length,
+                        interrupt_request );
+            } ) );
+            next_chunk += length;
+        }
+
+        if ( in_flight.empty() )
+            break;
+
+        const std::shared_ptr<ChunkIndex> chunk = in_flight.front().result();
+        in_flight.pop_front();
+
+        // (only whole code units are merged, the end of a chunk cut
+        // in the middle of one is left to the caller)
+        const int scanned = scanner.alignedSize( chunk->size );
+
+        // (the bytes of a mapped chunk are read again in place, which
+        // fails if the file has been truncated since)
+        const auto inject = [&]( const char* data ) {
+            encoding_speculator->inject_block( data, scanned );
+        };
+        bool injected = false;
+        if ( ! *interruptRequest_ && ( chunk->beginning == *read_position ) ) {
+            if ( chunk->mapped )
+                injected = mapping->access( chunk->beginning, scanned, inject );
+            else {
+                inject( chunk->block.constData() );
+                injected = true;
+            }
+        }
+
+        if ( ! injected ) {
+            // Interrupted, or the file has shrunk under us: we let the
+            // in-flight chunks finish and leave the rest to the caller.
+            next_chunk = end_position;
+            continue;
+        }
+
+        // Now we know where the line spanning the beginning of the
+        // chunk started, we can complete it.
+        const int column = ( chunk->beginning - *pos ) / unit_size + *additional_spaces;
+        const int head_length = chunk->headLength( column );
+        int max_length = 0;
+        if ( chunk->head_end == -1 ) {
+            // The whole chunk is in the middle of a line
+            *additional_spaces += head_length - scanned / unit_size;
+        }
+        else {
+            max_length = qMax( column + head_length, chunk->max_length );
+            *pos = chunk->tail_beginning;
+            *additional_spaces = chunk->tail_additional_spaces;
+        }
+
+        indexing_data->addAll( scanned, max_length,
+                chunk->line_positions, encoding_speculator->guess() );
+        *read_position = chunk->beginning + scanned;
+        checkpoint( *indexing_data );
+
+        const int progress = ( end_position > 0 ) ?
+            ( chunk->beginning + scanned ) * 100 / end_position : 100;
+        emit indexingProgressed( progress );
+    }
+}
+
+void IndexOperation::checkpoint( const IndexingData& indexing_data )
+{
+    if ( index_cache_
+            && indexing_data.getSize() - lastCheckpoint_ >= checkpointInterval ) {
+        index_cache_->save( indexing_data );
+        lastCheckpoint_ = indexing_data.getSize();
+    }
+}
+
+// Called in a pool thread, index the chunk at beginning of the
+// passed file (in place in the mapping if there is one).
+// The chunk is scanned as if a line started at its first byte, the
+// actual length of this first line is only calculated by headLength
+// once the column at which it starts is known.
+std::shared_ptr<IndexOperation::ChunkIndex> IndexOperation::indexChunk(
+        const LineScanner& scanner, const QString& fileName,
+        const MappedFile* mapping, qint64 beginning, qint64 length,
+        const bool* interruptRequest )
+{
+    auto chunk = std::make_shared<ChunkIndex>();
+    chunk->beginning = beginning;
+    chunk->unit_size = scanner.unitSize();
+
+    if ( *interruptRequest )
+        return chunk;
+
+    if ( mapping && mapping->contains( beginning, length ) ) {
+        chunk->mapped = true;
+        chunk->size = length;
+        if ( ! mapping->access( beginning, length, [&]( const char* data ) {
+                    scanChunk( scanner, data, chunk.get() );
+                } ) ) {
+            // Truncated under us, the merge will stop at this chunk
+            auto truncated = std::make_shared<ChunkIndex>();
+            truncated->beginning = beginning;
+            truncated->unit_size = chunk->unit_size;
+            return truncated;
+        }
+    }
+    else {
+        QFile file( fileName );
+        if ( file.open( QIODevice::ReadOnly ) ) {
+            file.seek( beginning );
+            chunk->block = file.read( length );
+        }
+        chunk->size = chunk->block.size();
+        scanChunk( scanner, chunk->block.constData(), chunk.get() );
+    }
+
+    return chunk;
+}
+
+// Find the head and lines of the passed chunk, whose bytes are data.
+void IndexOperation::scanChunk( const LineScanner& scanner,
+        const char* data, ChunkIndex* chunk )
+{
+    const qint64 beginning = chunk->beginning;
+    const int size = scanner.alignedSize( chunk->size );
+    const int unit_size = scanner.unitSize();
+
+    const int lf = scanner.findLineFeed( data, size );
+    const int head_size = ( lf >= 0 ) ? lf : size;
+
+    // The tabs in the head are expanded starting at column 0, only the
+    // first one depends on the real starting column.
+    const int tab = scanner.findTab( data, head_size );
+    if ( tab >= 0 ) {
+        chunk->head_first_tab = tab / unit_size;
+        // (the rest of the head is scanned as a line starting at column 0)
+        const int after_tab = tab + unit_size;
+        qint64 pos = beginning + after_tab;
+        int additional_spaces = 0;
+        int max_length = 0;
+        FastLinePositionArray no_lines;
+        scanner.scan( data + after_tab, head_size - after_tab, pos,
+                &pos, &additional_spaces, &max_length, &no_lines );
+        chunk->head_width_after_tab =
+            ( head_size - after_tab ) / unit_size + additional_spaces;
+    }
+
+    if ( lf >= 0 ) {
+        chunk->head_end = beginning + head_size;
+        chunk->line_positions.append( chunk->head_end + unit_size );
+
+        // The other lines are complete and can be scanned as usual
+        qint64 pos = chunk->head_end + unit_size;
+        int additional_spaces = 0;
+        scanner.scan( data, size, beginning,
+                &pos, &additional_spaces, &chunk->max_length, &chunk->line_positions );
+
+        chunk->tail_beginning = pos;
+        chunk->tail_additional_spaces = additional_spaces;
+    }
+}
+
+// Expanded length of the head of the chunk if it starts at the
+// passed column.
+int IndexOperation::ChunkIndex::headLength( int column ) const
+{
+    const int head_size = ( ( head_end == -1 ) ?
+        size - size % unit_size : head_end - beginning )
+        / unit_size;
+
+    if ( head_first_tab == -1 )
+        return head_size;
+
+    const int tab_column = column + head_first_tab;
+    const int after_tab = tab_column
+        + AbstractLogData::tabStop - ( tab_column % AbstractLogData::tabStop );
+
+    return ( after_tab - column ) + head_width_after_tab;
+}
+
+// Scans the passed block (whose first byte is at block_beginning in the file)
+// for end of lines using the fastest kernel the CPU supports.
+void IndexOperation::scanBlock( const char* block, int size, qint64 block_beginning,
+        qint64* pos, int* additional_spaces, int* max_length,
+        FastLinePositionArray* line_positions ) const
+{
+    scanner_.scan( block, size, block_beginning,
+            pos, additional_spaces, max_length, line_positions );
+}
+
+// Returns the code units of the lines of our file (from its BOM)
+LineScanner::CodeUnit IndexOperation::fileCodeUnit() const
+{
+    if ( compressed_file_ )
+        return LineScanner::CodeUnit::Byte;
+
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return LineScanner::CodeUnit::Byte;
+
+    const QByteArray beginning = file.read( 2 );
+    return LineScanner::codeUnitOf( beginning.constData(), beginning.size() );
+}
+
 // Called in the worker thread's context
 bool FullIndexOperation::start()
 {
@@ -304,10 +1063,41 @@ bool FullIndexOperation::start()
 
     emit indexingProgressed( 0 );
 
-    // First empty the index
-    indexing_data_->clear();
+    // First empty the index (choosing whether it is sparse, a compressed
+    // file cannot be read where a sparse index would need it)
+    indexing_data_->setEliasFano( options_.eliasFanoIndex );
+    indexing_data_->setSparse( fileName_,
+            compressed_file_ ? 0 : options_.sparseStride,
+            options_.sparseCachedBlocks );
+    // and the code units it is made of (known once decompressing
+    // for a compressed file)
+    indexing_data_->setCodeUnit( fileCodeUnit() );
+
+    // Then start from the cached one if possible
+    qint64 initial_position = 0;
+    bool loaded = false;
+    if ( index_cache_ ) {
+        if ( fromCache_ && index_cache_->load( indexing_data_ ) ) {
+            initial_position = indexing_data_->getSize();
+            encoding_speculator_->resume( indexing_data_->getEncodingGuess() );
+            loaded = true;
+        }
+        else {
+            index_cache_->clear();
+        }
+    }
+
+    // or from the tail of the file, the rest is indexed later
+    unindexedPrefix_ = loaded ? 0 : findTailStart();
+    if ( unindexedPrefix_ > 0 ) {
+        LOG(logDEBUG) << "FullIndexOperation: Indexing from the tail at "
+            << unindexedPrefix_;
+        indexing_data_->startAt( unindexedPrefix_ );
+        initial_position = unindexedPrefix_;
+    }
+    lastCheckpoint_ = initial_position;
 
-    doIndex( indexing_data_, encoding_speculator_, 0 );
+    doIndex( indexing_data_, encoding_speculator_, initial_position );
 
     LOG(logDEBUG) << "FullIndexOperation: ... finished counting."
         "interrupt = " << *interruptRequest_;
@@ -315,16 +1105,58 @@ bool FullIndexOperation::start()
     return ( *interruptRequest_ ? false : true );
 }
 
+qint64 FullIndexOperation::findTailStart() const
+{
+    QFile file( fileName_ );
+    // (a sparse index cannot be spliced, a compressed file cannot be
+    // read from its end)
+    if ( options_.tailFirstSize <= 0 || options_.sparseStride > 1 || compressed_file_
+            || ( ! file.open( QIODevice::ReadOnly ) )
+            || file.size() <= 4 * options_.tailFirstSize )
+        return 0;
+
+    // The tail starts after the first end of line
+    // (looked for on whole code units)
+    const LineScanner scanner( LineScanner::bestKernel(), fileCodeUnit() );
+    const qint64 tail_size = options_.tailFirstSize
+        - options_.tailFirstSize % scanner.unitSize();
+    file.seek( file.size() - file.size() % scanner.unitSize() - tail_size );
+    while ( ! file.atEnd() ) {
+        const qint64 block_beginning = file.pos();
+        const QByteArray block = file.read( 64*1024 );
+        const int lf = scanner.findLineFeed( block.constData(),
+                scanner.alignedSize( block.size() ) );
+        if ( lf >= 0 )
+            return ( block_beginning + lf + scanner.unitSize() < file.size() ) ?
+                block_beginning + lf + scanner.unitSize() : 0;
+        if ( block.size() < scanner.unitSize() )
+            break;
+        file.seek( block_beginning + scanner.alignedSize( block.size() ) );
+    }
+
+    return 0;
+}
+
 bool PartialIndexOperation::start()
 {
     LOG(logDEBUG) << "PartialIndexOperation::start(), file "
         << fileName_.toStdString();
 
+    // A compressed file is always indexed from its beginning
+    // (LogData reindexes it fully when it changes)
+    if ( compressed_file_ ) {
+        LOG(logWARNING) << "Cannot index a compressed file partially";
+        emit indexingProgressed( 100 );
+        return true;
+    }
+
     qint64 initial_position = indexing_data_->getSize();
 
     LOG(logDEBUG) << "PartialIndexOperation: Starting the count at "
         << initial_position << " ...";
 
+    lastCheckpoint_ = initial_position;
+
     emit indexingProgressed( 0 );
 
     doIndex( indexing_data_, encoding_speculator_, initial_position );
@@ -333,3 +1165,43 @@ bool PartialIndexOperation::start()
 
     return ( *interruptRequest_ ? false : true );
 }
+
+// Called in a pool thread
+bool PrefixIndexOperation::start()
+{
+    LOG(logDEBUG) << "PrefixIndexOperation::start(), file "
+        << fileName_.toStdString() << " up to " << prefixSize_;
+
+    IndexingData prefix;
+    EncodingSpeculator encoding_speculator;
+
+    // (same code units as the tail it is spliced to)
+    prefix.setCodeUnit( indexing_data_->getCodeUnit() );
+    prefix.setEliasFano( options_.eliasFanoIndex );
+    scanner_ = LineScanner( LineScanner::bestKernel(), prefix.getCodeUnit() );
+
+    MappedFile mapping;
+    if ( options_.memoryMapping )
+        mapping.open( fileName_ );
+
+    // The prefix ends with an end of line, so the last line
+    // of the prefix is complete when the merge is done.
+    qint64 read_position = 0;
+    qint64 pos = 0;
+    int additional_spaces = 0;
+    doParallelIndex( &prefix, &encoding_speculator,
+            mapping.isMapped() ? &mapping : nullptr, prefixSize_,
+            &read_position, &pos, &additional_spaces );
+
+    if ( *interruptRequest_ || read_position != prefixSize_ || pos != prefixSize_ ) {
+        LOG(logDEBUG) << "PrefixIndexOperation: interrupted or the file changed";
+        return false;
+    }
+
+    LOG(logDEBUG) << "PrefixIndexOperation: ... finished, "
+        << prefix.getNbLines() << " lines before the tail.";
+
+    indexing_data_->splicePrefix( &prefix );
+
+    return true;
+}
@@ -20,27 +20,92 @@
 #ifndef LOGDATAWORKERTHREAD_H
 #define LOGDATAWORKERTHREAD_H
 
+#include <memory>
+#include <vector>
+
 #include <QObject>
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
 #include <QVector>
+#include <QFuture>
 
 #include "loadingstatus.h"
 #include "linepositionarray.h"
+#include "linescanner.h"
 #include "encodingspeculator.h"
+#include "compressedfile.h"
+#include "mappedfile.h"
+#include "sparselinepositionarray.h"
 #include "utils.h"
 
+class IndexCache;
+
+// Tunables of the indexing operations, set by the LogData owning
+// the worker thread (usually from the Configuration).
+struct IndexingOptions
+{
+    // Number of threads scanning the file in parallel.
+    // 1 means the file is indexed by the worker thread alone.
+    int nbThreads = QThread::idealThreadCount();
+    // Scan and decode the file in place in a memory mapping, instead of
+    // reading it into buffers (see MappedFile for its truncation).
+    // Off on Windows where it would prevent others from truncating it.
+#ifdef Q_OS_WIN
+    bool memoryMapping = false;
+#else
+    bool memoryMapping = true;
+#endif
+    // Save the index of big files in the cache, and start from the
+    // cached index when they are opened again.
+    bool indexCache = true;
+    // If not 0, files bigger than four times this size are indexed
+    // starting with this much at their end, the beginning is then
+    // indexed in the background.
+    qint64 tailFirstSize = 0;
+    // If more than 1, only the position of one line every sparseStride
+    // lines is kept in memory, the others are read again from the file
+    // when needed (sparseCachedBlocks blocks of lines are cached).
+    // Used for files with too many lines to index them all in memory,
+    // it disables the index cache and the tail first indexing.
+    int sparseStride = 0;
+    int sparseCachedBlocks = 64;
+    // Index the trigrams of the lines in the background once the file
+    // is indexed, so the searches can skip the blocks of lines which
+    // cannot match (see TrigramIndex).
+    bool trigramIndex = false;
+    // Code the positions of the lines with Elias-Fano wherever it takes
+    // less memory than the default coding, any line is then found in
+    // constant time. Off without a population count instruction, which
+    // makes reading the lines in order slower.
+#if defined( __POPCNT__ ) || defined( __AVX2__ )
+    bool eliasFanoIndex = true;
+#else
+    bool eliasFanoIndex = false;
+#endif
+};
+
 // This class is a thread-safe set of indexing data.
+// The readers never wait for the writers: each change publishes a new
+// immutable snapshot of the data, which the readers keep using for as
+// long as they need it. The snapshots share all but their last lines.
 class IndexingData
 {
+  private:
+    struct Snapshot;
+
   public:
-    IndexingData() : dataMutex_(), linePosition_(), maxLength_(0),
-        indexedSize_(0), encoding_(EncodingSpeculator::Encoding::ASCII7) { }
+    IndexingData();
 
     // Get the total indexed size
+    // (the position of the end of the index in the file)
     qint64 getSize() const;
 
+    // Get the position of the beginning of the first line, it is not 0
+    // if only the end of the file has been indexed so far (the line
+    // numbers are then relative to this position).
+    qint64 getStartPosition() const;
+
     // Get the length of the longest line
     int getMaxLength() const;
 
@@ -49,11 +114,48 @@ class IndexingData
 
     // Get the position (in byte from the beginning of the file)
     // of the end of the passed line.
+    // (use a Cursor to get the position of several lines)
     qint64 getPosForLine( LineNumber line ) const;
 
+    // Reads the positions of the lines for one thread, much faster than
+    // getPosForLine for lines close to each other.
+    // A cursor reads the data as they were when it was created, so the
+    // line numbers must be checked against its own getNbLines.
+    // Any number of cursors can be used at once by different threads.
+    class Cursor
+    {
+      public:
+        explicit Cursor( const IndexingData& indexing_data );
+
+        // Same as the IndexingData functions, for our snapshot
+        LineNumber getNbLines() const;
+        qint64 getStartPosition() const;
+        LineScanner::CodeUnit getCodeUnit() const;
+        qint64 getPosForLine( LineNumber line );
+
+      private:
+        const IndexingData& indexing_data_;
+        std::shared_ptr<const Snapshot> snapshot_;
+        // Reads the segment number segment_ of the snapshot
+        // (if it is not coded with Elias-Fano)
+        int segment_;
+        std::unique_ptr<LinePositionArray::Cursor> segmentCursor_;
+    };
+
     // Get the guessed encoding for the content.
     EncodingSpeculator::Encoding getEncodingGuess() const;
 
+    // Get the code units the end of lines are found on: the positions
+    // of a UTF-16 index are after the whole LF code units, those of a
+    // byte index after the LF bytes.
+    LineScanner::CodeUnit getCodeUnit() const;
+    // Set the code units of the lines added from now on (the index
+    // is cleared before they change)
+    void setCodeUnit( LineScanner::CodeUnit unit );
+    // Whether the lines added from now on can be coded with Elias-Fano
+    // (see IndexingOptions::eliasFanoIndex)
+    void setEliasFano( bool enabled );
+
     // Atomically add to all the existing
     // indexing data.
     void addAll( qint64 size, int length,
@@ -62,15 +164,112 @@ class IndexingData
 
     // Completely clear the indexing data.
     void clear();
+    // Clear the indexing data and keep only one position every stride
+    // lines of the passed file from now on (all of them if stride is
+    // 1 or less).
+    void setSparse( const QString& fileName, int stride, int nbCachedBlocks );
+    // Whether only some of the positions are kept
+    bool isSparse() const;
+    // Convert the existing index to keep only one position every
+    // stride lines of the passed file, as setSparse would have.
+    // Returns false if it is not possible (the index is already sparse
+    // or does not start at the beginning of the file).
+    bool makeSparse( const QString& fileName, int stride, int nbCachedBlocks );
+    // Drop the positions read again from the file by a sparse index
+    void dropCaches();
+    // Approximate memory used by the positions (in bytes)
+    qint64 memoryUsage() const;
+    // Clear the indexing data and start indexing at the passed
+    // position (which must be the beginning of a line).
+    void startAt( qint64 position );
+    // Insert the passed index of the beginning of the file (which
+    // must end at our start position) before our lines.
+    // Not possible if this index is sparse.
+    void splicePrefix( IndexingData* prefix );
 
   private:
-    mutable QMutex dataMutex_;
-
-    LinePositionArray linePosition_;
-    int maxLength_;
-    qint64 indexedSize_;
-
-    EncodingSpeculator::Encoding encoding_;
+    // The positions of segmentSize lines, in the storage taking
+    // the least memory (among those allowed)
+    class Segment
+    {
+      public:
+        Segment( const uint64_t* positions, bool elias_fano );
+
+        uint64_t at( int i ) const;
+        size_t memoryUsage() const;
+        // Null if coded with Elias-Fano, which needs no cursor
+        const LinePositionArray* compressed() const;
+
+      private:
+        LinePositionArray compressed_;
+        EliasFanoLinePositionArray eliasFano_;
+        bool isEliasFano_;
+    };
+
+    // The segments, shared by the snapshots as the chunks of the
+    // SearchResultArray copies are
+    struct SegmentDirectory;
+
+    // Number of lines of the segments (a multiple of the
+    // CompressedLinePositionStorage blocks)
+    static const int segmentSize;
+
+    // Never modified once published
+    struct Snapshot
+    {
+        // The lines are split between segments of segmentSize lines
+        // and a tail of up to segmentSize lines, which always holds the
+        // last line (so the segments never end with a fake final LF).
+        // The new snapshots only copy the tail, the segments they add
+        // are added to the shared directory.
+        std::shared_ptr<SegmentDirectory> segments;
+        size_t nbSegments = 0;
+        std::shared_ptr<const FastLinePositionArray> tail;
+        // Used instead of the segments if not null, the tail is then
+        // the one of the sparse positions when the snapshot was made.
+        // Their complete blocks are added in place (it is thread-safe)
+        // so the snapshots keep their own number of lines.
+        std::shared_ptr<SparseLinePositionArray> sparse;
+
+        LineNumber nbLines = 0;
+        qint64 segmentsMemory = 0;
+        int maxLength = 0;
+        qint64 indexedSize = 0;
+        qint64 startPosition = 0;
+        EncodingSpeculator::Encoding encoding = EncodingSpeculator::Encoding::ASCII7;
+        // Guess for the beginning of the file if it has been indexed last
+        EncodingSpeculator::Encoding prefixEncoding = EncodingSpeculator::Encoding::ASCII7;
+        LineScanner::CodeUnit codeUnit = LineScanner::CodeUnit::Byte;
+    };
+
+    // The current snapshot, read and written atomically
+    std::shared_ptr<const Snapshot> snapshot() const;
+    void publish( std::shared_ptr<const Snapshot> snapshot );
+
+    // Returns a new empty snapshot (sparse if setSparse asked for it)
+    std::shared_ptr<Snapshot> emptySnapshot() const;
+    // Add the passed lines to the (unpublished) snapshot
+    void appendLines( Snapshot* snapshot,
+            const FastLinePositionArray& linePosition ) const;
+    // Add the passed segment to the (unpublished) snapshot, in place
+    // in its directory if no other snapshot has added one after its
+    // last segment (the directory is copied otherwise)
+    static void appendSegment( Snapshot* snapshot,
+            std::shared_ptr<const Segment> segment );
+    qint64 posForLine( const Snapshot& snapshot, LineNumber line ) const;
+
+    // Serialises the writers
+    QMutex writeMutex_;
+
+    std::shared_ptr<const Snapshot> snapshot_;
+
+    // Parameters of the sparse positions (stride 0 if not sparse),
+    // only used by the writers
+    QString sparseFileName_;
+    int sparseStride_;
+    int sparseCachedBlocks_;
+    LineScanner::CodeUnit codeUnit_;
+    bool eliasFano_;
 };
 
 class IndexOperation : public QObject
@@ -78,6 +277,8 @@ class IndexOperation : public QObject
   Q_OBJECT
   public:
     IndexOperation( const QString& fileName,
+            const IndexingOptions& options, IndexCache* indexCache,
+            CompressedFile* compressedFile,
             IndexingData* indexingData, bool* interruptRequest,
             EncodingSpeculator* encodingSpeculator );
 
@@ -87,42 +288,145 @@ class IndexOperation : public QObject
     // and false if it has been cancelled (results not copied)
     virtual bool start() = 0;
 
+    // Size of the beginning of the file that has been left out of
+    // the index (to be indexed by a PrefixIndexOperation)
+    virtual qint64 unindexedPrefix() const { return 0; }
+
   signals:
     void indexingProgressed( int );
 
   protected:
     static const int sizeChunk;
+    static const qint64 checkpointInterval;
+
+    // Result of the indexing of one chunk by a pool thread.
+    // The chunk is scanned as if a line started at its beginning,
+    // so the 'head' (from the beginning to the first LF) must be
+    // completed when merging.
+    struct ChunkIndex {
+        qint64 beginning = 0;
+        // Number of bytes of the chunk, read in place in the mapping
+        // if mapped or in block otherwise
+        int size = 0;
+        bool mapped = false;
+        QByteArray block;
+        // Position of the first LF (-1 if there is none)
+        qint64 head_end = -1;
+        // Offset of the first tab in the head (-1 if there is none)
+        int head_first_tab = -1;
+        // Expanded length of the head after its first tab
+        int head_width_after_tab = 0;
+        // Position and added spaces of the last (unfinished) line
+        qint64 tail_beginning = 0;
+        int tail_additional_spaces = 0;
+        // Max length of the complete lines
+        int max_length = 0;
+        FastLinePositionArray line_positions;
+        // Size of the code units the chunk was scanned by
+        int unit_size = 1;
+
+        // Expanded length of the head if it starts at the passed column
+        int headLength( int column ) const;
+    };
+
+    // (the chunk is read from the mapping if it is not null and covers it)
+    static std::shared_ptr<ChunkIndex> indexChunk( const LineScanner& scanner,
+            const QString& fileName, const MappedFile* mapping,
+            qint64 beginning, qint64 length, const bool* interruptRequest );
+    static void scanChunk( const LineScanner& scanner, const char* data,
+            ChunkIndex* chunk );
+    // Scans the passed block (whose first byte is at block_beginning in
+    // the file) for end of lines, see LineScanner::scan
+    void scanBlock( const char* block, int size, qint64 block_beginning,
+            qint64* pos, int* additional_spaces, int* max_length,
+            FastLinePositionArray* line_positions ) const;
+    // Returns the code units of the lines of our file (from its BOM)
+    LineScanner::CodeUnit fileCodeUnit() const;
 
     // Returns the total size indexed
     // Modify the passed linePosition and maxLength
+    // (the bulk of the file is scanned by options_.nbThreads threads
+    // if it is big enough)
     void doIndex( IndexingData* linePosition, EncodingSpeculator* encodingSpeculator,
             qint64 initialPosition );
+    // Same as doIndex for a compressed file (always from the beginning)
+    void doIndexCompressed( IndexingData* indexing_data,
+            EncodingSpeculator* encoding_speculator );
+    void doParallelIndex( IndexingData* indexing_data,
+            EncodingSpeculator* encoding_speculator,
+            const MappedFile* mapping, qint64 end_position,
+            qint64* read_position, qint64* pos, int* additional_spaces );
+    // Save the index in the cache if enough has been indexed since
+    // the last time (so an interrupted indexing can be resumed)
+    void checkpoint( const IndexingData& indexing_data );
 
     QString fileName_;
+    IndexingOptions options_;
+    // Null if the index is not cached
+    IndexCache* index_cache_;
+    // Null if the file is not compressed
+    CompressedFile* compressed_file_;
+    qint64 lastCheckpoint_;
     bool* interruptRequest_;
     IndexingData* indexing_data_;
 
     EncodingSpeculator* encoding_speculator_;
+    // Scans the file by the code units of the index
+    LineScanner scanner_;
 };
 
 class FullIndexOperation : public IndexOperation
 {
   public:
+    // If fromCache, start from the cached index if it is still valid
     FullIndexOperation( const QString& fileName,
+            const IndexingOptions& options, IndexCache* indexCache,
+            bool fromCache, CompressedFile* compressedFile,
             IndexingData* indexingData, bool* interruptRequest,
             EncodingSpeculator* speculator )
-        : IndexOperation( fileName, indexingData, interruptRequest, speculator ) { }
+        : IndexOperation( fileName, options, indexCache, compressedFile,
+                indexingData, interruptRequest, speculator ),
+        fromCache_( fromCache ) { }
     virtual bool start();
+    virtual qint64 unindexedPrefix() const { return unindexedPrefix_; }
+
+  private:
+    // Beginning of the last options_.tailFirstSize bytes of the file
+    // (0 if the file is not indexed from its tail)
+    qint64 findTailStart() const;
+
+    bool fromCache_;
+    qint64 unindexedPrefix_ = 0;
 };
 
 class PartialIndexOperation : public IndexOperation
 {
   public:
     PartialIndexOperation( const QString& fileName,
+            const IndexingOptions& options, IndexCache* indexCache,
+            CompressedFile* compressedFile,
             IndexingData* indexingData, bool* interruptRequest,
             EncodingSpeculator* speculator )
-        : IndexOperation( fileName, indexingData, interruptRequest, speculator ) { }
+        : IndexOperation( fileName, options, indexCache, compressedFile,
+                indexingData, interruptRequest, speculator ) { }
+    virtual bool start();
+};
+
+// Index the beginning of a file whose end has already been indexed
+// by a tail-first FullIndexOperation, the index is spliced before the
+// existing one when complete.
+class PrefixIndexOperation : public IndexOperation
+{
+  public:
+    PrefixIndexOperation( const QString& fileName,
+            const IndexingOptions& options, qint64 prefixSize,
+            IndexingData* indexingData, bool* interruptRequest )
+        : IndexOperation( fileName, options, nullptr, nullptr, indexingData,
+                interruptRequest, nullptr ), prefixSize_( prefixSize ) { }
     virtual bool start();
+
+  private:
+    qint64 prefixSize_;
 };
 
 // Create and manage the thread doing loading/indexing for
@@ -142,15 +446,23 @@ class LogDataWorkerThread : public QThread
 
     // Attaches to a file on disk. Attaching to a non existant file
     // will work, it will just appear as an empty file.
-    void attachFile( const QString& fileName );
+    // compressedFile is not null if the file is compressed.
+    void attachFile( const QString& fileName,
+            std::shared_ptr<CompressedFile> compressedFile = nullptr );
     // Instructs the thread to start a new full indexing of the file, sending
     // signals as it progresses.
-    void indexAll();
+    // If from_cache, the cached index of the file is used if still valid,
+    // and only what has been added to the file since is indexed.
+    void indexAll( bool from_cache = false );
     // Instructs the thread to start a partial indexing (starting at
     // the end of the file as indexed).
     void indexAdditionalLines();
     // Interrupts the indexing if one is in progress
+    // (the indexing of the prefix goes on, it is only stopped
+    // when the whole index is rebuilt)
     void interrupt();
+    // Set the tunables used by the next indexing operations
+    void setIndexingOptions( const IndexingOptions& options );
 
     // Returns a copy of the current indexing data
     void getIndexingData( qint64* indexedSize,
@@ -163,12 +475,19 @@ class LogDataWorkerThread : public QThread
     // Sent when indexing is finished, signals the client
     // to copy the new data back.
     void indexingFinished( LoadingStatus status );
+    // Sent when the beginning of a file indexed tail-first has been
+    // added to the index (the line numbers have changed).
+    void prefixIndexed();
 
   protected:
     void run();
 
   private:
     void doIndexAll();
+    // Start indexing the first prefix_size bytes in the background
+    void startPrefixIndexing( qint64 prefix_size );
+    // Interrupt the background indexing and wait for it
+    void stopPrefixIndexing();
 
     // Mutex to protect operationRequested_ and friends
     QMutex mutex_;
@@ -184,6 +503,21 @@ class LogDataWorkerThread : public QThread
     // Pointer to the owner's indexing data (we modify it)
     IndexingData* indexing_data_;
 
+    // Passed to the next operations (protected by optionsMutex_ as
+    // mutex_ is held during the operations)
+    QMutex optionsMutex_;
+    IndexingOptions options_;
+
+    // Cache for the index of the attached file
+    std::unique_ptr<IndexCache> indexCache_;
+    // Decompression of the attached file, if it is compressed
+    std::shared_ptr<CompressedFile> compressedFile_;
+
+    // Indexing of the beginning of the file, running alongside the
+    // operations (which only add to the end of the index).
+    QFuture<void> prefixIndexing_;
+    bool prefixInterruptRequested_;
+
     // To guess the encoding
     EncodingSpeculator encodingSpeculator_;
 };
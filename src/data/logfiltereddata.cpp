@@ -31,6 +31,7 @@
 #include "logdata.h"
 #include "marks.h"
 #include "logfiltereddata.h"
+#include "memorygovernor.h"
 #include "regexp_filter.h"
 #include "signal_slot.h"
 
@@ -47,6 +48,8 @@ LogFilteredData::LogFilteredData() : AbstractLogData(),
     /* Prevent any more searching */
     maxLength_ = 0;
     maxLengthMarks_ = 0;
+    nbSearchesRunning_ = 0;
+    updateSearchPending_ = false;
     searchDone_ = true;
     visibility_ = MarksAndMatches;
 
@@ -67,6 +70,8 @@ LogFilteredData::LogFilteredData( const LogData* logData )
     maxLength_ = 0;
     maxLengthMarks_ = 0;
     nbLinesProcessed_ = 0;
+    nbSearchesRunning_ = 0;
+    updateSearchPending_ = false;
 
     sourceLogData_ = logData;
 
@@ -78,6 +83,7 @@ LogFilteredData::LogFilteredData( const LogData* logData )
 
     // Forward the update signal
     CONNECT(&workerThread_, searchProgressed, this, handleSearchProgressed);
+    CONNECT(&workerThread_, searchFinished, this, handleSearchFinished);
 
     // Starts the worker thread
     workerThread_.start();
@@ -101,6 +107,9 @@ void LogFilteredData::runSearch( const RegExpFilter& regExp )
     clearSearch();
     currentRegExp_ = regExp;
 
+    // The new search covers any pending update
+    updateSearchPending_ = false;
+    ++nbSearchesRunning_;
     workerThread_.search( currentRegExp_ );
 }
 
@@ -108,6 +117,14 @@ void LogFilteredData::updateSearch()
 {
     LOG(logDEBUG) << "Entering updateSearch";
 
+    // Rather than waiting for the running search, we do a single update
+    // when it finishes, whatever the number of updates asked for meanwhile.
+    if ( nbSearchesRunning_ > 0 ) {
+        updateSearchPending_ = true;
+        return;
+    }
+
+    ++nbSearchesRunning_;
     workerThread_.updateSearch( currentRegExp_, nbLinesProcessed_ );
 }
 
@@ -115,6 +132,7 @@ void LogFilteredData::interruptSearch()
 {
     LOG(logDEBUG) << "Entering interruptSearch";
 
+    updateSearchPending_ = false;
     workerThread_.interrupt();
 }
 
@@ -127,6 +145,11 @@ void LogFilteredData::clearSearch()
     filteredItemsCacheDirty_ = true;
 }
 
+void LogFilteredData::setSearchThreads( int nbThreads )
+{
+    workerThread_.setNbThreads( nbThreads );
+}
+
 qint64 LogFilteredData::getMatchingLineNumber( int matchNum ) const
 {
     qint64 matchingLine = findLogDataLine( matchNum );
@@ -137,9 +160,7 @@ qint64 LogFilteredData::getMatchingLineNumber( int matchNum ) const
 // Scan the list for the 'lineNumber' passed
 bool LogFilteredData::isLineInMatchingList( qint64 lineNumber )
 {
-    int index;                                    // Not used
-    return lookupLineNumber<SearchResultArray>(
-            matching_lines_, lineNumber, &index);
+    return matching_lines_.contains( lineNumber );
 }
 
 int LogFilteredData::getLineIndexNumber( quint64 lineNumber ) const
@@ -288,6 +309,33 @@ void LogFilteredData::setVisibility( Visibility visi )
     visibility_ = visi;
 }
 
+// Our matches are a copy of the ones of the search, the chunks they
+// share are only counted with these.
+qint64 LogFilteredData::memoryUsage() const
+{
+    return matching_lines_.unsharedMemoryUsage()
+        + filteredItemsCache_.capacity() * sizeof( FilteredItem )
+        + workerThread_.searchResultMemoryUsage();
+}
+
+void LogFilteredData::releaseMemory( Release level )
+{
+    switch ( level ) {
+        case Release::Caches:
+            // It is regenerated when needed
+            filteredItemsCache_ = std::vector<FilteredItem>();
+            filteredItemsCacheDirty_ = true;
+            break;
+        case Release::Compact:
+            matching_lines_.shrink_to_fit();
+            workerThread_.compactSearchResult();
+            break;
+        case Release::Sparse:
+            // The results are always kept in full
+            break;
+    }
+}
+
 //
 // Slots
 //
@@ -300,9 +348,24 @@ void LogFilteredData::handleSearchProgressed( int nbMatches, int progress, qint6
     workerThread_.getSearchResult( &maxLength_, &matching_lines_, &nbLinesProcessed_ );
     filteredItemsCacheDirty_ = true;
 
+    // The results have grown
+    MemoryGovernor::get().rebalance();
+
     emit searchProgressed( nbMatches, progress, initial_position );
 }
 
+void LogFilteredData::handleSearchFinished()
+{
+    LOG(logDEBUG) << "LogFilteredData::handleSearchFinished";
+
+    --nbSearchesRunning_;
+
+    if ( nbSearchesRunning_ == 0 && updateSearchPending_ ) {
+        updateSearchPending_ = false;
+        updateSearch();
+    }
+}
+
 LineNumber LogFilteredData::findLogDataLine( LineNumber lineNum ) const
 {
     LineNumber line = std::numeric_limits<LineNumber>::max();
@@ -339,9 +402,13 @@ LineNumber LogFilteredData::findFilteredLine( LineNumber lineNum ) const
     LineNumber lineIndex = std::numeric_limits<LineNumber>::max();
 
     if ( visibility_ == MatchesOnly ) {
-        lineIndex = lookupLineNumber( matching_lines_.begin(),
-                                      matching_lines_.end(),
-                                      lineNum );
+        // (as lookupLineNumber would, without walking the matches
+        // one by one through their iterators)
+        const size_t index = matching_lines_.lowerBound( lineNum );
+        if ( index < matching_lines_.size() )
+            lineIndex = index;
+        else
+            lineIndex = matching_lines_.empty() ? 0 : matching_lines_[0].lineNumber();
     }
     else if ( visibility_ == MarksOnly ) {
         lineIndex = lookupLineNumber( marks_.begin(),
@@ -384,6 +451,7 @@ QString LogFilteredData::doGetExpandedLineString( qint64 lineNum ) const
 QStringList LogFilteredData::doGetLines( qint64 first_line, int number ) const
 {
     QStringList list;
+    touch();
 
     for ( int i = first_line; i < first_line + number; i++ ) {
         list.append( doGetLineString( i ) );
@@ -396,6 +464,7 @@ QStringList LogFilteredData::doGetLines( qint64 first_line, int number ) const
 QStringList LogFilteredData::doGetExpandedLines( qint64 first_line, int number ) const
 {
     QStringList list;
+    touch();
 
     for ( int i = first_line; i < first_line + number; i++ ) {
         list.append( doGetExpandedLineString( i ) );
@@ -404,6 +473,52 @@ QStringList LogFilteredData::doGetExpandedLines( qint64 first_line, int number )
     return list;
 }
 
+// Implementation of the virtual function.
+QString LogFilteredData::doGetExpandedLineWindow( qint64 lineNum,
+        int first_column, int nb_columns ) const
+{
+    qint64 line = findLogDataLine( lineNum );
+
+    return sourceLogData_->getExpandedLineWindow( line, first_column, nb_columns );
+}
+
+// Implementation of the virtual function.
+QStringList LogFilteredData::doGetExpandedLineWindows( qint64 first_line, int number,
+        int first_column, int nb_columns ) const
+{
+    QStringList list;
+    touch();
+
+    for ( int i = first_line; i < first_line + number; i++ ) {
+        list.append( doGetExpandedLineWindow( i, first_column, nb_columns ) );
+    }
+
+    return list;
+}
+
+// Implementation of the virtual function.
+RawLines LogFilteredData::doGetRawLines( qint64 first_line, int number ) const
+{
+    RawLines lines;
+    touch();
+
+    // The lines following each other in the source are read together
+    int i = 0;
+    while ( i < number ) {
+        const qint64 first_source_line = findLogDataLine( first_line + i );
+        int nb_source_lines = 1;
+        while ( ( i + nb_source_lines < number )
+                && ( findLogDataLine( first_line + i + nb_source_lines )
+                    == first_source_line + nb_source_lines ) )
+            ++nb_source_lines;
+
+        lines.append( sourceLogData_->getRawLines( first_source_line, nb_source_lines ) );
+        i += nb_source_lines;
+    }
+
+    return lines;
+}
+
 // Implementation of the virtual function.
 qint64 LogFilteredData::doGetNbLine() const
 {
@@ -443,7 +558,12 @@ int LogFilteredData::doGetMaxLength() const
 int LogFilteredData::doGetLineLength( qint64 lineNum ) const
 {
     qint64 line = findLogDataLine( lineNum );
-    return sourceLogData_->getExpandedLineString( line ).length();
+    return sourceLogData_->getLineLength( line );
+}
+
+bool LogFilteredData::doHasProvisionalLineNumbers() const
+{
+    return sourceLogData_->hasProvisionalLineNumbers();
 }
 
 void LogFilteredData::doSetDisplayEncoding( Encoding encoding )
@@ -472,7 +592,7 @@ void LogFilteredData::regenerateFilteredItemsCache() const
         qint64 next_mark =
             ( j != marks_.end() ) ? j->lineNumber() : std::numeric_limits<qint64>::max();
         qint64 next_match =
-            ( i != matching_lines_.cend() ) ? i->lineNumber() : std::numeric_limits<qint64>::max();
+            ( i != matching_lines_.cend() ) ? ( *i ).lineNumber() : std::numeric_limits<qint64>::max();
         // We choose a Mark over a Match if a line is both, just an arbitrary choice really.
         if ( next_mark <= next_match ) {
             // LOG(logDEBUG) << "Add mark at " << next_mark;
@@ -31,6 +31,7 @@
 #include "abstractlogdata.h"
 #include "logfiltereddataworkerthread.h"
 #include "marks.h"
+#include "memorygovernor.h"
 #include "regexp_filter.h"
 
 class LogData;
@@ -41,7 +42,7 @@ class Marks;
 // the original line number where they were found.
 // Constructing such objet does not start the search.
 // This object should be constructed by a LogData.
-class LogFilteredData : public AbstractLogData {
+class LogFilteredData : public AbstractLogData, public MemoryConsumer {
   Q_OBJECT
 
   public:
@@ -64,6 +65,8 @@ class LogFilteredData : public AbstractLogData {
     void interruptSearch();
     // Clear the search and the list of results.
     void clearSearch();
+    // Set the number of threads the next searches run on.
+    void setSearchThreads( int nbThreads );
     // Returns the line number in the original LogData where the element
     // 'index' was found.
     qint64 getMatchingLineNumber( int index ) const;
@@ -115,6 +118,10 @@ class LogFilteredData : public AbstractLogData {
     enum Visibility { MatchesOnly, MarksOnly, MarksAndMatches };
     void setVisibility( Visibility visibility );
 
+    // MemoryConsumer interface (the results can be compacted)
+    qint64 memoryUsage() const override;
+    void releaseMemory( Release level ) override;
+
   signals:
     // Sent when the search has progressed, give the number of matches (so far)
     // and the percentage of completion
@@ -124,6 +131,7 @@ class LogFilteredData : public AbstractLogData {
 
   private slots:
     void handleSearchProgressed( int NbMatches, int progress, qint64 initial_position );
+    void handleSearchFinished();
 
   private:
     class FilteredItem;
@@ -133,9 +141,15 @@ class LogFilteredData : public AbstractLogData {
     QString doGetExpandedLineString( qint64 line ) const override;
     QStringList doGetLines( qint64 first, int number ) const override;
     QStringList doGetExpandedLines( qint64 first, int number ) const override;
+    RawLines doGetRawLines( qint64 first, int number ) const override;
+    QString doGetExpandedLineWindow( qint64 line,
+            int first_column, int nb_columns ) const override;
+    QStringList doGetExpandedLineWindows( qint64 first_line, int number,
+            int first_column, int nb_columns ) const override;
     qint64 doGetNbLine() const override;
     int doGetMaxLength() const override;
     int doGetLineLength( qint64 line ) const override;
+    bool doHasProvisionalLineNumbers() const override;
     void doSetDisplayEncoding( Encoding encoding ) override;
     void doSetMultibyteEncodingOffsets( int before_cr, int after_cr ) override;
 
@@ -149,6 +163,10 @@ class LogFilteredData : public AbstractLogData {
     int maxLengthMarks_;
     // Number of lines of the LogData that has been searched for:
     qint64 nbLinesProcessed_;
+    // Searches started and not finished yet
+    int nbSearchesRunning_;
+    // An update has been asked for whilst searching
+    bool updateSearchPending_;
 
     Visibility visibility_;
 
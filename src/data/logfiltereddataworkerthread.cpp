@@ -17,7 +17,11 @@
  * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <deque>
+
 #include <QFile>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include "log.h"
 
@@ -36,7 +40,7 @@ void SearchData::getAll( int* length, SearchResultArray* matches,
     *length  = maxLength_;
     *lines   = nbLinesProcessed_;
 
-    // This is a copy (potentially slow)
+    // (only the matches not making a whole chunk are copied)
     *matches = matches_;
 }
 
@@ -57,10 +61,7 @@ void SearchData::addAll( int length,
     maxLength_        = qMax( maxLength_, length );
     nbLinesProcessed_ = lines;
 
-    // This does a copy as we want the final array to be
-    // linear.
-    matches_.insert( std::end( matches_ ),
-            std::begin( matches ), std::end( matches ) );
+    matches_.append( matches );
 }
 
 LineNumber SearchData::getNbMatches() const
@@ -70,24 +71,14 @@ LineNumber SearchData::getNbMatches() const
     return matches_.size();
 }
 
-// This function starts searching from the end since we use it
-// to remove the final match.
+// The matches can only be removed from the end, it is used to
+// remove the final match.
 void SearchData::deleteMatch( LineNumber line )
 {
     QMutexLocker locker( &dataMutex_ );
 
-    SearchResultArray::iterator i = matches_.end();
-    while ( i != matches_.begin() ) {
-        i--;
-        const LineNumber this_line = i->lineNumber();
-        if ( this_line == line ) {
-            matches_.erase(i);
-            break;
-        }
-        // Exit if we have passed the line number to look for.
-        if ( this_line < line )
-            break;
-    }
+    if ( ! matches_.empty() && matches_.back().lineNumber() == line )
+        matches_.pop_back();
 }
 
 void SearchData::clear()
@@ -99,6 +90,20 @@ void SearchData::clear()
     matches_.clear();
 }
 
+void SearchData::compact()
+{
+    QMutexLocker locker( &dataMutex_ );
+
+    matches_.shrink_to_fit();
+}
+
+qint64 SearchData::memoryUsage() const
+{
+    QMutexLocker locker( &dataMutex_ );
+
+    return matches_.memoryUsage();
+}
+
 LogFilteredDataWorkerThread::LogFilteredDataWorkerThread(
         const LogData* sourceLogData )
     : QThread(), mutex_(), operationRequestedCond_(), nothingToDoCond_(), searchData_()
@@ -106,6 +111,7 @@ LogFilteredDataWorkerThread::LogFilteredDataWorkerThread(
     terminate_          = false;
     interruptRequested_ = false;
     operationRequested_ = NULL;
+    nbThreads_          = QThread::idealThreadCount();
 
     sourceLogData_ = sourceLogData;
 }
@@ -132,7 +138,7 @@ void LogFilteredDataWorkerThread::search( const RegExpFilter& regExp )
 
     interruptRequested_ = false;
     operationRequested_ = new FullSearchOperation( sourceLogData_,
-            regExp, &interruptRequested_ );
+            regExp, &interruptRequested_, nbThreads_ );
     operationRequestedCond_.wakeAll();
 }
 
@@ -149,7 +155,7 @@ void LogFilteredDataWorkerThread::updateSearch( const RegExpFilter& regExp,
 
     interruptRequested_ = false;
     operationRequested_ = new UpdateSearchOperation( sourceLogData_,
-            regExp, &interruptRequested_, position );
+            regExp, &interruptRequested_, nbThreads_, position );
     operationRequestedCond_.wakeAll();
 }
 
@@ -168,6 +174,11 @@ void LogFilteredDataWorkerThread::interrupt()
     }
 }
 
+void LogFilteredDataWorkerThread::setNbThreads( int nbThreads )
+{
+    nbThreads_ = qMax( 1, nbThreads );
+}
+
 // This will do an atomic copy of the object
 void LogFilteredDataWorkerThread::getSearchResult(
         int* maxLength, SearchResultArray* searchMatches, qint64* nbLinesProcessed )
@@ -175,6 +186,16 @@ void LogFilteredDataWorkerThread::getSearchResult(
     searchData_.getAll( maxLength, searchMatches, nbLinesProcessed );
 }
 
+void LogFilteredDataWorkerThread::compactSearchResult()
+{
+    searchData_.compact();
+}
+
+qint64 LogFilteredDataWorkerThread::searchResultMemoryUsage() const
+{
+    return searchData_.memoryUsage();
+}
+
 // This is the thread's main loop
 void LogFilteredDataWorkerThread::run()
 {
@@ -211,8 +232,10 @@ void LogFilteredDataWorkerThread::run()
 //
 
 SearchOperation::SearchOperation( const LogData* sourceLogData,
-        const RegExpFilter& regExp, bool* interruptRequest )
-    : regexp_( regExp ), sourceLogData_( sourceLogData )
+        const RegExpFilter& regExp, bool* interruptRequest, int nbThreads )
+    : regexp_( regExp ),
+    trigrams_( TrigramIndex::trigramsOf( regExp.requiredLiteral().literal() ) ),
+    sourceLogData_( sourceLogData ), nbThreads_( nbThreads )
 {
     interruptRequested_ = interruptRequest;
 }
@@ -222,46 +245,123 @@ void SearchOperation::doSearch( SearchData& searchData, qint64 initialLine )
     const qint64 nbSourceLines = sourceLogData_->getNbLine();
     int maxLength = 0;
     int nbMatches = searchData.getNbMatches();
-    SearchResultArray currentList = SearchResultArray();
 
-    // Ensure no re-alloc will be done
-    currentList.reserve( nbLinesInChunk );
+    LOG(logDEBUG) << "Searching from line " << initialLine << " to " << nbSourceLines
+        << " on " << nbThreads_ << " threads";
 
-    LOG(logDEBUG) << "Searching from line " << initialLine << " to " << nbSourceLines;
+    // The chunks are searched in advance by the pool (only a few
+    // of them to bound memory usage) while we merge them in order,
+    // a single thread searches them one after the other.
+    QThreadPool pool;
+    pool.setMaxThreadCount( nbThreads_ );
+    const size_t max_in_flight = ( nbThreads_ > 1 ) ? 2 * nbThreads_ : 0;
+    std::deque<QFuture<ChunkResult>> in_flight;
+    qint64 next_chunk = initialLine;
 
-    for ( qint64 i = initialLine; i < nbSourceLines; i += nbLinesInChunk ) {
+    for ( qint64 i = initialLine; i < nbSourceLines; ) {
         if ( *interruptRequested_ )
             break;
 
+        while ( in_flight.size() < max_in_flight && next_chunk < nbSourceLines ) {
+            const qint64 first_line = next_chunk;
+            const int nb_lines = qMin<qint64>( nbLinesInChunk, nbSourceLines - next_chunk );
+            in_flight.push_back( QtConcurrent::run( &pool, [this, first_line, nb_lines]() {
+                return searchChunk( first_line, nb_lines );
+            } ) );
+            next_chunk += nb_lines;
+        }
+
         const int percentage = ( i - initialLine ) * 100 / ( nbSourceLines - initialLine );
         emit searchProgressed( nbMatches, percentage, initialLine );
 
-        const QStringList lines = sourceLogData_->getLines( i,
-                qMin( nbLinesInChunk, (int) ( nbSourceLines - i ) ) );
-        LOG(logDEBUG) << "Chunk starting at " << i <<
-            ", " << lines.size() << " lines read.";
-
-        int j = 0;
-        for ( ; j < lines.size(); j++ ) {
-            if ( regexp_.hasMatch(lines[j]) ) {
-                // FIXME: increase perf by removing temporary
-                const int length = sourceLogData_->getExpandedLineString(i+j).length();
-                if ( length > maxLength )
-                    maxLength = length;
-                currentList.push_back( MatchingLine( i+j ) );
-                nbMatches++;
-            }
+        ChunkResult chunk;
+        if ( in_flight.empty() ) {
+            chunk = searchChunk( i, qMin<qint64>( nbLinesInChunk, nbSourceLines - i ) );
         }
+        else {
+            chunk = in_flight.front().result();
+            in_flight.pop_front();
+        }
+
+        if ( chunk.nbLines == 0 || chunk.firstLine != i )
+            break;  // Interrupted, or the file has changed under us
+
+        LOG(logDEBUG) << "Chunk starting at " << i <<
+            ", " << chunk.nbLines << " lines searched.";
 
         // After each block, copy the data to shared data
         // and update the client
-        searchData.addAll( maxLength, currentList, i+j );
-        currentList.clear();
+        maxLength = qMax( maxLength, chunk.maxLength );
+        nbMatches += chunk.matches.size();
+        i += chunk.nbLines;
+        searchData.addAll( maxLength, chunk.matches, i );
     }
 
+    // (the chunks still searched are dropped)
+    pool.waitForDone();
+
     emit searchProgressed( nbMatches, 100, initialLine );
 }
 
+SearchOperation::ChunkResult SearchOperation::searchChunk(
+        qint64 firstLine, int nbLines ) const
+{
+    ChunkResult result;
+    result.firstLine = firstLine;
+
+    // With a literal, the chunk is searched by blocks of the trigram
+    // index, the blocks which cannot contain it are not even read
+    const qint64 end = firstLine + nbLines;
+    for ( qint64 line = firstLine; line < end; ) {
+        if ( *interruptRequested_ )
+            return result;
+
+        const qint64 block_end = trigrams_.empty() ? end : qMin<qint64>( end,
+                ( line / TrigramIndex::blockLines + 1 ) * TrigramIndex::blockLines );
+        if ( sourceLogData_->mayContainTrigrams( line, trigrams_ )
+                && ! searchLines( line, block_end - line, &result ) )
+            return result;
+        line = block_end;
+    }
+    result.nbLines = nbLines;
+
+    return result;
+}
+
+bool SearchOperation::searchLines(
+        qint64 firstLine, int nbLines, ChunkResult* result ) const
+{
+    const RawLines lines = sourceLogData_->getRawLines( firstLine, nbLines );
+    // The UTF-8 (or ASCII) lines are matched without being decoded
+    const bool match_utf8 = regexp_.canMatchUtf8();
+    // and the lines without the characters every match contains are
+    // skipped without being matched at all
+    const LiteralFinder& literal = regexp_.requiredLiteral();
+    const bool prefilter = ! literal.isEmpty() && lines.isAsciiCompatible();
+
+    for ( int j = 0; j < lines.size(); j++ ) {
+        if ( prefilter ) {
+            j = lines.findLine( j, literal );
+            if ( j == lines.size() )
+                break;
+        }
+
+        bool matched;
+        if ( ! ( match_utf8 && lines.isUtf8( j ) && regexp_.hasUtf8Match(
+                        lines.lineData( j ), lines.lineSize( j ), &matched ) ) )
+            matched = regexp_.hasMatch( lines.lineString( j ) );
+
+        if ( matched ) {
+            const int length = lines.expandedLength( j );
+            if ( length > result->maxLength )
+                result->maxLength = length;
+            result->matches.push_back( MatchingLine( firstLine + j ) );
+        }
+    }
+
+    return lines.size() == nbLines;
+}
+
 // Called in the worker thread's context
 void FullSearchOperation::start( SearchData& searchData )
 {
@@ -20,6 +20,8 @@
 #ifndef LOGFILTEREDDATAWORKERTHREAD_H
 #define LOGFILTEREDDATAWORKERTHREAD_H
 
+#include <atomic>
+
 #include <QObject>
 #include <QThread>
 #include <QMutex>
@@ -28,33 +30,11 @@
 #include <QList>
 
 #include "regexp_filter.h"
+#include "searchresultarray.h"
+#include "trigramindex.h"
 
 class LogData;
 
-// Line number are unsigned 32 bits for now.
-typedef uint32_t LineNumber;
-
-// Class encapsulating a single matching line
-// Contains the line number the line was found in and its content.
-class MatchingLine {
-  public:
-    MatchingLine( LineNumber line ) { lineNumber_ = line; };
-
-    // Accessors
-    LineNumber lineNumber() const { return lineNumber_; }
-
-    bool operator <( const MatchingLine& other) const
-    { return lineNumber_ < other.lineNumber_; }
-
-  private:
-    LineNumber lineNumber_;
-};
-
-// This is an array of matching lines.
-// It shall be implemented for random lookup speed, so
-// a fixed "in-place" array (vector) is probably fine.
-typedef std::vector<MatchingLine> SearchResultArray;
-
 // This class is a mutex protected set of search result data.
 // It is thread safe.
 class SearchData
@@ -63,6 +43,7 @@ class SearchData
     SearchData() : dataMutex_(), matches_(), maxLength_(0) { }
 
     // Atomically get all the search data
+    // (the matches are shared, not copied)
     void getAll( int* length, SearchResultArray* matches,
             qint64* nbLinesProcessed ) const;
     // Atomically set all the search data
@@ -77,6 +58,10 @@ class SearchData
     void deleteMatch( LineNumber line );
     // Atomically clear the data.
     void clear();
+    // Free the memory allocated for future matches
+    void compact();
+    // Memory allocated for the matches (in bytes)
+    qint64 memoryUsage() const;
 
   private:
     mutable QMutex dataMutex_;
@@ -91,7 +76,8 @@ class SearchOperation : public QObject
   Q_OBJECT
   public:
     SearchOperation(const LogData* sourceLogData,
-            const RegExpFilter &regExp, bool* interruptRequest );
+            const RegExpFilter &regExp, bool* interruptRequest,
+            int nbThreads );
 
     virtual ~SearchOperation() { }
 
@@ -105,21 +91,42 @@ class SearchOperation : public QObject
   protected:
     static const int nbLinesInChunk;
 
+    // Matches of one chunk of lines
+    struct ChunkResult
+    {
+        qint64 firstLine = 0;
+        SearchResultArray matches;
+        int maxLength = 0;
+        // Number of lines searched (0 if interrupted)
+        int nbLines = 0;
+    };
+
     // Implement the common part of the search, passing
     // the shared results and the line to begin the search from.
+    // The chunks are searched by a pool of nbThreads_ threads and
+    // merged in order, as the serial search would have.
     void doSearch( SearchData& result, qint64 initialLine );
+    // Search the passed chunk (called by any thread)
+    ChunkResult searchChunk( qint64 firstLine, int nbLines ) const;
+    // Search the passed lines of a chunk, adding their matches to it.
+    // Returns false if they cannot be read anymore.
+    bool searchLines( qint64 firstLine, int nbLines, ChunkResult* result ) const;
 
     bool* interruptRequested_;
     const RegExpFilter regexp_;
+    // Trigrams of the literal of the regexp, to skip the blocks of
+    // lines which cannot contain it
+    const TrigramIndex::Trigrams trigrams_;
     const LogData* sourceLogData_;
+    const int nbThreads_;
 };
 
 class FullSearchOperation : public SearchOperation
 {
   public:
     FullSearchOperation( const LogData* sourceLogData, const RegExpFilter& regExp,
-            bool* interruptRequest )
-        : SearchOperation( sourceLogData, regExp, interruptRequest ) {}
+            bool* interruptRequest, int nbThreads )
+        : SearchOperation( sourceLogData, regExp, interruptRequest, nbThreads ) {}
     virtual void start( SearchData& result );
 };
 
@@ -127,8 +134,8 @@ class UpdateSearchOperation : public SearchOperation
 {
   public:
     UpdateSearchOperation( const LogData* sourceLogData, const RegExpFilter& regExp,
-            bool* interruptRequest, qint64 position )
-        : SearchOperation( sourceLogData, regExp, interruptRequest ),
+            bool* interruptRequest, int nbThreads, qint64 position )
+        : SearchOperation( sourceLogData, regExp, interruptRequest, nbThreads ),
         initialPosition_( position ) {}
     virtual void start( SearchData& result );
 
@@ -156,10 +163,16 @@ class LogFilteredDataWorkerThread : public QThread
     void updateSearch( const RegExpFilter& regExp, qint64 position );
     // Interrupts the search if one is in progress
     void interrupt();
+    // Set the number of threads the next searches run on
+    void setNbThreads( int nbThreads );
 
     // Returns a copy of the current indexing data
     void getSearchResult( int* maxLength, SearchResultArray* searchMatches,
            qint64* nbLinesProcessed );
+    // Free the memory allocated for future results
+    void compactSearchResult();
+    // Memory allocated for the results (in bytes)
+    qint64 searchResultMemoryUsage() const;
 
   signals:
     // Sent during the indexing process to signal progress
@@ -184,6 +197,8 @@ class LogFilteredDataWorkerThread : public QThread
     bool terminate_;
     bool interruptRequested_;
     SearchOperation* operationRequested_;
+    // (not protected by mutex_, which is held during the searches)
+    std::atomic<int> nbThreads_;
 
     // Shared indexing data
     SearchData searchData_;
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/longlineindex.h"
+
+#include <algorithm>
+
+const int LongLineIndex::longLineSize;
+const int LongLineIndex::stride;
+
+LongLineIndex::LongLineIndex( int nbLines )
+    : mutex_(), nbLines_( nbLines ), lines_(), generation_( 0 )
+{
+}
+
+std::shared_ptr<const LongLineIndex::Checkpoints> LongLineIndex::get( qint64 line )
+{
+    QMutexLocker locker( &mutex_ );
+
+    for ( auto i = lines_.begin(); i != lines_.end(); ++i ) {
+        if ( i->first == line ) {
+            lines_.splice( lines_.begin(), lines_, i );
+            return lines_.front().second;
+        }
+    }
+
+    return nullptr;
+}
+
+void LongLineIndex::put( uint64_t generation, qint64 line,
+        std::shared_ptr<const Checkpoints> checkpoints )
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( generation != generation_ || nbLines_ == 0 )
+        return;
+
+    // Another thread might have computed it at the same time
+    for ( const Line& cached_line : lines_ ) {
+        if ( cached_line.first == line )
+            return;
+    }
+
+    if ( lines_.size() >= nbLines_ )
+        lines_.pop_back();
+    lines_.emplace_front( line, std::move( checkpoints ) );
+}
+
+uint64_t LongLineIndex::generation() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return generation_;
+}
+
+void LongLineIndex::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    lines_.clear();
+    ++generation_;
+}
+
+LongLineIndex::Checkpoint LongLineIndex::closest(
+        const Checkpoints& checkpoints, int column )
+{
+    // The first one after the column, the checkpoints are in column order
+    const auto after = std::upper_bound( checkpoints.begin(), checkpoints.end(),
+            column, []( int c, const Checkpoint& checkpoint ) {
+                return c < checkpoint.column; } );
+
+    return after == checkpoints.begin() ? Checkpoint { 0, 0 } : *( after - 1 );
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LONGLINEINDEX_H
+#define LONGLINEINDEX_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QMutex>
+#include <QtGlobal>
+
+// Checkpoints inside the lines too long to be decoded in one go (a JSON
+// blob, a base64 dump...), each giving the column reached at a byte of
+// the line, so any window of columns can be decoded from the closest
+// checkpoint before it instead of from the beginning of the line.
+// Only the checkpoints of the most recently used lines are kept.
+// Thread-safe.
+class LongLineIndex
+{
+  public:
+    // Lines longer than this (in bytes) are read by windows
+    static const int longLineSize = 64 * 1024;
+    // Bytes between two checkpoints of a line
+    static const int stride = 64 * 1024;
+
+    struct Checkpoint {
+        // From the beginning of the line, always at a character boundary
+        qint64 offset;
+        int column;
+    };
+    // The checkpoints of a line, the first one is at the beginning
+    // of the line and the last one at its end.
+    typedef std::vector<Checkpoint> Checkpoints;
+
+    // Keep the checkpoints of up to nbLines lines
+    explicit LongLineIndex( int nbLines );
+
+    LongLineIndex( const LongLineIndex& ) = delete;
+    LongLineIndex& operator=( const LongLineIndex& ) = delete;
+
+    // Returns the checkpoints of the passed line, or null
+    std::shared_ptr<const Checkpoints> get( qint64 line );
+    // Keep the checkpoints of the passed line, unless the index has
+    // been cleared since the passed generation was read.
+    void put( uint64_t generation, qint64 line,
+            std::shared_ptr<const Checkpoints> checkpoints );
+
+    // Must be read before the checkpoints to put are computed
+    uint64_t generation() const;
+    // Remove all the lines, when the lines are changed
+    void clear();
+
+    // Returns the last checkpoint at or before the passed column
+    static Checkpoint closest( const Checkpoints& checkpoints, int column );
+
+  private:
+    typedef std::pair<qint64, std::shared_ptr<const Checkpoints>> Line;
+
+    mutable QMutex mutex_;
+    const size_t nbLines_;
+    // Most recently used first
+    std::list<Line> lines_;
+    uint64_t generation_;
+};
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/mappedfile.h"
+
+#include <mutex>
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <cstdint>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "log.h"
+
+#ifdef Q_OS_UNIX
+namespace {
+    // The part of a mapping the current thread is reading, and whether
+    // it has read pages beyond the end of the file since.
+    struct Guard {
+        const char* begin;
+        const char* end;
+        bool faulted;
+    };
+    thread_local Guard* current_guard = nullptr;
+
+    // The handler we have replaced, and the page size (sysconf cannot
+    // be called from a handler)
+    struct sigaction previous_action;
+    uintptr_t page_size = 4096;
+
+    // The pages beyond the end of a truncated file are replaced by pages
+    // of zeros and the read goes on, no C++ code is jumped over.
+    void busErrorHandler( int signal_number, siginfo_t* info, void* context )
+    {
+        const char* const address = static_cast<const char*>( info->si_addr );
+        Guard* const guard = current_guard;
+        if ( guard && address >= guard->begin && address < guard->end ) {
+            void* const page = reinterpret_cast<void*>(
+                    reinterpret_cast<uintptr_t>( address ) & ~( page_size - 1 ) );
+            if ( mmap( page, page_size, PROT_READ,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0 ) != MAP_FAILED ) {
+                guard->faulted = true;
+                return;
+            }
+        }
+
+        // Not a fault in one of our mappings, it is handled as it would
+        // have been without us (the default action is taken when the
+        // faulting instruction is run again)
+        if ( previous_action.sa_flags & SA_SIGINFO )
+            previous_action.sa_sigaction( signal_number, info, context );
+        else if ( previous_action.sa_handler != SIG_DFL
+                && previous_action.sa_handler != SIG_IGN )
+            previous_action.sa_handler( signal_number );
+        else
+            std::signal( signal_number, SIG_DFL );
+    }
+
+    void installBusErrorHandler()
+    {
+        static std::once_flag installed;
+        std::call_once( installed, []() {
+            page_size = sysconf( _SC_PAGESIZE );
+
+            struct sigaction action = {};
+            action.sa_sigaction = busErrorHandler;
+            action.sa_flags = SA_SIGINFO;
+            sigemptyset( &action.sa_mask );
+            sigaction( SIGBUS, &action, &previous_action );
+        } );
+    }
+
+    // Calls function with the passed range, returns false if it has
+    // read pages beyond the end of the file
+    bool guardedAccess( const char* data, size_t length,
+            const std::function<void( const char* )>& function )
+    {
+        Guard guard = { data, data + length, false };
+        Guard* const previous_guard = current_guard;
+
+        current_guard = &guard;
+        try {
+            function( data );
+        }
+        catch ( ... ) {
+            current_guard = previous_guard;
+            throw;
+        }
+        current_guard = previous_guard;
+
+        return ! guard.faulted;
+    }
+}
+#else
+namespace {
+    // Files cannot be truncated while they are mapped on other OSes.
+    void installBusErrorHandler() {}
+
+    bool guardedAccess( const char* data, size_t,
+            const std::function<void( const char* )>& function )
+    {
+        function( data );
+        return true;
+    }
+}
+#endif
+
+MappedFile::MappedFile()
+    : file_(), data_( nullptr ), size_( 0 ), sequential_( false ),
+    truncated_( false )
+{
+    installBusErrorHandler();
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open( const QString& fileName )
+{
+    close();
+
+    file_.setFileName( fileName );
+    if ( ! file_.open( QIODevice::ReadOnly ) )
+        return false;
+
+    return remap();
+}
+
+void MappedFile::close()
+{
+    if ( data_ )
+        file_.unmap( reinterpret_cast<uchar*>( const_cast<char*>( data_ ) ) );
+    data_ = nullptr;
+    size_ = 0;
+    sequential_ = false;
+    truncated_ = false;
+
+    file_.close();
+}
+
+bool MappedFile::remap()
+{
+    if ( ! file_.isOpen() )
+        return false;
+
+    const qint64 new_size = file_.size();
+    if ( data_ && new_size == size_ && ! truncated_ )
+        return true;
+
+    if ( data_ )
+        file_.unmap( reinterpret_cast<uchar*>( const_cast<char*>( data_ ) ) );
+    data_ = nullptr;
+    size_ = 0;
+    truncated_ = false;
+
+    // Mapping an empty file is an error
+    if ( new_size > 0 ) {
+        data_ = reinterpret_cast<const char*>( file_.map( 0, new_size ) );
+        if ( data_ ) {
+            size_ = new_size;
+            if ( sequential_ )
+                adviseSequential();
+        }
+        else
+            LOG(logWARNING) << "Cannot map file " << file_.fileName().toStdString()
+                << ": " << file_.errorString().toStdString();
+    }
+
+    return data_ != nullptr;
+}
+
+void MappedFile::adviseSequential()
+{
+    sequential_ = true;
+
+#ifdef Q_OS_UNIX
+    if ( data_ )
+        madvise( const_cast<char*>( data_ ), size_, MADV_SEQUENTIAL );
+#endif
+}
+
+void MappedFile::adviseWillNeed( qint64 offset, qint64 length ) const
+{
+#ifdef Q_OS_UNIX
+    // (from the beginning of the page, the mapping starts on one)
+    const qint64 end = qMin( offset + length, size_ );
+    offset -= offset % page_size;
+    if ( data_ && offset >= 0 && offset < end )
+        madvise( const_cast<char*>( data_ ) + offset, end - offset, MADV_WILLNEED );
+#else
+    Q_UNUSED( offset );
+    Q_UNUSED( length );
+#endif
+}
+
+bool MappedFile::access( qint64 offset, qint64 length,
+        const std::function<void( const char* )>& function ) const
+{
+    if ( ! contains( offset, length ) )
+        return false;
+
+    if ( ! guardedAccess( data_ + offset, length, function ) ) {
+        truncated_ = true;
+        LOG(logWARNING) << "File " << file_.fileName().toStdString()
+            << " truncated while reading it";
+        return false;
+    }
+
+    return true;
+}
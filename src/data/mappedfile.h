@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <atomic>
+#include <functional>
+
+#include <QFile>
+#include <QString>
+
+// A read-only memory mapping of a whole file, which can be extended
+// when the file grows.
+// Reading a page of the mapping beyond the end of a file that has been
+// truncated would kill the process (SIGBUS), so all reads from the
+// mapping are done through access(), which reads zeros instead of
+// these pages and reports it.
+// access() can be called from several threads at once, the other
+// functions must not be called concurrently with anything.
+class MappedFile
+{
+  public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+    // Open and map the passed file as big as it is now.
+    // Returns false if the file cannot be mapped (e.g. it is empty
+    // or not a regular file), remap() can then be tried later.
+    bool open( const QString& fileName );
+    // Unmap and close the file.
+    void close();
+    // Extend (or shrink) the mapping to the current size of the file.
+    // Returns false if the file cannot be mapped.
+    bool remap();
+    // Tell the OS the mapping (and its extensions) will be read
+    // sequentially, so it reads ahead aggressively.
+    void adviseSequential();
+    // Tell the OS the range [offset, offset+length) of the mapping will
+    // be read soon, so it starts reading it in the background.
+    void adviseWillNeed( qint64 offset, qint64 length ) const;
+
+    // Returns true if there is a current mapping
+    bool isMapped() const { return data_ != nullptr; }
+    // Size of the current mapping
+    qint64 size() const { return size_; }
+    // Returns true if access() has found the file truncated, the pages
+    // it has replaced by zeros are only read again after remap()
+    bool isTruncated() const { return truncated_; }
+
+    // Returns true if [offset, offset+length) is in the mapping
+    bool contains( qint64 offset, qint64 length ) const
+    { return data_ && ( offset >= 0 ) && ( offset + length <= size_ ); }
+
+    // Calls function with the range [offset, offset+length) of the
+    // mapping, which it reads in place.
+    // Returns false if the range is not in the file anymore, either
+    // because it has been truncated before we start or because it is
+    // truncated while function reads it. The pages function reads after
+    // the end of the file are then zeros, what it has done with them
+    // must be discarded.
+    // (the end of the last page of a truncated file is zeros too, it
+    // is only noticed when the file is indexed again)
+    bool access( qint64 offset, qint64 length,
+            const std::function<void( const char* )>& function ) const;
+
+  private:
+    QFile file_;
+    const char* data_;
+    qint64 size_;
+    bool sequential_;
+    mutable std::atomic<bool> truncated_;
+};
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/memorygovernor.h"
+
+#include <algorithm>
+
+#include "log.h"
+
+namespace {
+    // Incremented each time a consumer is used
+    std::atomic<uint64_t> use_clock( 0 );
+}
+
+MemoryConsumer::MemoryConsumer() : lastUsed_( ++use_clock )
+{
+    MemoryGovernor::get().addConsumer( this );
+}
+
+MemoryConsumer::~MemoryConsumer()
+{
+    MemoryGovernor::get().removeConsumer( this );
+}
+
+void MemoryConsumer::touch() const
+{
+    lastUsed_ = ++use_clock;
+}
+
+MemoryGovernor& MemoryGovernor::get()
+{
+    static MemoryGovernor governor;
+
+    return governor;
+}
+
+MemoryGovernor::MemoryGovernor() : consumers_(), budget_( 0 )
+{
+}
+
+void MemoryGovernor::setBudget( qint64 budget )
+{
+    budget_ = qMax( 0LL, budget );
+}
+
+qint64 MemoryGovernor::memoryUsage() const
+{
+    qint64 usage = 0;
+    for ( const auto consumer : consumers_ )
+        usage += consumer->memoryUsage();
+
+    return usage;
+}
+
+void MemoryGovernor::rebalance()
+{
+    if ( budget_ > 0 )
+        shrinkTo( budget_ );
+}
+
+void MemoryGovernor::shrinkTo( qint64 target )
+{
+    qint64 usage = memoryUsage();
+    if ( usage <= target )
+        return;
+
+    LOG(logDEBUG) << "MemoryGovernor: " << usage << " bytes used, shrinking to "
+        << target;
+
+    // The least recently used consumers are asked first, and all of
+    // them have to drop their caches before any is asked for more.
+    std::vector<MemoryConsumer*> consumers = consumers_;
+    std::sort( consumers.begin(), consumers.end(),
+            []( const MemoryConsumer* a, const MemoryConsumer* b ) {
+                return a->lastUsed() < b->lastUsed(); } );
+
+    for ( const auto level : { MemoryConsumer::Release::Caches,
+            MemoryConsumer::Release::Compact, MemoryConsumer::Release::Sparse } ) {
+        for ( const auto consumer : consumers ) {
+            const qint64 consumer_usage = consumer->memoryUsage();
+            consumer->releaseMemory( level );
+            usage += consumer->memoryUsage() - consumer_usage;
+
+            if ( usage <= target ) {
+                LOG(logDEBUG) << "MemoryGovernor: " << usage << " bytes used";
+                return;
+            }
+        }
+    }
+
+    LOG(logINFO) << "MemoryGovernor: still " << usage
+        << " bytes used after releasing all we could";
+}
+
+void MemoryGovernor::addConsumer( MemoryConsumer* consumer )
+{
+    consumers_.push_back( consumer );
+}
+
+void MemoryGovernor::removeConsumer( MemoryConsumer* consumer )
+{
+    consumers_.erase( std::remove( consumers_.begin(), consumers_.end(), consumer ),
+            consumers_.end() );
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORYGOVERNOR_H
+#define MEMORYGOVERNOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <QtGlobal>
+
+// Something holding memory it can give back on request (caches,
+// line indexes, search results...).
+// A consumer is registered with the MemoryGovernor for its whole life,
+// so it must be created and destroyed in the GUI thread.
+class MemoryConsumer
+{
+  public:
+    // What a consumer can be asked to do to give memory back,
+    // by order of increasing cost for the user.
+    enum class Release {
+        // Drop what can be computed or read again quickly
+        Caches,
+        // Free the unused capacity of the containers
+        Compact,
+        // Keep only part of the line positions in memory
+        Sparse,
+    };
+
+    MemoryConsumer();
+    virtual ~MemoryConsumer();
+
+    MemoryConsumer( const MemoryConsumer& ) = delete;
+    MemoryConsumer& operator=( const MemoryConsumer& ) = delete;
+
+    // Approximate memory held (in bytes)
+    virtual qint64 memoryUsage() const = 0;
+    // Give back what is possible at the passed level
+    virtual void releaseMemory( Release level ) = 0;
+
+    // Mark the consumer as used, the least recently used ones are
+    // asked to release memory first.
+    // Can be called from any thread.
+    void touch() const;
+    uint64_t lastUsed() const { return lastUsed_; }
+
+  private:
+    mutable std::atomic<uint64_t> lastUsed_;
+};
+
+// Keeps the memory held by all the consumers of the process under a
+// budget, by asking them to release some, least recently used first,
+// when it is exceeded.
+// Must only be used from the GUI thread.
+class MemoryGovernor
+{
+  public:
+    static MemoryGovernor& get();
+
+    // Set the total memory the consumers should hold (in bytes,
+    // 0 means there is no limit), effective from the next rebalance().
+    void setBudget( qint64 budget );
+    qint64 budget() const { return budget_; }
+
+    // Total memory held by the consumers
+    qint64 memoryUsage() const;
+
+    // Ask the consumers to release memory until the total is under
+    // the budget. Called when the consumers have grown.
+    void rebalance();
+    // Ask the consumers to release memory until the total is under
+    // target (or there is nothing more they can release).
+    void shrinkTo( qint64 target );
+
+  private:
+    friend class MemoryConsumer;
+
+    MemoryGovernor();
+
+    void addConsumer( MemoryConsumer* consumer );
+    void removeConsumer( MemoryConsumer* consumer );
+
+    std::vector<MemoryConsumer*> consumers_;
+    qint64 budget_;
+};
+
+#endif
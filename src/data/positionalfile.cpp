@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/positionalfile.h"
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+PositionalFile::PositionalFile( const QString& fileName )
+    : file_( fileName ), seekMutex_()
+{
+}
+
+bool PositionalFile::open()
+{
+    return file_.open( QIODevice::ReadOnly );
+}
+
+bool PositionalFile::read( qint64 offset, qint64 length, char* buffer ) const
+{
+    if ( ! file_.isOpen() )
+        return false;
+
+#ifdef Q_OS_UNIX
+    const int handle = file_.handle();
+    qint64 done = 0;
+    while ( done < length ) {
+        const ssize_t nb_read = pread( handle, buffer + done, length - done, offset + done );
+        if ( nb_read < 0 && errno == EINTR )
+            continue;
+        else if ( nb_read <= 0 )
+            return false;
+        done += nb_read;
+    }
+
+    return true;
+#else
+    QMutexLocker locker( &seekMutex_ );
+
+    return file_.seek( offset ) && ( file_.read( buffer, length ) == length );
+#endif
+}
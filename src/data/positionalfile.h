@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POSITIONALFILE_H
+#define POSITIONALFILE_H
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+
+// A read-only file read at explicit positions, without seeking, so
+// any number of threads can read it at once.
+// Only read() can be called concurrently with the other functions.
+class PositionalFile
+{
+  public:
+    explicit PositionalFile( const QString& fileName );
+
+    PositionalFile( const PositionalFile& ) = delete;
+    PositionalFile& operator=( const PositionalFile& ) = delete;
+
+    // Open the file, returns false if it cannot be read
+    bool open();
+    bool isOpen() const { return file_.isOpen(); }
+
+    QString fileName() const { return file_.fileName(); }
+    // Current size of the file
+    qint64 size() const { return file_.size(); }
+
+    // Read the bytes [offset, offset+length) into the passed buffer.
+    // Returns false if they cannot all be read (e.g. the file has
+    // been truncated).
+    bool read( qint64 offset, qint64 length, char* buffer ) const;
+
+  private:
+    mutable QFile file_;
+    // Serialises the reads on the OSes without pread
+    mutable QMutex seekMutex_;
+};
+
+#endif
@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/searchresultarray.h"
+
+#include <algorithm>
+
+#include <QtAlgorithms>
+
+const int SearchResultArray::chunkSize;
+
+// A chunk of matches, never changed once made.
+// The matches are found from their position: the bit of their line
+// for a bitmap, their index otherwise.
+class SearchResultArray::Chunk
+{
+  public:
+    // Make a chunk of the passed lines (in increasing order)
+    explicit Chunk( const std::vector<LineNumber>& lines );
+
+    int size() const { return size_; }
+    LineNumber lastLine() const { return last_; }
+
+    // Returns the line of the passed match
+    LineNumber line( int index ) const;
+    // Returns the index of the first match at or after the passed line
+    // (size() if there are none)
+    int lowerBound( LineNumber line ) const;
+
+    // Returns the position of the passed match
+    int position( int index ) const
+    { return kind_ == Kind::Bitmap ? line( index ) - first_ : index; }
+    // Returns the position of the match following the one at the passed
+    // position (which must not be the last)
+    int nextPosition( int position ) const;
+    LineNumber lineAt( int position ) const;
+
+    qint64 memoryUsage() const;
+
+  private:
+    // Number of words of the bitmap in each group a rank is kept for
+    static const int rankWords = 8;
+
+    enum class Kind { Bitmap, Offsets, Lines };
+
+    Kind kind_;
+    LineNumber first_;
+    LineNumber last_;
+    int size_;
+
+    // The bits of the lines from first_ to last_, and the number of
+    // matches before each group of rankWords words
+    std::vector<quint64> bits_;
+    std::vector<uint16_t> ranks_;
+    // The offsets of the lines from first_
+    std::vector<uint16_t> offsets_;
+    // The lines, when they are too far apart for the above
+    std::vector<LineNumber> lines_;
+};
+
+// The bitmap is used when smaller than the offsets (more than one line
+// every 16 matches), the offsets when they fit in 16 bits.
+SearchResultArray::Chunk::Chunk( const std::vector<LineNumber>& lines )
+    : first_( lines.front() ), last_( lines.back() ),
+    size_( static_cast<int>( lines.size() ) )
+{
+    const quint64 span = quint64( last_ ) - first_ + 1;
+
+    if ( span <= 0x10000 && span / 8 < quint64( size_ ) * 2 ) {
+        kind_ = Kind::Bitmap;
+        bits_.assign( ( span + 63 ) / 64, 0 );
+        for ( const LineNumber line : lines ) {
+            const LineNumber bit = line - first_;
+            bits_[ bit / 64 ] |= quint64( 1 ) << ( bit % 64 );
+        }
+
+        int rank = 0;
+        for ( size_t w = 0; w < bits_.size(); ++w ) {
+            if ( w % rankWords == 0 )
+                ranks_.push_back( rank );
+            rank += qPopulationCount( bits_[w] );
+        }
+    }
+    else if ( span <= 0x10000 ) {
+        kind_ = Kind::Offsets;
+        offsets_.reserve( size_ );
+        for ( const LineNumber line : lines )
+            offsets_.push_back( line - first_ );
+    }
+    else {
+        kind_ = Kind::Lines;
+        lines_ = lines;
+    }
+}
+
+LineNumber SearchResultArray::Chunk::line( int index ) const
+{
+    if ( kind_ == Kind::Offsets )
+        return first_ + offsets_[ index ];
+    else if ( kind_ == Kind::Lines )
+        return lines_[ index ];
+
+    // Count the matches from the last group starting before it
+    const int group = std::upper_bound( ranks_.begin(), ranks_.end(), index )
+        - ranks_.begin() - 1;
+    int rank = ranks_[ group ];
+    size_t w = group * rankWords;
+    while ( rank + static_cast<int>( qPopulationCount( bits_[w] ) ) <= index )
+        rank += qPopulationCount( bits_[ w++ ] );
+
+    quint64 word = bits_[w];
+    for ( int i = rank; i < index; ++i )
+        word &= word - 1;
+
+    return first_ + w * 64 + qCountTrailingZeroBits( word );
+}
+
+int SearchResultArray::Chunk::lowerBound( LineNumber line ) const
+{
+    if ( line <= first_ )
+        return 0;
+    else if ( line > last_ )
+        return size_;
+
+    const LineNumber offset = line - first_;
+    switch ( kind_ ) {
+        case Kind::Bitmap: {
+            // The matches before the bit of the line
+            const size_t word = offset / 64;
+            int rank = ranks_[ word / rankWords ];
+            for ( size_t w = word - word % rankWords; w < word; ++w )
+                rank += qPopulationCount( bits_[w] );
+            return rank + qPopulationCount(
+                    bits_[ word ] & ( ( quint64( 1 ) << ( offset % 64 ) ) - 1 ) );
+        }
+        case Kind::Offsets:
+            return std::lower_bound( offsets_.begin(), offsets_.end(), offset )
+                - offsets_.begin();
+        default:
+            return std::lower_bound( lines_.begin(), lines_.end(), line )
+                - lines_.begin();
+    }
+}
+
+int SearchResultArray::Chunk::nextPosition( int position ) const
+{
+    if ( kind_ != Kind::Bitmap )
+        return position + 1;
+
+    // The next bit set
+    size_t w = ( position + 1 ) / 64;
+    quint64 word = bits_[w] & ( ~quint64( 0 ) << ( ( position + 1 ) % 64 ) );
+    while ( word == 0 )
+        word = bits_[ ++w ];
+
+    return w * 64 + qCountTrailingZeroBits( word );
+}
+
+LineNumber SearchResultArray::Chunk::lineAt( int position ) const
+{
+    switch ( kind_ ) {
+        case Kind::Bitmap:
+            return first_ + position;
+        case Kind::Offsets:
+            return first_ + offsets_[ position ];
+        default:
+            return lines_[ position ];
+    }
+}
+
+qint64 SearchResultArray::Chunk::memoryUsage() const
+{
+    return sizeof( *this )
+        + bits_.capacity() * sizeof( quint64 )
+        + ranks_.capacity() * sizeof( uint16_t )
+        + offsets_.capacity() * sizeof( uint16_t )
+        + lines_.capacity() * sizeof( LineNumber );
+}
+
+// The chunks of the arrays sharing them.
+// The entries are only set once, by the array which has reserved them
+// by incrementing nbUsed (the others only read the ones before).
+struct SearchResultArray::Directory
+{
+    struct Entry {
+        std::shared_ptr<const Chunk> chunk;
+        // Number of matches in the chunks before it
+        size_t firstMatch;
+    };
+
+    explicit Directory( size_t capacity )
+        : entries( new Entry[ capacity ] ), capacity( capacity ), nbUsed( 0 ) {}
+
+    std::unique_ptr<Entry[]> entries;
+    const size_t capacity;
+    std::atomic<size_t> nbUsed;
+};
+
+SearchResultArray::SearchResultArray()
+    : directory_(), nbChunks_( 0 ), nbChunkMatches_( 0 ), tail_()
+{
+}
+
+MatchingLine SearchResultArray::operator[]( size_t index ) const
+{
+    if ( index >= nbChunkMatches_ )
+        return MatchingLine( tail_[ index - nbChunkMatches_ ] );
+
+    const Directory::Entry& entry = directory_->entries[ chunkOf( index ) ];
+    return MatchingLine( entry.chunk->line( index - entry.firstMatch ) );
+}
+
+size_t SearchResultArray::lowerBound( LineNumber line ) const
+{
+    const Directory::Entry* const entries = directory_ ? directory_->entries.get() : nullptr;
+    const Directory::Entry* const entry = std::lower_bound( entries, entries + nbChunks_, line,
+            []( const Directory::Entry& e, LineNumber l ) { return e.chunk->lastLine() < l; } );
+    if ( entry != entries + nbChunks_ )
+        return entry->firstMatch + entry->chunk->lowerBound( line );
+
+    return nbChunkMatches_
+        + ( std::lower_bound( tail_.begin(), tail_.end(), line ) - tail_.begin() );
+}
+
+bool SearchResultArray::contains( LineNumber line ) const
+{
+    const size_t index = lowerBound( line );
+    return index < size() && ( *this )[ index ].lineNumber() == line;
+}
+
+SearchResultArray::const_iterator SearchResultArray::begin() const
+{
+    return const_iterator( this, 0 );
+}
+
+SearchResultArray::const_iterator SearchResultArray::end() const
+{
+    return const_iterator( this, size() );
+}
+
+SearchResultArray::const_iterator SearchResultArray::cbegin() const
+{
+    return begin();
+}
+
+SearchResultArray::const_iterator SearchResultArray::cend() const
+{
+    return end();
+}
+
+void SearchResultArray::push_back( const MatchingLine& match )
+{
+    tail_.push_back( match.lineNumber() );
+    if ( tail_.size() == static_cast<size_t>( chunkSize ) )
+        seal();
+}
+
+void SearchResultArray::append( const SearchResultArray& other )
+{
+    for ( const_iterator i = other.begin(); i != other.end(); ++i )
+        push_back( *i );
+}
+
+void SearchResultArray::pop_back()
+{
+    if ( tail_.empty() ) {
+        // Take the matches of our last chunk back
+        const Directory::Entry& entry = directory_->entries[ nbChunks_ - 1 ];
+        const Chunk& chunk = *entry.chunk;
+        int position = 0;
+        for ( int i = 0; i < chunk.size(); ++i ) {
+            if ( i > 0 )
+                position = chunk.nextPosition( position );
+            tail_.push_back( chunk.lineAt( position ) );
+        }
+
+        nbChunkMatches_ = entry.firstMatch;
+        --nbChunks_;
+    }
+
+    tail_.pop_back();
+}
+
+void SearchResultArray::clear()
+{
+    directory_.reset();
+    nbChunks_ = 0;
+    nbChunkMatches_ = 0;
+    tail_.clear();
+}
+
+qint64 SearchResultArray::memoryUsage() const
+{
+    qint64 usage = unsharedMemoryUsage();
+    if ( directory_ ) {
+        usage += directory_->capacity * sizeof( Directory::Entry );
+        for ( size_t i = 0; i < nbChunks_; ++i )
+            usage += directory_->entries[i].chunk->memoryUsage();
+    }
+
+    return usage;
+}
+
+qint64 SearchResultArray::unsharedMemoryUsage() const
+{
+    return tail_.capacity() * sizeof( LineNumber );
+}
+
+size_t SearchResultArray::chunkOf( size_t index ) const
+{
+    const Directory::Entry* const entries = directory_->entries.get();
+    return std::upper_bound( entries, entries + nbChunks_, index,
+            []( size_t i, const Directory::Entry& e ) { return i < e.firstMatch; } )
+        - entries - 1;
+}
+
+// The chunk is added to the shared directory if no copy has added
+// one after ours, the directory is copied otherwise.
+void SearchResultArray::seal()
+{
+    std::shared_ptr<const Chunk> chunk = std::make_shared<const Chunk>( tail_ );
+
+    size_t expected = nbChunks_;
+    if ( ! ( directory_ && nbChunks_ < directory_->capacity
+                && directory_->nbUsed.compare_exchange_strong( expected, nbChunks_ + 1 ) ) ) {
+        auto directory = std::make_shared<Directory>( qMax<size_t>( 16, 2 * ( nbChunks_ + 1 ) ) );
+        for ( size_t i = 0; i < nbChunks_; ++i )
+            directory->entries[i] = directory_->entries[i];
+        directory->nbUsed = nbChunks_ + 1;
+        directory_ = std::move( directory );
+    }
+
+    directory_->entries[ nbChunks_ ] = { std::move( chunk ), nbChunkMatches_ };
+    ++nbChunks_;
+    nbChunkMatches_ += tail_.size();
+    tail_.clear();
+}
+
+SearchResultArray::const_iterator::const_iterator(
+        const SearchResultArray* array, size_t index )
+    : array_( array ), index_( index ), chunk_( array->nbChunks_ ),
+    matchInChunk_( 0 ), position_( 0 ), line_( 0 )
+{
+    if ( index >= array->size() )
+        return;
+
+    if ( index < array->nbChunkMatches_ ) {
+        chunk_ = array->chunkOf( index );
+        const Directory::Entry& entry = array->directory_->entries[ chunk_ ];
+        matchInChunk_ = index - entry.firstMatch;
+        position_ = entry.chunk->position( matchInChunk_ );
+    }
+    else {
+        matchInChunk_ = index - array->nbChunkMatches_;
+        position_ = matchInChunk_;
+    }
+    readLine();
+}
+
+SearchResultArray::const_iterator& SearchResultArray::const_iterator::operator++()
+{
+    ++index_;
+    if ( index_ >= array_->size() )
+        return *this;
+
+    ++matchInChunk_;
+    if ( chunk_ < array_->nbChunks_ ) {
+        const Chunk& chunk = *array_->directory_->entries[ chunk_ ].chunk;
+        if ( matchInChunk_ < chunk.size() ) {
+            position_ = chunk.nextPosition( position_ );
+        }
+        else {
+            // (the first match of a chunk is at position 0)
+            ++chunk_;
+            matchInChunk_ = 0;
+            position_ = 0;
+        }
+    }
+    else {
+        position_ = matchInChunk_;
+    }
+    readLine();
+
+    return *this;
+}
+
+void SearchResultArray::const_iterator::readLine()
+{
+    if ( chunk_ < array_->nbChunks_ )
+        line_ = array_->directory_->entries[ chunk_ ].chunk->lineAt( position_ );
+    else
+        line_ = array_->tail_[ position_ ];
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEARCHRESULTARRAY_H
+#define SEARCHRESULTARRAY_H
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <QtGlobal>
+
+// Line number are unsigned 32 bits for now.
+typedef uint32_t LineNumber;
+
+// Class encapsulating a single matching line
+// Contains the line number the line was found in and its content.
+class MatchingLine {
+  public:
+    MatchingLine( LineNumber line ) { lineNumber_ = line; };
+
+    // Accessors
+    LineNumber lineNumber() const { return lineNumber_; }
+
+    bool operator <( const MatchingLine& other) const
+    { return lineNumber_ < other.lineNumber_; }
+
+  private:
+    LineNumber lineNumber_;
+};
+
+// This is an array of matching lines, in increasing order, which only
+// grows at its end.
+// The matches are kept by chunks of chunkSize matches, each stored as
+// a bitmap of the lines it spans if they are dense, or as their offsets
+// from its first line otherwise. Only the last matches, not making a
+// whole chunk yet, are kept as they are.
+// The chunks are never changed and shared by the copies of the array,
+// so copying it (to hand over the matches found so far) only copies
+// these last matches.
+// Like a std::vector, different copies can be used by different threads.
+class SearchResultArray
+{
+  public:
+    // Number of matches in each chunk
+    static const int chunkSize = 4096;
+
+    class const_iterator;
+
+    SearchResultArray();
+
+    size_t size() const { return nbChunkMatches_ + tail_.size(); }
+    bool empty() const { return size() == 0; }
+
+    // Returns the passed match (index must be less than size())
+    MatchingLine operator[]( size_t index ) const;
+    MatchingLine back() const { return ( *this )[ size() - 1 ]; }
+    // Returns the index of the first match at or after the passed line,
+    // or size() if there are none
+    size_t lowerBound( LineNumber line ) const;
+    bool contains( LineNumber line ) const;
+
+    // Iterate over the matches in order (which is faster than indexing)
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator cbegin() const;
+    const_iterator cend() const;
+
+    // Add a match, which must be after the last one
+    void push_back( const MatchingLine& match );
+    // Add all the matches of the passed array, which must be after
+    // the last one
+    void append( const SearchResultArray& other );
+    // Remove the last match
+    void pop_back();
+    void clear();
+    // Free the memory allocated for future matches
+    void shrink_to_fit() { tail_.shrink_to_fit(); }
+
+    // Memory used by the matches (in bytes, including the shared chunks)
+    qint64 memoryUsage() const;
+    // Memory used by the last matches only, which are never shared
+    // with the copies (unlike the chunks)
+    qint64 unsharedMemoryUsage() const;
+
+  private:
+    class Chunk;
+    struct Directory;
+
+    // Returns the index of the chunk containing the passed match
+    size_t chunkOf( size_t index ) const;
+    // Make a chunk of the last matches
+    void seal();
+
+    // The chunks, of which the first nbChunks_ are ours (the others
+    // have been added by a copy sharing them)
+    std::shared_ptr<Directory> directory_;
+    size_t nbChunks_;
+    // Number of matches in our chunks
+    size_t nbChunkMatches_;
+    // The matches after them
+    std::vector<LineNumber> tail_;
+};
+
+// Goes through the matches in order, sequentially.
+class SearchResultArray::const_iterator
+{
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef MatchingLine value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const MatchingLine* pointer;
+    typedef MatchingLine reference;
+
+    MatchingLine operator*() const { return MatchingLine( line_ ); }
+    const_iterator& operator++();
+
+    bool operator==( const const_iterator& other ) const
+    { return index_ == other.index_; }
+    bool operator!=( const const_iterator& other ) const
+    { return index_ != other.index_; }
+
+  private:
+    friend class SearchResultArray;
+
+    const_iterator( const SearchResultArray* array, size_t index );
+    // Read the line of the match we are at
+    void readLine();
+
+    const SearchResultArray* array_;
+    // Index of the match in the array
+    size_t index_;
+    // Chunk containing it (nbChunks_ for the last matches), index
+    // of the match in the chunk and its position (see Chunk)
+    size_t chunk_;
+    int matchInChunk_;
+    int position_;
+    LineNumber line_;
+};
+
+#endif
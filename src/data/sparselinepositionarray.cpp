@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/sparselinepositionarray.h"
+
+#include <QByteArray>
+
+#include "log.h"
+
+SparseLinePositionArray::SparseLinePositionArray( const QString& fileName,
+        int stride, int nbCachedBlocks, LineScanner::CodeUnit unit )
+    : fileName_( fileName ), stride_( qMax( 2, stride ) ),
+    nbCachedBlocks_( qMax( 1, nbCachedBlocks ) ),
+    scanner_( LineScanner::bestKernel(), unit ),
+    samples_(), tail_( std::make_shared<FastLinePositionArray>() ),
+    cachedBlocks_(), file_( fileName ), mutex_()
+{
+}
+
+void SparseLinePositionArray::append_list( const FastLinePositionArray& other )
+{
+    QMutexLocker locker( &mutex_ );
+
+    // The tail is copied rather than changed, for those who kept it.
+    // As in LinePosition, our fake LF is removed even if nothing is added
+    std::shared_ptr<FastLinePositionArray> tail =
+        std::make_shared<FastLinePositionArray>();
+    const int tail_size = tail_->size() - ( tail_->hasFakeFinalLF() ? 1 : 0 );
+    for ( int i = 0; i < tail_size; ++i )
+        tail->append( tail_->at( i ) );
+
+    for ( int i = 0; i < other.size(); ++i ) {
+        tail->append( other.at( i ) );
+
+        // A block ending with the fake LF is not complete yet
+        const bool fake = other.hasFakeFinalLF() && ( i == other.size() - 1 );
+        if ( tail->size() == stride_ && ! fake ) {
+            samples_.append( tail->at( stride_ - 1 ) );
+            *tail = FastLinePositionArray();
+        }
+    }
+
+    if ( other.hasFakeFinalLF() )
+        tail->setFakeFinalLF();
+
+    tail_ = std::move( tail );
+}
+
+void SparseLinePositionArray::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    samples_ = LinePositionArray();
+    tail_ = std::make_shared<FastLinePositionArray>();
+    cachedBlocks_.clear();
+}
+
+void SparseLinePositionArray::dropCachedBlocks()
+{
+    QMutexLocker locker( &mutex_ );
+
+    cachedBlocks_.clear();
+}
+
+size_t SparseLinePositionArray::memoryUsage() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return samples_.memoryUsage() + tail_->memoryUsage()
+        + cachedBlocks_.size() * stride_ * sizeof( uint64_t );
+}
+
+LineNumber SparseLinePositionArray::size() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return static_cast<LineNumber>( samples_.size() ) * stride_ + tail_->size();
+}
+
+bool SparseLinePositionArray::hasFakeFinalLF() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return tail_->hasFakeFinalLF();
+}
+
+std::shared_ptr<const FastLinePositionArray> SparseLinePositionArray::tail() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return tail_;
+}
+
+uint64_t SparseLinePositionArray::at( LineNumber i ) const
+{
+    const LineNumber block = i / stride_;
+    const int index = i % stride_;
+
+    qint64 beginning;
+    qint64 end;
+    {
+        QMutexLocker locker( &mutex_ );
+
+        if ( block >= static_cast<LineNumber>( samples_.size() ) )
+            return tail_->at( index );
+        else if ( index == stride_ - 1 )
+            return samples_.at( block );
+        else if ( const std::vector<uint64_t>* positions = cachedBlock( block ) )
+            return ( *positions )[index];
+
+        // The block starts after the end of the previous one
+        beginning = ( block == 0 ) ? 0 : samples_.at( block - 1 );
+        end = samples_.at( block );
+
+        if ( ! file_.isOpen() )
+            file_.open();
+    }
+
+    std::vector<uint64_t> positions = readBlock( beginning, end );
+    if ( positions.size() != static_cast<size_t>( stride_ ) ) {
+        // The file has changed under us, a full reindex will follow
+        LOG(logWARNING) << "Cannot find the lines of block " << block
+            << " in " << fileName_.toStdString();
+        positions.resize( stride_, end );
+        return positions[index];
+    }
+    const uint64_t position = positions[index];
+
+    QMutexLocker locker( &mutex_ );
+
+    // (another thread might have read it meanwhile)
+    if ( ! cachedBlock( block ) ) {
+        if ( cachedBlocks_.size() >= nbCachedBlocks_ )
+            cachedBlocks_.pop_back();
+        cachedBlocks_.emplace_front( block, std::move( positions ) );
+    }
+
+    return position;
+}
+
+const std::vector<uint64_t>* SparseLinePositionArray::cachedBlock(
+        LineNumber block ) const
+{
+    for ( auto i = cachedBlocks_.begin(); i != cachedBlocks_.end(); ++i ) {
+        if ( i->first == block ) {
+            cachedBlocks_.splice( cachedBlocks_.begin(), cachedBlocks_, i );
+            return &cachedBlocks_.front().second;
+        }
+    }
+
+    return nullptr;
+}
+
+std::vector<uint64_t> SparseLinePositionArray::readBlock(
+        qint64 beginning, qint64 end ) const
+{
+    std::vector<uint64_t> positions;
+    positions.reserve( stride_ );
+
+    QByteArray data( end - beginning, Qt::Uninitialized );
+    if ( file_.read( beginning, data.size(), data.data() ) ) {
+        const int size = scanner_.alignedSize( data.size() );
+        int offset = 0;
+        int lf;
+        while ( ( lf = scanner_.findLineFeed( data.constData() + offset,
+                        size - offset ) ) >= 0 ) {
+            offset += lf + scanner_.unitSize();
+            positions.push_back( beginning + offset );
+        }
+    }
+
+    return positions;
+}
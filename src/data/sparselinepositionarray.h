@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPARSELINEPOSITIONARRAY_H
+#define SPARSELINEPOSITIONARRAY_H
+
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QMutex>
+#include <QString>
+
+#include "data/linepositionarray.h"
+#include "data/linescanner.h"
+#include "data/positionalfile.h"
+#include "utils.h"
+
+// A list of end of lines positions for files with too many lines
+// to keep them all in memory.
+// Only the last position of each block of 'stride' lines is kept, the
+// others are found again by reading the block from the file when asked
+// for, and the most recently used blocks are cached.
+// Like LinePosition, it handles the fake final LF of non-LF terminated
+// files. Thread-safe, the file is read without holding the lock so the
+// other threads are not blocked meanwhile.
+class SparseLinePositionArray
+{
+  public:
+    // Keep one position every stride lines of the passed file,
+    // and up to nbCachedBlocks blocks read again from it (looking for
+    // its end of lines on the passed code units).
+    SparseLinePositionArray( const QString& fileName, int stride,
+            int nbCachedBlocks,
+            LineScanner::CodeUnit unit = LineScanner::CodeUnit::Byte );
+
+    SparseLinePositionArray( const SparseLinePositionArray& ) = delete;
+    SparseLinePositionArray& operator=( const SparseLinePositionArray& ) = delete;
+
+    // Add the passed positions after the existing ones, removing any
+    // fake LF we might have.
+    void append_list( const FastLinePositionArray& other );
+
+    // Remove all the positions
+    void clear();
+
+    // Number of positions
+    LineNumber size() const;
+    // Extract an element, which might read the file
+    uint64_t at( LineNumber i ) const;
+
+    // Whether the last position is a fake final LF
+    bool hasFakeFinalLF() const;
+    // The positions after the last complete block, they are never
+    // changed: the next append_list replaces them with new ones.
+    std::shared_ptr<const FastLinePositionArray> tail() const;
+
+    // Number of lines of the blocks
+    int stride() const { return stride_; }
+
+    // Forget the blocks read from the file
+    void dropCachedBlocks();
+    // Approximate memory used (in bytes)
+    size_t memoryUsage() const;
+
+  private:
+    typedef std::pair<LineNumber, std::vector<uint64_t>> Block;
+
+    // Returns the cached positions of the passed block (null if
+    // they are not cached), called with mutex_ held
+    const std::vector<uint64_t>* cachedBlock( LineNumber block ) const;
+    // Read the positions of the lines in [beginning, end) of the file
+    std::vector<uint64_t> readBlock( qint64 beginning, qint64 end ) const;
+
+    const QString fileName_;
+    const int stride_;
+    const size_t nbCachedBlocks_;
+    const LineScanner scanner_;
+
+    // The last position of each complete block
+    LinePositionArray samples_;
+    // All the positions after the last complete block
+    std::shared_ptr<const FastLinePositionArray> tail_;
+
+    // Most recently used first
+    mutable std::list<Block> cachedBlocks_;
+    mutable PositionalFile file_;
+
+    // Protects everything but the reads from the file
+    mutable QMutex mutex_;
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data/trigramindex.h"
+
+#include <utility>
+
+#include "data/abstractlogdata.h"
+
+const int TrigramIndex::blockLines;
+
+namespace {
+    // Number of bits of the bitmaps (as a power of 2)
+    const int bitmapBits = 16;
+
+    inline uint foldCase( uchar c )
+    {
+        return ( c >= 'A' && c <= 'Z' ) ? ( c | 0x20 ) : c;
+    }
+
+    // Returns the bit of the trigram ending at the passed byte, whose
+    // two previous bytes (folded) are in the low bits of *previous
+    inline int trigramBit( uint* previous, uchar c )
+    {
+        *previous = ( ( *previous << 8 ) | foldCase( c ) ) & 0xFFFFFF;
+        return ( *previous * 2654435761u ) >> ( 32 - bitmapBits );
+    }
+}
+
+TrigramIndex::TrigramIndex() : mutex_(), blocks_(), generation_( 0 )
+{
+}
+
+TrigramIndex::Trigrams TrigramIndex::trigramsOf( const QByteArray& literal )
+{
+    Trigrams trigrams;
+    uint previous = 0;
+    for ( int i = 0; i < literal.size(); ++i ) {
+        const int bit = trigramBit( &previous, literal[i] );
+        if ( i >= 2 )
+            trigrams.push_back( bit );
+    }
+
+    return trigrams;
+}
+
+TrigramIndex::Bitmap TrigramIndex::bitmapOf( const RawLines& lines )
+{
+    Bitmap bitmap( ( 1 << bitmapBits ) / 64, 0 );
+    for ( int i = 0; i < lines.size(); ++i ) {
+        const uchar* const bytes = reinterpret_cast<const uchar*>( lines.lineData( i ) );
+        const int size = lines.lineSize( i );
+        uint previous = 0;
+        for ( int j = 0; j < size; ++j ) {
+            const int bit = trigramBit( &previous, bytes[j] );
+            if ( j >= 2 )
+                bitmap[ bit / 64 ] |= quint64( 1 ) << ( bit % 64 );
+        }
+    }
+
+    return bitmap;
+}
+
+qint64 TrigramIndex::nbBlocks() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return blocks_.size();
+}
+
+bool TrigramIndex::mayContain( qint64 block, const Trigrams& trigrams ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( block >= static_cast<qint64>( blocks_.size() ) )
+        return true;
+
+    const Bitmap& bitmap = blocks_[block];
+    for ( const int bit : trigrams ) {
+        if ( ! ( bitmap[ bit / 64 ] & ( quint64( 1 ) << ( bit % 64 ) ) ) )
+            return false;
+    }
+
+    return true;
+}
+
+bool TrigramIndex::append( uint64_t generation, qint64 block, Bitmap bitmap )
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( generation != generation_ || block != static_cast<qint64>( blocks_.size() ) )
+        return false;
+
+    blocks_.push_back( std::move( bitmap ) );
+    return true;
+}
+
+uint64_t TrigramIndex::generation() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return generation_;
+}
+
+void TrigramIndex::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    ++generation_;
+    std::vector<Bitmap>().swap( blocks_ );
+}
+
+qint64 TrigramIndex::memoryUsage() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return static_cast<qint64>( blocks_.size() ) * ( 1 << bitmapBits ) / 8;
+}
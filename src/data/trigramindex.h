@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 Sergei Dyshel and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <cstdint>
+#include <vector>
+
+#include <QByteArray>
+#include <QMutex>
+#include <QtGlobal>
+
+class RawLines;
+
+// The trigrams (strings of three bytes, the case of the ASCII letters
+// ignored) contained in each block of lines of a file, so the searches
+// can skip the blocks which cannot contain a literal all their
+// matches contain.
+// Each block has a bitmap of the hashes of its trigrams: a block lacking
+// one of the trigrams of a literal cannot contain it (the converse is
+// not true, when hashes collide the block is just read for nothing).
+// The blocks are added at the end, as the file grows, and all removed
+// when its lines change.
+// Thread-safe.
+class TrigramIndex
+{
+  public:
+    // Number of lines in each block
+    static const int blockLines = 8192;
+
+    // The bits of a set of trigrams in the bitmaps
+    typedef std::vector<int> Trigrams;
+    // The bitmap of a block
+    typedef std::vector<quint64> Bitmap;
+
+    TrigramIndex();
+
+    TrigramIndex( const TrigramIndex& ) = delete;
+    TrigramIndex& operator=( const TrigramIndex& ) = delete;
+
+    // Returns the trigrams of the passed literal (none if it is shorter
+    // than a trigram)
+    static Trigrams trigramsOf( const QByteArray& literal );
+    // Returns the bitmap of the trigrams of the passed lines
+    static Bitmap bitmapOf( const RawLines& lines );
+
+    // Number of blocks indexed (the first ones of the file)
+    qint64 nbBlocks() const;
+    // Returns whether the passed block might contain all the passed
+    // trigrams (always true if it is not indexed)
+    bool mayContain( qint64 block, const Trigrams& trigrams ) const;
+
+    // Add the bitmap of the passed block, which must be the one following
+    // the last indexed, unless the index has been cleared since the
+    // passed generation was read.
+    // Returns whether it has been added.
+    bool append( uint64_t generation, qint64 block, Bitmap bitmap );
+
+    // Must be read before the bitmaps to append are computed
+    uint64_t generation() const;
+    // Remove all the blocks, when the lines are changed
+    void clear();
+
+    qint64 memoryUsage() const;
+
+  private:
+    mutable QMutex mutex_;
+    std::vector<Bitmap> blocks_;
+    uint64_t generation_;
+};
+
+#endif
@@ -19,8 +19,43 @@
 
 #include "encodingspeculator.h"
 
+#include <cstring>
 #include <iostream>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Returns the first byte of [begin, end) with its high bit set
+    // (end if there is none)
+    const uint8_t* findNonAscii( const uint8_t* begin, const uint8_t* end )
+    {
+        const uint8_t* p = begin;
+
+#ifdef __SSE2__
+        for ( ; end - p >= 16; p += 16 ) {
+            const int mask = _mm_movemask_epi8(
+                    _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) ) );
+            if ( mask )
+                return p + __builtin_ctz( mask );
+        }
+#else
+        for ( ; end - p >= 8; p += 8 ) {
+            uint64_t word;
+            memcpy( &word, p, sizeof( word ) );
+            if ( word & 0x8080808080808080ULL )
+                break;
+        }
+#endif
+
+        while ( p < end && ! ( *p & 0x80 ) )
+            ++p;
+
+        return p;
+    }
+}
+
 void EncodingSpeculator::inject_byte( uint8_t byte )
 {
     if ( ! ( byte & 0x80 ) ) {
@@ -113,6 +148,28 @@ void EncodingSpeculator::inject_byte( uint8_t byte )
     }
 }
 
+void EncodingSpeculator::inject_block( const char* block, size_t size )
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>( block );
+    const uint8_t* const end = p + size;
+
+    // A 7-bit byte only changes the state if it is the first one
+    if ( state_ == State::Start && p < end )
+        inject_byte( *p++ );
+
+    while ( p < end ) {
+        // Nothing can get us out of these
+        if ( state_ == State::OtherOrUnknown8Bit
+                || state_ == State::ValidUTF16LE
+                || state_ == State::ValidUTF16BE )
+            return;
+
+        p = findNonAscii( p, end );
+        if ( p < end )
+            inject_byte( *p++ );
+    }
+}
+
 EncodingSpeculator::Encoding EncodingSpeculator::guess() const
 {
     Encoding guess;
@@ -141,3 +198,23 @@ EncodingSpeculator::Encoding EncodingSpeculator::guess() const
 
     return guess;
 }
+
+void EncodingSpeculator::resume( Encoding guess )
+{
+    switch ( guess ) {
+        case Encoding::ASCII7:
+            state_ = State::ASCIIOnly;
+            break;
+        case Encoding::UTF8:
+            state_ = State::ValidUTF8;
+            break;
+        case Encoding::UTF16LE:
+            state_ = State::ValidUTF16LE;
+            break;
+        case Encoding::UTF16BE:
+            state_ = State::ValidUTF16BE;
+            break;
+        default:
+            state_ = State::OtherOrUnknown8Bit;
+    }
+}
@@ -20,6 +20,7 @@
 #ifndef ENCODINGSPECULATOR_H
 #define ENCODINGSPECULATOR_H
 
+#include <cstddef>
 #include <cstdint>
 
 // The encoder speculator tries to determine the likely encoding
@@ -43,10 +44,17 @@ class EncodingSpeculator {
 
     // Inject one byte into the speculator
     void inject_byte( uint8_t byte );
+    // Inject a block of bytes, same as injecting them one by one
+    // but the 7-bit ones are skipped in bulk.
+    void inject_block( const char* block, size_t size );
 
     // Returns the current guess based on the previously injected bytes
     Encoding guess() const;
 
+    // Carry on as if the bytes injected so far had led to the passed
+    // guess (used when resuming from a cached index).
+    void resume( Encoding guess );
+
   private:
     enum class State {
         Start,
@@ -19,10 +19,56 @@
 
 #include "regexp_filter.h"
 
+#include <cstring>
+
 #include <QTextLayout>
 #include <QLineEdit>
 #include <QCoreApplication>
 
+#ifdef GLOGG_SUPPORTS_PCRE2
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
+// A pattern compiled by pcre2 for UTF-8 subjects, the same way
+// QRegularExpression compiles it for UTF-16 ones.
+// The compiled code is only read, so it can be matched by any
+// number of threads at once.
+class RegExpFilter::Utf8Pattern {
+  public:
+    explicit Utf8Pattern( pcre2_code* code ) : code_( code ) {}
+    ~Utf8Pattern() { pcre2_code_free( code_ ); }
+
+    Utf8Pattern( const Utf8Pattern& ) = delete;
+    Utf8Pattern& operator=( const Utf8Pattern& ) = delete;
+
+    // Returns false if the bytes are not valid UTF-8 (or pcre2
+    // gave up matching them)
+    bool match( const char* bytes, int size, bool* matched ) const
+    {
+        // (we only need to know if it matches, so one pair is enough)
+        thread_local const std::unique_ptr<pcre2_match_data,
+              decltype( &pcre2_match_data_free )> match_data(
+                      pcre2_match_data_create( 1, nullptr ), &pcre2_match_data_free );
+
+        const int result = pcre2_match( code_, reinterpret_cast<PCRE2_SPTR>( bytes ),
+                size, 0, 0, match_data.get(), nullptr );
+        if ( result == PCRE2_ERROR_NOMATCH ) {
+            *matched = false;
+            return true;
+        }
+        else if ( result >= 0 ) {
+            *matched = true;
+            return true;
+        }
+
+        return false;
+    }
+
+  private:
+    pcre2_code* code_;
+};
+#endif
+
 const QString RegExpFilter::separator_ = "|||";
 
 RegExpFilter::RegExpFilter( QString text, enum SearchRegexpType type,
@@ -32,6 +78,8 @@ RegExpFilter::RegExpFilter( QString text, enum SearchRegexpType type,
     QString excludeText = "";
     if ( type == FixedString ) {
         include_.setPattern( QRegularExpression::escape( text ) );
+        utf8Include_ = compileUtf8( include_ );
+        literal_ = LiteralFinder( extractLiteral( include_.pattern(), false ), false );
         return;
     }
     auto parts = text.split( separator_ );
@@ -50,6 +98,14 @@ RegExpFilter::RegExpFilter( QString text, enum SearchRegexpType type,
     exclude_.setPatternOptions( opt );
     include_.setPattern( includeText );
     exclude_.setPattern( excludeText );
+
+    utf8Include_ = compileUtf8( include_ );
+    if ( ! excludeText.isEmpty() )
+        utf8Exclude_ = compileUtf8( exclude_ );
+
+    if ( include_.isValid() )
+        literal_ = LiteralFinder( extractLiteral( includeText, case_insensitive ),
+                                  case_insensitive );
 }
 
 bool RegExpFilter::hasMatch( QString str ) const
@@ -58,6 +114,27 @@ bool RegExpFilter::hasMatch( QString str ) const
            && ( exclude_.pattern() == "" || !exclude_.match( str ).hasMatch() );
 }
 
+bool RegExpFilter::hasUtf8Match( const char* bytes, int size, bool* matched ) const
+{
+#ifdef GLOGG_SUPPORTS_PCRE2
+    bool include;
+    if ( ! utf8Include_->match( bytes, size, &include ) )
+        return false;
+
+    bool exclude = false;
+    if ( include && utf8Exclude_ && ! utf8Exclude_->match( bytes, size, &exclude ) )
+        return false;
+
+    *matched = include && ! exclude;
+    return true;
+#else
+    Q_UNUSED( bytes );
+    Q_UNUSED( size );
+    Q_UNUSED( matched );
+    return false;
+#endif
+}
+
 QString RegExpFilter::errorMessage() const
 {
     QString res = regExpErrorMsg( "include", include_ );
@@ -81,3 +158,203 @@ QString RegExpFilter::regExpErrorMsg( QString name,
     res += regExp.errorString();
     return res;
 }
+
+std::shared_ptr<const RegExpFilter::Utf8Pattern> RegExpFilter::compileUtf8(
+        const QRegularExpression& regExp )
+{
+#ifdef GLOGG_SUPPORTS_PCRE2
+    if ( ! regExp.isValid() )
+        return nullptr;
+
+    // QRegularExpression always works in UTF mode
+    uint32_t options = PCRE2_UTF;
+    const QRegularExpression::PatternOptions pattern_options = regExp.patternOptions();
+    if ( pattern_options & QRegularExpression::CaseInsensitiveOption )
+        options |= PCRE2_CASELESS;
+    if ( pattern_options & QRegularExpression::DotMatchesEverythingOption )
+        options |= PCRE2_DOTALL;
+    if ( pattern_options & QRegularExpression::MultilineOption )
+        options |= PCRE2_MULTILINE;
+    if ( pattern_options & QRegularExpression::ExtendedPatternSyntaxOption )
+        options |= PCRE2_EXTENDED;
+    if ( pattern_options & QRegularExpression::InvertedGreedinessOption )
+        options |= PCRE2_UNGREEDY;
+    if ( pattern_options & QRegularExpression::DontCaptureOption )
+        options |= PCRE2_NO_AUTO_CAPTURE;
+    if ( pattern_options & QRegularExpression::UseUnicodePropertiesOption )
+        options |= PCRE2_UCP;
+
+    const QByteArray pattern = regExp.pattern().toUtf8();
+    int error;
+    PCRE2_SIZE error_offset;
+    pcre2_code* code = pcre2_compile( reinterpret_cast<PCRE2_SPTR>( pattern.constData() ),
+            pattern.size(), options, &error, &error_offset, nullptr );
+    if ( ! code )
+        return nullptr;
+
+    // (the interpreter is used if the JIT is not available)
+    pcre2_jit_compile( code, PCRE2_JIT_COMPLETE );
+
+    return std::make_shared<Utf8Pattern>( code );
+#else
+    Q_UNUSED( regExp );
+    return nullptr;
+#endif
+}
+
+// The pattern is read as a sequence of items, the runs of plain
+// characters that are not made optional by a quantifier are kept.
+// Anything which is not fully understood ends the current run (the
+// groups and classes are skipped as a whole), or if it might change
+// the meaning of what follows (alternation, options, escapes taking
+// arguments...) gives up altogether.
+QByteArray RegExpFilter::extractLiteral( const QString& pattern,
+                                         bool case_insensitive )
+{
+    // (shorter ones don't discard many lines)
+    const int min_length = 2;
+
+    QByteArray longest;
+    QByteArray run;
+    const auto endRun = [&]() {
+        if ( run.size() > longest.size() )
+            longest = run;
+        run.clear();
+    };
+
+    const int size = pattern.size();
+
+    // Skip the class starting at position (after its '['), as PCRE2
+    // parses it, returns false if it cannot be skipped
+    const auto skipClass = [&pattern, size]( int* position ) {
+        int i = *position;
+        if ( i < size && pattern.at( i ) == '^' )
+            ++i;
+        // (a ']' first is part of it)
+        if ( i < size && pattern.at( i ) == ']' )
+            ++i;
+        while ( i < size ) {
+            const QChar d = pattern.at( i++ );
+            if ( d == ']' ) {
+                *position = i;
+                return true;
+            }
+            else if ( d == '\\' ) {
+                // (\Q quotes what follows, \c takes a character)
+                if ( i < size && pattern.at( i ) == 'Q' )
+                    return false;
+                if ( i < size && pattern.at( i ) == 'c' )
+                    ++i;
+                ++i;
+            }
+            else if ( d == '[' && i < size && ( pattern.at( i ) == ':'
+                        || pattern.at( i ) == '=' || pattern.at( i ) == '.' ) ) {
+                // A POSIX class ([:alpha:]...) if it is terminated before
+                // the end of the class, otherwise the '[' is a character
+                const QChar terminator = pattern.at( i );
+                for ( int j = i + 1; j + 1 < size; ++j ) {
+                    const QChar e = pattern.at( j );
+                    const QChar next = pattern.at( j + 1 );
+                    if ( e == '\\' && ( next == ']' || next == '\\' ) )
+                        ++j;
+                    else if ( e == ']' || ( e == '[' && next == terminator ) )
+                        break;
+                    else if ( e == terminator && next == ']' ) {
+                        i = j + 2;
+                        break;
+                    }
+                }
+            }
+        }
+        return false;
+    };
+
+    int i = 0;
+    while ( i < size ) {
+        const ushort c = pattern.at( i ).unicode();
+        ++i;
+        switch ( c ) {
+            case '|':
+                return {};
+            case '(': {
+                // (options and verbs might change what follows)
+                if ( i < size && ( pattern.at( i ) == '?' || pattern.at( i ) == '*' ) )
+                    return {};
+                // Skip the group
+                int depth = 1;
+                while ( i < size && depth > 0 ) {
+                    const QChar d = pattern.at( i++ );
+                    if ( d == '\\' ) {
+                        if ( i < size && pattern.at( i ) == 'Q' )
+                            return {};
+                        ++i;
+                    }
+                    else if ( d == '[' ) {
+                        if ( ! skipClass( &i ) )
+                            return {};
+                    }
+                    else if ( d == '(' )
+                        ++depth;
+                    else if ( d == ')' )
+                        --depth;
+                }
+                if ( depth > 0 )
+                    return {};
+                endRun();
+                break;
+            }
+            case '[':
+                if ( ! skipClass( &i ) )
+                    return {};
+                endRun();
+                break;
+            case '*':
+            case '?':
+            case '{':
+                // The previous character might not be there
+                // (a '{' which is not a quantifier only ends the run)
+                run.chop( 1 );
+                endRun();
+                if ( c == '{' ) {
+                    i = pattern.indexOf( '}', i );
+                    if ( i < 0 )
+                        return {};
+                    ++i;
+                }
+                break;
+            case '+':
+                endRun();
+                break;
+            case '\\': {
+                if ( i >= size )
+                    return {};
+                const ushort e = pattern.at( i ).unicode();
+                ++i;
+                if ( ( e >= '0' && e <= '9' ) || ( e >= 'a' && e <= 'z' ) || ( e >= 'A' && e <= 'Z' ) ) {
+                    // Only the classes and assertions without arguments
+                    if ( ! strchr( "dDwWsShHvVRbBAzZGXKC", e ) )
+                        return {};
+                    endRun();
+                }
+                else if ( e >= 0x20 && e < 0x7F )
+                    run.append( static_cast<char>( e ) );
+                else
+                    endRun();
+                break;
+            }
+            default:
+                // In Unicode, 'k' and 's' have other cases than 'K' and 'S'
+                if ( c < 0x20 || c >= 0x7F || ( case_insensitive
+                            && strchr( "kKsS", c ) ) )
+                    endRun();
+                else if ( c == '.' || c == '^' || c == '$' || c == ')' )
+                    endRun();
+                else
+                    run.append( static_cast<char>( c ) );
+                break;
+        }
+    }
+    endRun();
+
+    return longest.size() >= min_length ? longest : QByteArray();
+}
@@ -20,10 +20,13 @@
 #ifndef REGEXP_FILTER_H
 #define REGEXP_FILTER_H
 
+#include <memory>
+
 #include <QRegularExpression>
 #include <QString>
 
 #include "configuration.h"
+#include "data/literalfinder.h"
 
 class RegExpFilter final {
   public:
@@ -34,6 +37,20 @@ class RegExpFilter final {
     bool isValid() const { return include_.isValid() && exclude_.isValid(); }
 
     bool hasMatch( QString str ) const;
+    // Whether the lines can be matched as UTF-8 bytes (if glogg has
+    // been built with pcre2)
+    bool canMatchUtf8() const
+    { return utf8Include_ && ( exclude_.pattern().isEmpty() || utf8Exclude_ ); }
+    // Match the passed line, given as UTF-8 bytes, without decoding it
+    // (only if canMatchUtf8).
+    // Returns false if it cannot be done (invalid UTF-8), the line must
+    // then be decoded and passed to hasMatch.
+    bool hasUtf8Match( const char* bytes, int size, bool* matched ) const;
+
+    // Finder of characters every line matched must contain (empty if
+    // there are none the pattern can be seen to require), the lines
+    // without them don't need to be matched.
+    const LiteralFinder& requiredLiteral() const { return literal_; }
 
     QString errorMessage() const;
 
@@ -43,9 +60,22 @@ class RegExpFilter final {
 
     static const QString separator_;
 
+    // The patterns compiled for UTF-8 (null if not possible)
+    class Utf8Pattern;
+    static std::shared_ptr<const Utf8Pattern> compileUtf8(
+            const QRegularExpression& regExp );
+
+    // Returns the longest string of ASCII characters every match of
+    // the pattern contains (empty if none is found)
+    static QByteArray extractLiteral( const QString& pattern,
+                                      bool case_insensitive );
+
   private:
     QRegularExpression include_;
     QRegularExpression exclude_;
+    std::shared_ptr<const Utf8Pattern> utf8Include_;
+    std::shared_ptr<const Utf8Pattern> utf8Exclude_;
+    LiteralFinder literal_;
 };
 
 #endif /* REGEXP_FILTER_H */
@@ -148,14 +148,19 @@ QString Selection::getSelectedText( const AbstractLogData* logData ) const
         text = logData->getLineString( selectedLine_ );
     }
     else if ( selectedPartial_.line >= 0 ) {
-        text = logData->getExpandedLineString( selectedPartial_.line ).
-            mid( selectedPartial_.startColumn, ( selectedPartial_.endColumn -
-                        selectedPartial_.startColumn ) + 1 );
+        text = logData->getExpandedLineWindow( selectedPartial_.line,
+                selectedPartial_.startColumn, ( selectedPartial_.endColumn -
+                    selectedPartial_.startColumn ) + 1 );
     }
     else if ( selectedRange_.startLine >= 0 ) {
-        QStringList list = logData->getLines( selectedRange_.startLine,
+        // Decoded straight into the text
+        const RawLines lines = logData->getRawLines( selectedRange_.startLine,
                 selectedRange_.endLine - selectedRange_.startLine + 1 );
-        text = list.join( "\n" );
+        for ( int i = 0; i < lines.size(); ++i ) {
+            if ( i > 0 )
+                text.append( QChar( '\n' ) );
+            text.append( lines.lineString( i ) );
+        }
     }
 
     return text;
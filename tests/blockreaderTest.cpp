@@ -0,0 +1,72 @@
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "log.h"
+
+#include "data/blockreader.h"
+
+#include "gmock/gmock.h"
+
+using namespace testing;
+
+class BlockReaderBehaviour : public testing::Test {
+  public:
+    QTemporaryDir directory;
+    QString file_name;
+    QByteArray content;
+
+    BlockReaderBehaviour() {
+        file_name = directory.filePath( "file.log" );
+
+        // A bit more than a few blocks
+        for ( int i = 0; i < 3 * BlockReader::minBlockSize + 1234; ++i )
+            content.append( 'a' + i % 26 );
+
+        QFile file( file_name );
+        file.open( QIODevice::WriteOnly );
+        file.write( content );
+    }
+
+    QByteArray readAll( BlockReader* reader ) {
+        QByteArray result;
+        QByteArray block;
+        while ( ! ( block = reader->nextBlock() ).isEmpty() )
+            result.append( block );
+        return result;
+    }
+};
+
+TEST_F( BlockReaderBehaviour, ReadsTheWholeFileInOrder ) {
+    BlockReader reader( file_name, 0, BlockReader::minBlockSize );
+    ASSERT_THAT( readAll( &reader ), Eq( content ) );
+}
+
+TEST_F( BlockReaderBehaviour, StartsAtThePassedPosition ) {
+    BlockReader reader( file_name, 4567, BlockReader::minBlockSize, 2 );
+    ASSERT_THAT( readAll( &reader ), Eq( content.mid( 4567 ) ) );
+}
+
+TEST_F( BlockReaderBehaviour, CanBeStoppedBeforeTheEnd ) {
+    BlockReader reader( file_name, 0, BlockReader::minBlockSize );
+    ASSERT_THAT( reader.nextBlock().isEmpty(), Eq( false ) );
+}
+
+TEST_F( BlockReaderBehaviour, ReturnsNothingForAMissingFile ) {
+    BlockReader reader( directory.filePath( "missing.log" ), 0,
+            BlockReader::minBlockSize );
+    ASSERT_THAT( reader.nextBlock().isEmpty(), Eq( true ) );
+}
+
+TEST( BlockReaderSize, GrowsWithFastReadsAndShrinksWithSlowOnes ) {
+    const int size = 4*1024*1024;
+    ASSERT_THAT( BlockReader::nextBlockSize( size, 1 ), Eq( 2 * size ) );
+    ASSERT_THAT( BlockReader::nextBlockSize( size, 50 ), Eq( size ) );
+    ASSERT_THAT( BlockReader::nextBlockSize( size, 500 ), Eq( size / 2 ) );
+}
+
+TEST( BlockReaderSize, StaysWithinBounds ) {
+    ASSERT_THAT( BlockReader::nextBlockSize( BlockReader::maxBlockSize, 1 ),
+            Eq( BlockReader::maxBlockSize ) );
+    ASSERT_THAT( BlockReader::nextBlockSize( BlockReader::minBlockSize, 500 ),
+            Eq( BlockReader::minBlockSize ) );
+}
@@ -0,0 +1,170 @@
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "log.h"
+
+#include "data/compressedfile.h"
+
+#include "gmock/gmock.h"
+
+#ifdef GLOGG_SUPPORTS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef GLOGG_SUPPORTS_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace testing;
+
+class CompressedFileBehaviour : public testing::Test {
+  public:
+    QTemporaryDir directory;
+    QByteArray content;
+
+    CompressedFileBehaviour() {
+        // Enough for a few checkpoints
+        for ( int i = 0; content.size() < 3 * CompressedFile::checkpointInterval; ++i )
+            content.append( QString( "line %1 of the file\n" ).arg( i * 7919LL % 100003 ).toLatin1() );
+    }
+
+#ifdef GLOGG_SUPPORTS_ZLIB
+    // Write the content as one gzip member per part
+    QString writeGzip( int nb_parts ) {
+        const QString file_name = directory.filePath( "file.log.gz" );
+        const int part_size = content.size() / nb_parts + 1;
+        for ( int i = 0; i < nb_parts; ++i ) {
+            gzFile file = gzopen( file_name.toLocal8Bit().constData(), i == 0 ? "wb" : "ab" );
+            const QByteArray part = content.mid( i * part_size, part_size );
+            gzwrite( file, part.constData(), part.size() );
+            gzclose( file );
+        }
+        return file_name;
+    }
+#endif
+
+#ifdef GLOGG_SUPPORTS_ZSTD
+    // Write the content as one zstd frame per part
+    QString writeZstd( int nb_parts ) {
+        const QString file_name = directory.filePath( "file.log.zst" );
+        QFile file( file_name );
+        file.open( QIODevice::WriteOnly );
+        const int part_size = content.size() / nb_parts + 1;
+        for ( int i = 0; i < nb_parts; ++i ) {
+            const QByteArray part = content.mid( i * part_size, part_size );
+            QByteArray frame( ZSTD_compressBound( part.size() ), Qt::Uninitialized );
+            frame.resize( ZSTD_compress( frame.data(), frame.size(),
+                        part.constData(), part.size(), 1 ) );
+            file.write( frame );
+        }
+        return file_name;
+    }
+#endif
+
+    void expectIndexedContent( CompressedFile* file ) {
+        QByteArray decompressed;
+        ASSERT_TRUE( file->index( [&]( const char* data, int length, int ) {
+            decompressed.append( data, length );
+            return true; } ) );
+        ASSERT_THAT( decompressed, Eq( content ) );
+        ASSERT_THAT( file->size(), Eq( content.size() ) );
+    }
+
+    void expectReadable( const CompressedFile& file ) {
+        // Backwards, so the cache of the reads does not help
+        for ( qint64 position = content.size() - 1000; position > 0; position -= 654321 ) {
+            QByteArray data;
+            ASSERT_TRUE( file.read( position, position + 1000, &data ) );
+            ASSERT_THAT( data, Eq( content.mid( position, 1000 ) ) );
+        }
+    }
+};
+
+TEST_F( CompressedFileBehaviour, IgnoresUncompressedFiles ) {
+    const QString file_name = directory.filePath( "file.log" );
+    QFile file( file_name );
+    file.open( QIODevice::WriteOnly );
+    file.write( content );
+    file.close();
+
+    ASSERT_THAT( CompressedFile::open( file_name ), IsNull() );
+}
+
+#ifdef GLOGG_SUPPORTS_ZLIB
+TEST_F( CompressedFileBehaviour, DecompressesAGzipFile ) {
+    auto file = CompressedFile::open( writeGzip( 1 ) );
+    ASSERT_THAT( file, NotNull() );
+    ASSERT_THAT( file->format(), Eq( CompressedFile::Format::Gzip ) );
+
+    expectIndexedContent( file.get() );
+    expectReadable( *file );
+}
+
+TEST_F( CompressedFileBehaviour, ReadsAcrossGzipMembers ) {
+    auto file = CompressedFile::open( writeGzip( 5 ) );
+    ASSERT_THAT( file, NotNull() );
+
+    expectIndexedContent( file.get() );
+    expectReadable( *file );
+}
+
+TEST_F( CompressedFileBehaviour, CanBeInterrupted ) {
+    auto file = CompressedFile::open( writeGzip( 1 ) );
+    ASSERT_FALSE( file->index( []( const char*, int, int ) { return false; } ) );
+}
+#endif
+
+#ifdef GLOGG_SUPPORTS_ZSTD
+TEST_F( CompressedFileBehaviour, DecompressesAZstdFile ) {
+    // A single frame, only readable from its beginning
+    auto file = CompressedFile::open( writeZstd( 1 ) );
+    ASSERT_THAT( file, NotNull() );
+    ASSERT_THAT( file->format(), Eq( CompressedFile::Format::Zstd ) );
+
+    expectIndexedContent( file.get() );
+    expectReadable( *file );
+}
+
+TEST_F( CompressedFileBehaviour, GoesOnWithTheLastZstdDecompression ) {
+    auto file = CompressedFile::open( writeZstd( 1 ) );
+    ASSERT_THAT( file, NotNull() );
+    expectIndexedContent( file.get() );
+
+    // Forwards, past the cache of the reads
+    for ( qint64 position = 0; position < content.size() - 1000; position += 2345678 ) {
+        QByteArray data;
+        ASSERT_TRUE( file->read( position, position + 1000, &data ) );
+        ASSERT_THAT( data, Eq( content.mid( position, 1000 ) ) );
+    }
+
+    // The decompressions kept are accounted for and dropped with the cache
+    const qint64 usage = file->memoryUsage();
+    file->dropCache();
+    ASSERT_THAT( file->memoryUsage(), Lt( usage ) );
+    expectReadable( *file );
+}
+
+TEST_F( CompressedFileBehaviour, ReadsAcrossZstdFrames ) {
+    auto file = CompressedFile::open( writeZstd( 5 ) );
+    ASSERT_THAT( file, NotNull() );
+
+    expectIndexedContent( file.get() );
+    expectReadable( *file );
+}
+
+TEST_F( CompressedFileBehaviour, ReadsAZstdFileWhileIndexingIt ) {
+    auto file = CompressedFile::open( writeZstd( 1 ) );
+    ASSERT_THAT( file, NotNull() );
+
+    // What the consumer is passed can be read back at once
+    qint64 position = 0;
+    bool same = true;
+    ASSERT_TRUE( file->index( [&]( const char* data, int length, int ) {
+        QByteArray read;
+        same = same && file->read( position, position + length, &read )
+            && read == QByteArray( data, length );
+        position += length;
+        return true; } ) );
+    ASSERT_TRUE( same );
+    expectReadable( *file );
+}
+#endif
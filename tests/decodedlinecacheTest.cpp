@@ -0,0 +1,91 @@
+#include "gmock/gmock.h"
+
+#include "log.h"
+
+#include "data/decodedlinecache.h"
+
+using namespace testing;
+
+class DecodedLineCacheBehaviour : public testing::Test {
+  public:
+    // Room for four blocks (of lines with the same number of digits)
+    DecodedLineCache cache { 4 * blockMemory( 2 ) + blockMemory( 2 ) / 2 };
+
+    static QStringList block( qint64 index ) {
+        QStringList lines;
+        for ( int i = 0; i < DecodedLineCache::blockSize; ++i )
+            lines.append( QString( "line %1" ).arg( index * DecodedLineCache::blockSize + i ) );
+        return lines;
+    }
+
+    static qint64 blockMemory( qint64 index ) {
+        DecodedLineCache scratch( 1024 * 1024 );
+        scratch.put( scratch.generation(), index, block( index ) );
+        return scratch.memoryUsage();
+    }
+};
+
+TEST_F( DecodedLineCacheBehaviour, ReturnsTheCachedBlocks ) {
+    QStringList lines;
+    ASSERT_FALSE( cache.get( 3, &lines ) );
+
+    cache.put( cache.generation(), 3, block( 3 ) );
+    ASSERT_TRUE( cache.get( 3, &lines ) );
+    ASSERT_THAT( lines, Eq( block( 3 ) ) );
+    ASSERT_FALSE( cache.get( 4, &lines ) );
+
+    ASSERT_THAT( cache.hits(), Eq( 1 ) );
+    ASSERT_THAT( cache.misses(), Eq( 2 ) );
+    ASSERT_THAT( cache.memoryUsage(), Gt( 0 ) );
+}
+
+TEST_F( DecodedLineCacheBehaviour, DropsTheLeastRecentlyUsedBlock ) {
+    QStringList lines;
+    for ( qint64 i = 2; i < 6; ++i )
+        cache.put( cache.generation(), i, block( i ) );
+    ASSERT_TRUE( cache.get( 2, &lines ) );
+
+    cache.put( cache.generation(), 6, block( 6 ) );
+
+    ASSERT_TRUE( cache.get( 2, &lines ) );
+    ASSERT_FALSE( cache.get( 3, &lines ) );
+    for ( qint64 i = 4; i < 7; ++i )
+        ASSERT_TRUE( cache.get( i, &lines ) );
+}
+
+TEST_F( DecodedLineCacheBehaviour, StaysUnderItsMaximumMemory ) {
+    const qint64 max_memory = 4 * blockMemory( 2 ) + blockMemory( 2 ) / 2;
+
+    // Blocks of various sizes
+    for ( qint64 i = 2; i < 50; ++i ) {
+        QStringList lines = block( i );
+        lines[0].append( QString( ( i % 7 ) * 100, 'x' ) );
+        cache.put( cache.generation(), i, lines );
+        ASSERT_THAT( cache.memoryUsage(), Le( max_memory ) );
+    }
+
+    QStringList lines;
+    ASSERT_TRUE( cache.get( 49, &lines ) );
+}
+
+TEST_F( DecodedLineCacheBehaviour, DoesNotCacheBlocksOfVeryLongLines ) {
+    QStringList lines = block( 2 );
+    lines[10] = QString( 10000, 'x' );
+    cache.put( cache.generation(), 2, lines );
+
+    ASSERT_FALSE( cache.get( 2, &lines ) );
+    ASSERT_THAT( cache.memoryUsage(), Eq( 0 ) );
+}
+
+TEST_F( DecodedLineCacheBehaviour, IgnoresTheLinesReadBeforeAClear ) {
+    QStringList lines;
+    const uint64_t generation = cache.generation();
+    cache.put( generation, 1, block( 1 ) );
+
+    cache.clear();
+    cache.put( generation, 2, block( 2 ) );
+
+    ASSERT_FALSE( cache.get( 1, &lines ) );
+    ASSERT_FALSE( cache.get( 2, &lines ) );
+    ASSERT_THAT( cache.memoryUsage(), Eq( 0 ) );
+}
@@ -208,3 +208,83 @@ TEST_F( EncodingSpeculatorBehaviour, IgnoreNonInitialBOM ) {
 
     ASSERT_THAT( speculator.guess(), Eq( EncodingSpeculator::Encoding::ASCII8 ) );
 }
+
+TEST_F( EncodingSpeculatorBehaviour, ResumeFromUTF8 ) {
+    speculator.resume( EncodingSpeculator::Encoding::UTF8 );
+    speculator.inject_byte( 0x10 );
+
+    ASSERT_THAT( speculator.guess(), Eq( EncodingSpeculator::Encoding::UTF8 ) );
+
+    speculator.inject_byte( 0xFF );
+
+    ASSERT_THAT( speculator.guess(), Eq( EncodingSpeculator::Encoding::ASCII8 ) );
+}
+
+TEST_F( EncodingSpeculatorBehaviour, ResumeFromAsciiIgnoresBOM ) {
+    speculator.resume( EncodingSpeculator::Encoding::ASCII7 );
+    speculator.inject_byte( 0xFE );
+    speculator.inject_byte( 0xFF );
+
+    ASSERT_THAT( speculator.guess(), Eq( EncodingSpeculator::Encoding::ASCII8 ) );
+}
+
+class EncodingSpeculatorBlock: public testing::Test {
+  public:
+    // Inject the bytes one by one in one speculator and as blocks
+    // of block_size in another, both must guess the same.
+    void expectSameGuess( const vector<uint8_t>& bytes, size_t block_size ) {
+        EncodingSpeculator by_byte;
+        EncodingSpeculator by_block;
+
+        for ( size_t i = 0; i < bytes.size(); i += block_size ) {
+            const size_t size = min( block_size, bytes.size() - i );
+            for ( size_t j = i; j < i + size; ++j )
+                by_byte.inject_byte( bytes[j] );
+            by_block.inject_block( reinterpret_cast<const char*>( &bytes[i] ), size );
+
+            ASSERT_THAT( by_block.guess(), Eq( by_byte.guess() ) );
+        }
+    }
+
+    vector<uint8_t> asciiWith( const vector<uint8_t>& inserted, size_t position ) {
+        vector<uint8_t> bytes( 100, 'a' );
+        bytes.insert( bytes.begin() + position, inserted.begin(), inserted.end() );
+        return bytes;
+    }
+};
+
+TEST_F( EncodingSpeculatorBlock, SameGuessForAscii ) {
+    expectSameGuess( vector<uint8_t>( 1000, 'x' ), 1000 );
+    expectSameGuess( vector<uint8_t>( 1000, 'x' ), 7 );
+}
+
+TEST_F( EncodingSpeculatorBlock, SameGuessForUTF8 ) {
+    for ( size_t position : { 0, 1, 15, 16, 17, 31, 99 } ) {
+        for ( size_t block_size : { 1, 3, 16, 1000 } ) {
+            expectSameGuess( asciiWith( utf8encodeMultiBytes( 0x2020 ), position ), block_size );
+            expectSameGuess( asciiWith( utf8encodeMultiBytes( 0x10000 ), position ), block_size );
+            // Truncated sequence
+            expectSameGuess( asciiWith( { 0xE2, 0x80 }, position ), block_size );
+        }
+    }
+}
+
+TEST_F( EncodingSpeculatorBlock, SameGuessForBOMs ) {
+    for ( size_t block_size : { 1, 2, 16 } ) {
+        expectSameGuess( asciiWith( { 0xFE, 0xFF }, 0 ), block_size );
+        expectSameGuess( asciiWith( { 0xFF, 0xFE }, 0 ), block_size );
+        expectSameGuess( asciiWith( { 0xFF, 0xFE }, 20 ), block_size );
+    }
+}
+
+TEST_F( EncodingSpeculatorBlock, SameGuessForRandomBytes ) {
+    srand( 42 );
+    for ( int i = 0; i < 200; ++i ) {
+        vector<uint8_t> bytes( 64 + rand() % 256 );
+        for ( auto& byte : bytes ) {
+            // Mostly ASCII, like a log
+            byte = ( rand() % 8 == 0 ) ? 0x80 + rand() % 0x80 : rand() % 0x80;
+        }
+        expectSameGuess( bytes, 1 + rand() % 40 );
+    }
+}
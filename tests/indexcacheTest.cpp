@@ -0,0 +1,193 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include "log.h"
+
+#include "data/indexcache.h"
+#include "data/logdataworkerthread.h"
+
+#include "gmock/gmock.h"
+
+using namespace testing;
+
+static const int LINE_LENGTH = 40; // Without the final '\n'
+
+class IndexCacheBehaviour : public testing::Test {
+  public:
+    QTemporaryDir directory;
+    QString file_name;
+
+    IndexCacheBehaviour() {
+        file_name = directory.filePath( "file.log" );
+    }
+
+    // Append nb_lines lines to the file and index them in indexing_data
+    void appendLines( int nb_lines, IndexingData* indexing_data ) {
+        appendLines( file_name, nb_lines, indexing_data );
+    }
+
+    void appendLines( const QString& file_name, int nb_lines, IndexingData* indexing_data ) {
+        QFile file( file_name );
+        file.open( QIODevice::Append );
+
+        FastLinePositionArray positions;
+        const qint64 beginning = file.size();
+        for ( int i = 0; i < nb_lines; ++i ) {
+            file.write( QByteArray( LINE_LENGTH, 'a' + i % 26 ) + '\n' );
+            positions.append( beginning + ( i + 1 ) * ( LINE_LENGTH + 1 ) );
+        }
+
+        indexing_data->addAll( nb_lines * ( LINE_LENGTH + 1 ), LINE_LENGTH,
+                positions, EncodingSpeculator::Encoding::UTF8 );
+    }
+
+    void expectSameIndex( const IndexingData& index, const IndexingData& expected ) {
+        ASSERT_THAT( index.getNbLines(), Eq( expected.getNbLines() ) );
+        ASSERT_THAT( index.getSize(), Eq( expected.getSize() ) );
+        ASSERT_THAT( index.getMaxLength(), Eq( expected.getMaxLength() ) );
+        ASSERT_THAT( index.getEncodingGuess(), Eq( expected.getEncodingGuess() ) );
+        for ( LineNumber i = 0; i < expected.getNbLines(); ++i )
+            ASSERT_THAT( index.getPosForLine( i ), Eq( expected.getPosForLine( i ) ) );
+    }
+};
+
+TEST_F( IndexCacheBehaviour, NothingToLoadAtFirst ) {
+    IndexingData indexing_data;
+    appendLines( 10, &indexing_data );
+
+    IndexingData loaded;
+    IndexCache cache( file_name, directory.path() );
+    ASSERT_FALSE( cache.load( &loaded ) );
+}
+
+TEST_F( IndexCacheBehaviour, LoadsWhatWasSaved ) {
+    IndexingData indexing_data;
+    appendLines( 3000, &indexing_data );
+
+    IndexCache( file_name, directory.path() ).save( indexing_data );
+
+    IndexingData loaded;
+    IndexCache cache( file_name, directory.path() );
+    ASSERT_TRUE( cache.load( &loaded ) );
+    expectSameIndex( loaded, indexing_data );
+}
+
+TEST_F( IndexCacheBehaviour, AppendsWhenSavedAgain ) {
+    IndexingData indexing_data;
+    IndexCache cache( file_name, directory.path() );
+
+    appendLines( 1000, &indexing_data );
+    cache.save( indexing_data );
+    appendLines( 500, &indexing_data );
+    cache.save( indexing_data );
+
+    IndexingData loaded;
+    ASSERT_TRUE( IndexCache( file_name, directory.path() ).load( &loaded ) );
+    expectSameIndex( loaded, indexing_data );
+}
+
+TEST_F( IndexCacheBehaviour, StillValidWhenFileIsAppended ) {
+    IndexingData indexing_data;
+    appendLines( 1000, &indexing_data );
+    IndexCache( file_name, directory.path() ).save( indexing_data );
+
+    IndexingData longer;
+    appendLines( 10, &longer );
+
+    IndexingData loaded;
+    ASSERT_TRUE( IndexCache( file_name, directory.path() ).load( &loaded ) );
+    expectSameIndex( loaded, indexing_data );
+}
+
+TEST_F( IndexCacheBehaviour, StaleWhenFileIsModified ) {
+    IndexingData indexing_data;
+    appendLines( 1000, &indexing_data );
+    IndexCache( file_name, directory.path() ).save( indexing_data );
+
+    QFile file( file_name );
+    file.open( QIODevice::ReadWrite );
+    file.seek( file.size() - 10 );
+    file.write( "modified" );
+    file.close();
+
+    IndexingData loaded;
+    ASSERT_FALSE( IndexCache( file_name, directory.path() ).load( &loaded ) );
+    ASSERT_THAT( loaded.getNbLines(), Eq( 0u ) );
+}
+
+TEST_F( IndexCacheBehaviour, OnlySavesCompleteLines ) {
+    IndexingData indexing_data;
+    appendLines( 100, &indexing_data );
+
+    // Unterminated final line, as indexed by IndexOperation
+    QFile file( file_name );
+    file.open( QIODevice::Append );
+    file.write( "unterminated" );
+    file.close();
+
+    FastLinePositionArray fake_lf;
+    fake_lf.append( file.size() + 1 );
+    fake_lf.setFakeFinalLF();
+    indexing_data.addAll( 12, 0, fake_lf, EncodingSpeculator::Encoding::UTF8 );
+
+    IndexCache( file_name, directory.path() ).save( indexing_data );
+
+    IndexingData loaded;
+    ASSERT_TRUE( IndexCache( file_name, directory.path() ).load( &loaded ) );
+    ASSERT_THAT( loaded.getNbLines(), Eq( 100u ) );
+    ASSERT_THAT( loaded.getSize(), Eq( 100 * ( LINE_LENGTH + 1LL ) ) );
+}
+
+TEST_F( IndexCacheBehaviour, RewritesAnEntryReplacedByAnotherInstance ) {
+    IndexingData indexing_data;
+    IndexCache cache( file_name, directory.path() );
+    IndexCache other_cache( file_name, directory.path() );
+
+    appendLines( 1000, &indexing_data );
+    cache.save( indexing_data );
+    appendLines( 500, &indexing_data );
+    other_cache.save( indexing_data );
+    appendLines( 500, &indexing_data );
+    cache.save( indexing_data );
+
+    IndexingData loaded;
+    ASSERT_TRUE( IndexCache( file_name, directory.path() ).load( &loaded ) );
+    expectSameIndex( loaded, indexing_data );
+}
+
+TEST_F( IndexCacheBehaviour, TrimsTheEntriesOfDeletedFiles ) {
+    const QString other_file_name = directory.filePath( "other.log" );
+    IndexingData indexing_data, other_indexing_data;
+    appendLines( 1000, &indexing_data );
+    appendLines( other_file_name, 1000, &other_indexing_data );
+    IndexCache cache( file_name, directory.path() );
+    IndexCache other_cache( other_file_name, directory.path() );
+    cache.save( indexing_data );
+    other_cache.save( other_indexing_data );
+
+    QFile::remove( other_file_name );
+    IndexCache::trim( directory.path(), IndexCache::maxDirectorySize );
+
+    ASSERT_TRUE( QFile::exists( cache.cacheFileName() ) );
+    ASSERT_FALSE( QFile::exists( other_cache.cacheFileName() ) );
+}
+
+TEST_F( IndexCacheBehaviour, TrimsTheLeastRecentlyUsedEntries ) {
+    const QString other_file_name = directory.filePath( "other.log" );
+    IndexingData indexing_data, other_indexing_data;
+    appendLines( 1000, &indexing_data );
+    appendLines( other_file_name, 1000, &other_indexing_data );
+    IndexCache cache( file_name, directory.path() );
+    IndexCache other_cache( other_file_name, directory.path() );
+    other_cache.save( other_indexing_data );
+    QThread::msleep( 20 );
+    cache.save( indexing_data );
+
+    // Room for one of them only
+    IndexCache::trim( directory.path(), QFileInfo( cache.cacheFileName() ).size() );
+
+    ASSERT_TRUE( QFile::exists( cache.cacheFileName() ) );
+    ASSERT_FALSE( QFile::exists( other_cache.cacheFileName() ) );
+}
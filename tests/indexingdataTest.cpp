@@ -0,0 +1,217 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "log.h"
+
+#include "data/logdataworkerthread.h"
+
+#include "gmock/gmock.h"
+
+using namespace testing;
+
+static const int LINE_LENGTH = 40; // Without the final '\n'
+
+class IndexingDataBehaviour : public testing::Test {
+  public:
+    IndexingData indexing_data;
+
+    // Index nb_lines more lines of LINE_LENGTH characters
+    void appendLines( int nb_lines ) {
+        const qint64 beginning = indexing_data.getSize();
+        FastLinePositionArray positions;
+        for ( int i = 0; i < nb_lines; ++i )
+            positions.append( beginning + ( i + 1 ) * ( LINE_LENGTH + 1 ) );
+
+        indexing_data.addAll( nb_lines * ( LINE_LENGTH + 1 ), LINE_LENGTH,
+                positions, EncodingSpeculator::Encoding::ASCII7 );
+    }
+
+    void appendFakeFinalLF() {
+        FastLinePositionArray position;
+        position.append( indexing_data.getSize() + 10 );
+        position.setFakeFinalLF();
+        indexing_data.addAll( 0, 0, position, EncodingSpeculator::Encoding::ASCII7 );
+    }
+
+    static qint64 expectedPos( LineNumber line ) {
+        return ( line + 1 ) * ( LINE_LENGTH + 1 );
+    }
+};
+
+TEST_F( IndexingDataBehaviour, KeepsManyLines ) {
+    // Several times the lines kept together
+    for ( int i = 0; i < 20; ++i )
+        appendLines( 7000 );
+
+    ASSERT_THAT( indexing_data.getNbLines(), Eq( 140000u ) );
+    IndexingData::Cursor cursor( indexing_data );
+    for ( LineNumber i = 0; i < 140000; ++i ) {
+        ASSERT_THAT( cursor.getPosForLine( i ), Eq( expectedPos( i ) ) );
+        ASSERT_THAT( indexing_data.getPosForLine( i ), Eq( expectedPos( i ) ) );
+    }
+}
+
+TEST_F( IndexingDataBehaviour, CodesTheSegmentsWithEliasFano ) {
+    // Long lines, which Elias-Fano codes in less memory
+    FastLinePositionArray positions;
+    uint64_t position = 0;
+    for ( int i = 0; i < 100000; ++i ) {
+        position += 200 + ( i * 7919 ) % 300;
+        positions.append( position );
+    }
+
+    IndexingData compressed;
+    compressed.addAll( position, 500, positions, EncodingSpeculator::Encoding::ASCII7 );
+    indexing_data.setEliasFano( true );
+    indexing_data.addAll( position, 500, positions, EncodingSpeculator::Encoding::ASCII7 );
+
+    ASSERT_THAT( indexing_data.memoryUsage(), Lt( compressed.memoryUsage() ) );
+    IndexingData::Cursor cursor( indexing_data );
+    for ( LineNumber i = 0; i < 100000; ++i ) {
+        ASSERT_THAT( cursor.getPosForLine( i ), Eq( positions.at( i ) ) );
+        ASSERT_THAT( indexing_data.getPosForLine( i ), Eq( positions.at( i ) ) );
+    }
+}
+
+TEST_F( IndexingDataBehaviour, ReplacesAFakeFinalLF ) {
+    for ( int i = 0; i < 8; ++i ) {
+        appendLines( 4095 );
+        appendFakeFinalLF();
+        ASSERT_THAT( indexing_data.getNbLines(), Eq( ( i + 1 ) * 4095u + 1 ) );
+        ASSERT_THAT( indexing_data.getPosForLine( ( i + 1 ) * 4095 ),
+                Eq( indexing_data.getSize() + 10 ) );
+    }
+    appendLines( 1 );
+
+    ASSERT_THAT( indexing_data.getNbLines(), Eq( 8 * 4095u + 1 ) );
+    IndexingData::Cursor cursor( indexing_data );
+    for ( LineNumber i = 0; i < 8 * 4095 + 1; ++i )
+        ASSERT_THAT( cursor.getPosForLine( i ), Eq( expectedPos( i ) ) );
+}
+
+TEST_F( IndexingDataBehaviour, CursorKeepsItsSnapshot ) {
+    appendLines( 50000 );
+
+    IndexingData::Cursor cursor( indexing_data );
+    indexing_data.clear();
+    appendLines( 10 );
+
+    ASSERT_THAT( indexing_data.getNbLines(), Eq( 10u ) );
+    ASSERT_THAT( cursor.getNbLines(), Eq( 50000u ) );
+    ASSERT_THAT( cursor.getPosForLine( 49999 ), Eq( expectedPos( 49999 ) ) );
+}
+
+TEST_F( IndexingDataBehaviour, SparseCursorKeepsItsSnapshot ) {
+    // The lines the positions are read again from
+    QTemporaryDir directory;
+    const QString file_name = directory.filePath( "file.log" );
+    QFile file( file_name );
+    file.open( QIODevice::WriteOnly );
+    for ( int i = 0; i < 100; ++i )
+        file.write( QByteArray( LINE_LENGTH, 'a' ) + '\n' );
+    file.close();
+
+    indexing_data.setSparse( file_name, 8, 4 );
+    appendLines( 20 );
+    appendFakeFinalLF();
+    const qint64 fake_position = indexing_data.getSize() + 10;
+
+    // The fake LF is replaced and the block it was in completed
+    IndexingData::Cursor cursor( indexing_data );
+    appendLines( 30 );
+
+    ASSERT_THAT( cursor.getNbLines(), Eq( 21u ) );
+    ASSERT_THAT( cursor.getPosForLine( 20 ), Eq( fake_position ) );
+    for ( LineNumber i = 0; i < 20; ++i )
+        ASSERT_THAT( cursor.getPosForLine( i ), Eq( expectedPos( i ) ) );
+
+    ASSERT_THAT( indexing_data.getNbLines(), Eq( 50u ) );
+    for ( LineNumber i = 0; i < 50; ++i )
+        ASSERT_THAT( indexing_data.getPosForLine( i ), Eq( expectedPos( i ) ) );
+}
+
+TEST_F( IndexingDataBehaviour, SplicesAPrefix ) {
+    IndexingData prefix;
+    FastLinePositionArray positions;
+    for ( LineNumber i = 0; i < 30000; ++i )
+        positions.append( expectedPos( i ) );
+    prefix.addAll( expectedPos( 29999 ), LINE_LENGTH, positions,
+            EncodingSpeculator::Encoding::ASCII7 );
+
+    indexing_data.startAt( expectedPos( 29999 ) );
+    appendLines( 20000 );
+    indexing_data.splicePrefix( &prefix );
+
+    ASSERT_THAT( indexing_data.getStartPosition(), Eq( 0 ) );
+    ASSERT_THAT( indexing_data.getNbLines(), Eq( 50000u ) );
+    IndexingData::Cursor cursor( indexing_data );
+    for ( LineNumber i = 0; i < 50000; ++i )
+        ASSERT_THAT( cursor.getPosForLine( i ), Eq( expectedPos( i ) ) );
+}
+
+TEST_F( IndexingDataBehaviour, SharesTheSegmentsOfAPrefix ) {
+    IndexingData prefix;
+    FastLinePositionArray positions;
+    for ( LineNumber i = 0; i < 30000; ++i )
+        positions.append( expectedPos( i ) );
+    prefix.addAll( expectedPos( 29999 ), LINE_LENGTH, positions,
+            EncodingSpeculator::Encoding::ASCII7 );
+
+    indexing_data.startAt( expectedPos( 29999 ) );
+    appendLines( 20000 );
+    indexing_data.splicePrefix( &prefix );
+
+    // Both add segments after the ones they share
+    FastLinePositionArray other_positions;
+    for ( LineNumber i = 0; i < 40000; ++i )
+        other_positions.append( expectedPos( 29999 ) + ( i + 1 ) * 7 );
+    prefix.addAll( 40000 * 7, 6, other_positions,
+            EncodingSpeculator::Encoding::ASCII7 );
+    appendLines( 40000 );
+
+    ASSERT_THAT( prefix.getNbLines(), Eq( 70000u ) );
+    IndexingData::Cursor prefix_cursor( prefix );
+    for ( LineNumber i = 0; i < 30000; ++i )
+        ASSERT_THAT( prefix_cursor.getPosForLine( i ), Eq( expectedPos( i ) ) );
+    for ( LineNumber i = 0; i < 40000; ++i )
+        ASSERT_THAT( prefix_cursor.getPosForLine( 30000 + i ),
+                Eq( expectedPos( 29999 ) + ( i + 1 ) * 7 ) );
+
+    ASSERT_THAT( indexing_data.getNbLines(), Eq( 90000u ) );
+    IndexingData::Cursor cursor( indexing_data );
+    for ( LineNumber i = 0; i < 90000; ++i )
+        ASSERT_THAT( cursor.getPosForLine( i ), Eq( expectedPos( i ) ) );
+}
+
+TEST_F( IndexingDataBehaviour, ReadersSeeConsistentLinesWhileIndexing ) {
+    std::atomic<bool> finished( false );
+    std::atomic<int> errors( 0 );
+
+    std::vector<std::thread> readers;
+    for ( int i = 0; i < 4; ++i ) {
+        readers.emplace_back( [&]() {
+            while ( ! finished ) {
+                IndexingData::Cursor cursor( indexing_data );
+                const LineNumber nb_lines = cursor.getNbLines();
+                for ( LineNumber line = nb_lines - qMin( nb_lines, 1000u );
+                        line < nb_lines; ++line ) {
+                    if ( cursor.getPosForLine( line ) != expectedPos( line ) )
+                        ++errors;
+                }
+            }
+        } );
+    }
+
+    for ( int i = 0; i < 500; ++i )
+        appendLines( 1000 );
+    finished = true;
+    for ( auto& reader : readers )
+        reader.join();
+
+    ASSERT_THAT( errors.load(), Eq( 0 ) );
+    ASSERT_THAT( indexing_data.getNbLines(), Eq( 500000u ) );
+}
@@ -0,0 +1,93 @@
+#include "gmock/gmock.h"
+
+#include <limits>
+
+#include <QTextCodec>
+
+#include "data/linedecoder.h"
+
+using namespace testing;
+
+class LineDecoderBehaviour : public testing::Test {
+  public:
+    // Decode the bytes with the codec and untabify them, the old way
+    static QString slowExpanded( QTextCodec* codec, const QByteArray& bytes ) {
+        return LineDecoder::expandTabs( codec->toUnicode( bytes ) );
+    }
+
+    static QByteArray someLines() {
+        QByteArray lines;
+        lines.append( "plain ascii line, long enough for the vector loop" );
+        lines.append( "\ttab\tstops\t\tand a NUL" );
+        lines.append( '\0' );
+        lines.append( " after it" );
+        lines.append( "caf\xC3\xA9\tcr\xC3\xA8me \xE2\x82\xAC\t\xF0\x9F\x98\x80 done" );
+        return lines;
+    }
+};
+
+TEST_F( LineDecoderBehaviour, ExpandsTabsToTheNextStop ) {
+    const LineDecoder decoder( nullptr );
+
+    ASSERT_THAT( decoder.decodeExpanded( "\tx", 2 ), Eq( QString( "        x" ) ) );
+    ASSERT_THAT( decoder.decodeExpanded( "abc\tx", 5 ), Eq( QString( "abc     x" ) ) );
+    ASSERT_THAT( decoder.decodeExpanded( "abcdefgh\tx", 10 ),
+            Eq( QString( "abcdefgh        x" ) ) );
+    ASSERT_THAT( decoder.decodeExpanded( "a\0b", 3 ), Eq( QString( "a b" ) ) );
+    ASSERT_THAT( decoder.decode( "a\tb", 3 ), Eq( QString( "a\tb" ) ) );
+}
+
+TEST_F( LineDecoderBehaviour, DecodesLikeTheCodec ) {
+    const QByteArray lines = someLines();
+
+    for ( const char* name : { "ISO-8859-1", "UTF-8", "windows-1252" } ) {
+        QTextCodec* codec = QTextCodec::codecForName( name );
+        const LineDecoder decoder( codec );
+
+        for ( int size = 0; size <= lines.size(); ++size ) {
+            const QByteArray bytes = lines.left( size );
+            ASSERT_THAT( decoder.decode( bytes.constData(), size ),
+                    Eq( codec->toUnicode( bytes ) ) );
+            ASSERT_THAT( decoder.decodeExpanded( bytes.constData(), size ),
+                    Eq( slowExpanded( codec, bytes ) ) );
+        }
+    }
+}
+
+TEST_F( LineDecoderBehaviour, LeavesInvalidUtf8ToTheCodec ) {
+    QTextCodec* codec = QTextCodec::codecForName( "UTF-8" );
+    const LineDecoder decoder( codec );
+
+    for ( const QByteArray bytes : { QByteArray( "\xEF\xBB\xBF" "bom\tline" ),
+            QByteArray( "truncated \xE2\x82" ), QByteArray( "overlong \xC0\xAF\t" ),
+            QByteArray( "surrogate \xED\xA0\x80" ), QByteArray( "stray \x80\tbyte" ) } ) {
+        ASSERT_THAT( decoder.decode( bytes.constData(), bytes.size() ),
+                Eq( codec->toUnicode( bytes ) ) );
+        ASSERT_THAT( decoder.decodeExpanded( bytes.constData(), bytes.size() ),
+                Eq( slowExpanded( codec, bytes ) ) );
+    }
+}
+
+TEST_F( LineDecoderBehaviour, DecodesUtf16LikeTheCodec ) {
+    const QString text = QString::fromUtf8( someLines() );
+
+    for ( const char* name : { "UTF-16LE", "UTF-16BE" } ) {
+        QTextCodec* codec = QTextCodec::codecForName( name );
+        const LineDecoder decoder( codec );
+        const QByteArray lines = codec->fromUnicode( text );
+
+        // (including the odd sizes and cut surrogate pairs)
+        for ( int size = 0; size <= lines.size(); ++size ) {
+            const QByteArray bytes = lines.left( size );
+            ASSERT_THAT( decoder.decode( bytes.constData(), size ),
+                    Eq( codec->toUnicode( bytes ) ) );
+            ASSERT_THAT( decoder.decodeExpanded( bytes.constData(), size ),
+                    Eq( slowExpanded( codec, bytes ) ) );
+        }
+
+        int column = 0;
+        ASSERT_THAT( decoder.skipColumns( lines.constData(), lines.size(),
+                    &column, std::numeric_limits<int>::max() ), lines.size() );
+        ASSERT_THAT( column, slowExpanded( codec, lines ).size() );
+    }
+}
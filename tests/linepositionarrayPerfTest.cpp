@@ -0,0 +1,116 @@
+#include <iostream>
+#include <random>
+
+#include <QSignalSpy>
+
+#include "log.h"
+#include "test_utils.h"
+
+#include "data/linepositionarray.h"
+
+#include "gmock/gmock.h"
+
+using namespace std;
+using namespace testing;
+
+// Compare the storages of the line positions, to choose which one
+// to use for a given file.
+
+static const int PLA_NB_LINES = 20000000;
+
+template <typename Array>
+class PerfLinePositionArray : public testing::Test {
+  public:
+    Array line_array;
+    uint64_t last_position;
+
+    PerfLinePositionArray() {
+        // Lines of 20 to 200 bytes, and a few very long ones
+        uint64_t pos = 0;
+        for ( int i = 0; i < PLA_NB_LINES; i++ ) {
+            pos += ( i % 10000 == 0 ) ? 100000 : 20 + ( i * 7919 ) % 181;
+            line_array.append( pos );
+        }
+        last_position = pos;
+
+        cout << endl << "Storage uses " << line_array.memoryUsage()
+            << " bytes for " << PLA_NB_LINES << " lines" << endl;
+    }
+};
+
+typedef Types<LinePositionArray, EliasFanoLinePositionArray> Storages;
+TYPED_TEST_CASE( PerfLinePositionArray, Storages );
+
+TYPED_TEST( PerfLinePositionArray, sequentialRead ) {
+    uint64_t sum = 0;
+    {
+        TestTimer t;
+
+        for ( int i = 0; i < PLA_NB_LINES; i++ )
+            sum += this->line_array.at( i );
+    }
+    ASSERT_THAT( sum, Gt( 0ULL ) );
+}
+
+TYPED_TEST( PerfLinePositionArray, sequentialReadWithCursor ) {
+    typename TypeParam::Cursor cursor( this->line_array );
+    uint64_t sum = 0;
+    {
+        TestTimer t;
+
+        for ( int i = 0; i < PLA_NB_LINES; i++ )
+            sum += cursor.at( i );
+    }
+    ASSERT_THAT( sum, Gt( 0ULL ) );
+}
+
+TYPED_TEST( PerfLinePositionArray, randomRead ) {
+    mt19937 generator( 42 );
+    uniform_int_distribution<int> distribution( 0, PLA_NB_LINES - 1 );
+
+    uint64_t sum = 0;
+    {
+        TestTimer t;
+
+        for ( int i = 0; i < PLA_NB_LINES; i++ )
+            sum += this->line_array.at( distribution( generator ) );
+    }
+    ASSERT_THAT( sum, Gt( 0ULL ) );
+}
+
+TYPED_TEST( PerfLinePositionArray, randomPageRead ) {
+    mt19937 generator( 42 );
+    uniform_int_distribution<int> distribution( 0, PLA_NB_LINES - 100 );
+
+    uint64_t sum = 0;
+    {
+        TestTimer t;
+
+        // 70 lines pages, as displayed
+        for ( int i = 0; i < PLA_NB_LINES / 70; i++ ) {
+            const int first_line = distribution( generator );
+            for ( int line = first_line; line < first_line + 70; line++ )
+                sum += this->line_array.at( line );
+        }
+    }
+    ASSERT_THAT( this->line_array.at( PLA_NB_LINES - 1 ), Eq( this->last_position ) );
+}
+
+TYPED_TEST( PerfLinePositionArray, randomPageReadWithCursor ) {
+    mt19937 generator( 42 );
+    uniform_int_distribution<int> distribution( 0, PLA_NB_LINES - 100 );
+
+    uint64_t sum = 0;
+    {
+        TestTimer t;
+
+        // One cursor per page, as LogData does
+        for ( int i = 0; i < PLA_NB_LINES / 70; i++ ) {
+            typename TypeParam::Cursor cursor( this->line_array );
+            const int first_line = distribution( generator );
+            for ( int line = first_line; line < first_line + 70; line++ )
+                sum += cursor.at( line );
+        }
+    }
+    ASSERT_THAT( sum, Gt( 0ULL ) );
+}
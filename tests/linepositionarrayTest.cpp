@@ -1,3 +1,5 @@
+#include <thread>
+
 #include "gmock/gmock.h"
 
 #include "log.h"
@@ -110,6 +112,21 @@ TEST_F( LinePositionArrayLong, FakeLFisNotKeptWhenAddingAfterIt ) {
 }
 
 
+TEST_F( LinePositionArrayLong, MemoryUsageIsNotChangedByAFakeLF ) {
+    LinePositionArray other_array;
+    for ( int i = 0; i < 256; i++ )
+        other_array.append( i * 4 );
+    other_array.append( 255 * 4 + 10 );
+
+    line_array.setFakeFinalLF();
+    line_array.append( 255 * 4 + 8 );
+    line_array.append( 255 * 4 + 10 );
+
+    ASSERT_THAT( line_array.memoryUsage(), Eq( other_array.memoryUsage() ) );
+    // (all the lines of the finished block are stored on one byte)
+    ASSERT_THAT( line_array.memoryUsage(), Lt( 257 * sizeof( uint64_t ) ) );
+}
+
 class LinePositionArrayBig: public testing::Test {
   public:
     LinePositionArray line_array;
@@ -180,3 +197,132 @@ TEST_F( LinePositionArrayBigConcat, SimpleBigConcat ) {
     ASSERT_THAT( line_array[2], Eq( UINT32_MAX + 10 ) );
     ASSERT_THAT( line_array[3], Eq( UINT32_MAX + 30 ) );
 }
+
+class EliasFanoLinePositionArrayBehaviour: public testing::Test {
+  public:
+    EliasFanoLinePositionArray line_array;
+    // The same positions, as they are
+    vector<uint64_t> positions;
+
+    EliasFanoLinePositionArrayBehaviour() {
+        // Lines from 1 byte to 64 KiB, with some crossing 4 GiB
+        uint64_t pos = UINT32_MAX - 300000;
+        for ( int i = 0; i < 1000; i++ ) {
+            pos += 1 + ( i * 7919 ) % ( i % 50 == 0 ? 65536 : 200 );
+            positions.push_back( pos );
+        }
+        for ( uint64_t position : positions )
+            line_array.append( position );
+    }
+};
+
+TEST_F( EliasFanoLinePositionArrayBehaviour, RememberAddedLines ) {
+    ASSERT_THAT( line_array.size(), Eq( 1000 ) );
+    for ( int i = 0; i < 1000; i++ )
+        ASSERT_THAT( line_array[i], Eq( positions[i] ) );
+    // In any order
+    for ( int i = 999; i >= 0; i -= 37 )
+        ASSERT_THAT( line_array[i], Eq( positions[i] ) );
+}
+
+TEST_F( EliasFanoLinePositionArrayBehaviour, FakeLFisNotKeptWhenAddingAfterIt ) {
+    EliasFanoLinePositionArray short_array;
+    for ( int i = 0; i < 767; i++ )
+        short_array.append( positions[i] );
+
+    // The fake LF completes a block
+    short_array.append( positions[767] );
+    short_array.setFakeFinalLF();
+    short_array.append( positions[767] + 20 );
+    ASSERT_THAT( short_array.size(), Eq( 768 ) );
+    ASSERT_THAT( short_array[767], Eq( positions[767] + 20 ) );
+
+    for ( int i = 0; i < 767; i++ )
+        ASSERT_THAT( short_array[i], Eq( positions[i] ) );
+}
+
+TEST_F( EliasFanoLinePositionArrayBehaviour, CanBeMoved ) {
+    EliasFanoLinePositionArray other_array;
+    other_array = std::move( line_array );
+
+    ASSERT_THAT( other_array.size(), Eq( 1000 ) );
+    ASSERT_THAT( other_array[500], Eq( positions[500] ) );
+    ASSERT_THAT( line_array.size(), Eq( 0 ) );
+}
+
+TEST_F( EliasFanoLinePositionArrayBehaviour, IsNotBiggerThanTheCompressedArray ) {
+    EliasFanoLinePositionArray elias_fano_array;
+    LinePositionArray compressed_array;
+    // Lines of 20 to 200 bytes
+    uint64_t pos = 0;
+    for ( int i = 0; i < 100000; i++ ) {
+        pos += 20 + ( i * 7919 ) % 181;
+        elias_fano_array.append( pos );
+        compressed_array.append( pos );
+    }
+
+    ASSERT_THAT( elias_fano_array.memoryUsage(),
+            Le( compressed_array.memoryUsage() ) );
+}
+
+class LinePositionArrayCursor: public testing::Test {
+  public:
+    LinePositionArray line_array;
+    vector<uint64_t> positions;
+
+    LinePositionArrayCursor() {
+        // Crossing 4 GiB in the middle of a block
+        uint64_t pos = UINT32_MAX - 100000;
+        for ( int i = 0; i < 2000; i++ ) {
+            pos += 1 + ( i * 7919 ) % ( i % 100 == 0 ? 30000 : 200 );
+            positions.push_back( pos );
+            line_array.append( pos );
+        }
+    }
+};
+
+TEST_F( LinePositionArrayCursor, ReadsTheSameAsAt ) {
+    LinePositionArray::Cursor cursor( line_array );
+    for ( int i = 0; i < 2000; i++ )
+        ASSERT_THAT( cursor.at( i ), Eq( positions[i] ) );
+    for ( int i = 1999; i >= 0; i -= 13 )
+        ASSERT_THAT( cursor.at( i ), Eq( positions[i] ) );
+}
+
+TEST_F( LinePositionArrayCursor, ReadsTheLinesAddedAfterIt ) {
+    LinePositionArray::Cursor cursor( line_array );
+    ASSERT_THAT( cursor.at( 1999 ), Eq( positions[1999] ) );
+
+    line_array.append( positions[1999] + 10 );
+    ASSERT_THAT( cursor.at( 2000 ), Eq( positions[1999] + 10 ) );
+}
+
+TEST_F( LinePositionArrayCursor, SeesTheReplacedFakeLFOnceReset ) {
+    line_array.append( positions[1999] + 10 );
+    line_array.setFakeFinalLF();
+
+    LinePositionArray::Cursor cursor( line_array );
+    ASSERT_THAT( cursor.at( 2000 ), Eq( positions[1999] + 10 ) );
+
+    line_array.append( positions[1999] + 20 );
+    cursor.reset();
+    ASSERT_THAT( cursor.at( 2000 ), Eq( positions[1999] + 20 ) );
+}
+
+TEST_F( LinePositionArrayCursor, CanBeUsedByManyThreadsAtOnce ) {
+    vector<thread> threads;
+    vector<int> nb_errors( 8, 0 );
+    for ( int t = 0; t < 8; t++ ) {
+        threads.emplace_back( [this, t, &nb_errors] {
+            LinePositionArray::Cursor cursor( line_array );
+            for ( int i = t; i < 2000 * 20; i += 7 ) {
+                if ( cursor.at( i % 2000 ) != positions[i % 2000] )
+                    ++nb_errors[t];
+            }
+        } );
+    }
+    for ( auto& thread : threads )
+        thread.join();
+
+    ASSERT_THAT( nb_errors, Each( Eq( 0 ) ) );
+}
@@ -0,0 +1,147 @@
+#include "gmock/gmock.h"
+
+#include <random>
+#include <string>
+
+#include "log.h"
+
+#include "data/linescanner.h"
+
+using namespace std;
+using namespace testing;
+
+// Results of scanning a whole buffer with a given kernel
+struct ScanResult {
+    FastLinePositionArray line_positions;
+    qint64 pos = 0;
+    int additional_spaces = 0;
+    int max_length = 0;
+};
+
+class LineScannerEquivalence: public testing::TestWithParam<LineScanner::Kernel> {
+  public:
+    // Scan the buffer in blocks of the passed size (a code unit
+    // cut by the end of a block is scanned with the next one)
+    static void scan( LineScanner::Kernel kernel, const string& buffer,
+            int block_size, ScanResult* result,
+            LineScanner::CodeUnit unit = LineScanner::CodeUnit::Byte ) {
+        const LineScanner scanner( kernel, unit );
+        int beginning = 0;
+        while ( beginning < static_cast<int>( buffer.size() ) ) {
+            const int size = scanner.alignedSize( qMin<int>(
+                        qMax( block_size, scanner.unitSize() ), buffer.size() - beginning ) );
+            if ( size == 0 )
+                break;
+            scanner.scan( buffer.data() + beginning, size, beginning,
+                    &result->pos, &result->additional_spaces,
+                    &result->max_length, &result->line_positions );
+            beginning += size;
+        }
+    }
+
+    // Encode the passed text in UTF-16 (with a BOM)
+    static string toUtf16( const u16string& text, bool big_endian ) {
+        string buffer = big_endian ? "\xFE\xFF" : "\xFF\xFE";
+        for ( const char16_t c : text ) {
+            const char high = static_cast<char>( c >> 8 );
+            const char low = static_cast<char>( c & 0xFF );
+            buffer += big_endian ? high : low;
+            buffer += big_endian ? low : high;
+        }
+        return buffer;
+    }
+
+    void checkSameAsScalar( const string& buffer, int block_size,
+            LineScanner::CodeUnit unit = LineScanner::CodeUnit::Byte ) {
+        if ( ! LineScanner::isSupported( GetParam() ) )
+            return;
+
+        ScanResult reference;
+        ScanResult result;
+        scan( LineScanner::Kernel::Scalar, buffer, block_size, &reference, unit );
+        scan( GetParam(), buffer, block_size, &result, unit );
+
+        ASSERT_THAT( result.line_positions.size(),
+                Eq( reference.line_positions.size() ) );
+        for ( int i = 0; i < reference.line_positions.size(); ++i )
+            ASSERT_THAT( result.line_positions[i], Eq( reference.line_positions[i] ) );
+        ASSERT_THAT( result.pos, Eq( reference.pos ) );
+        ASSERT_THAT( result.additional_spaces, Eq( reference.additional_spaces ) );
+        ASSERT_THAT( result.max_length, Eq( reference.max_length ) );
+    }
+};
+
+TEST_P( LineScannerEquivalence, FindsSimpleLines ) {
+    string buffer;
+    for ( int i = 0; i < 1000; ++i )
+        buffer += "This is line " + to_string( i ) + "\n";
+
+    checkSameAsScalar( buffer, 5*1024*1024 );
+}
+
+TEST_P( LineScannerEquivalence, ExpandsTabs ) {
+    string buffer;
+    for ( int i = 0; i < 1000; ++i )
+        buffer += string( i % 13, 'a' ) + "\t" + to_string( i ) + "\t\tend\n";
+
+    checkSameAsScalar( buffer, 5*1024*1024 );
+}
+
+TEST_P( LineScannerEquivalence, HandlesOddSizedBlocks ) {
+    mt19937 generator( 42 );
+    const char alphabet[] = "abc \t\n\t\xC3\xA9xyz\n";
+
+    string buffer;
+    for ( int i = 0; i < 100000; ++i )
+        buffer += alphabet[ generator() % ( sizeof( alphabet ) - 1 ) ];
+
+    for ( int block_size : { 1, 7, 16, 31, 32, 33, 1000, 4093 } )
+        checkSameAsScalar( buffer, block_size );
+}
+
+TEST_P( LineScannerEquivalence, HandlesUnterminatedLine ) {
+    checkSameAsScalar( string( 1000, 'x' ) + "\t" + string( 100, 'y' ), 64 );
+}
+
+TEST_P( LineScannerEquivalence, ScansUtf16ByCodeUnits ) {
+    mt19937 generator( 42 );
+    // (with characters containing LF and tab bytes)
+    const u16string alphabet = u"abc \t\n\t\u00e9\u0a41\u010a\u0909xyz\n";
+
+    u16string text;
+    for ( int i = 0; i < 100000; ++i )
+        text += alphabet[ generator() % alphabet.size() ];
+
+    for ( bool big_endian : { false, true } ) {
+        const string buffer = toUtf16( text, big_endian );
+        const LineScanner::CodeUnit unit = LineScanner::codeUnitOf(
+                buffer.data(), buffer.size() );
+        ASSERT_THAT( unit, Eq( big_endian ?
+                    LineScanner::CodeUnit::Utf16BE : LineScanner::CodeUnit::Utf16LE ) );
+
+        for ( int block_size : { 1, 7, 16, 31, 32, 33, 1000, 4093 } )
+            checkSameAsScalar( buffer, block_size, unit );
+    }
+}
+
+TEST( LineScannerUtf16, FindsTheLineFeedCodeUnits ) {
+    // U+0A0A and U+010A contain a LF byte, but are not LFs
+    const u16string text = u"\u0a0a\u010a\tx\nline\n\u0909";
+
+    for ( bool big_endian : { false, true } ) {
+        const string buffer = LineScannerEquivalence::toUtf16( text, big_endian );
+        ScanResult result;
+        LineScannerEquivalence::scan( LineScanner::Kernel::Scalar, buffer, 4096,
+                &result, LineScanner::codeUnitOf( buffer.data(), buffer.size() ) );
+
+        // Positions after the LFs, lengths in characters
+        ASSERT_THAT( result.line_positions.size(), Eq( 2 ) );
+        ASSERT_THAT( result.line_positions[0], Eq( 2 + 2 * 5 ) );
+        ASSERT_THAT( result.line_positions[1], Eq( 2 + 2 * 10 ) );
+        ASSERT_THAT( result.max_length, Eq( 9 ) );
+        ASSERT_THAT( result.pos, Eq( 2 + 2 * 10 ) );
+    }
+}
+
+INSTANTIATE_TEST_CASE_P( AllKernels, LineScannerEquivalence,
+        Values( LineScanner::Kernel::SSE2, LineScanner::Kernel::AVX2 ) );
@@ -0,0 +1,72 @@
+#include "gmock/gmock.h"
+
+#include <random>
+#include <string>
+
+#include "data/literalfinder.h"
+
+using namespace std;
+using namespace testing;
+
+// Offset of the first occurrence, the slow way
+static int naiveFind( const string& block, const string& literal,
+        bool case_insensitive, int from )
+{
+    const auto fold = [&]( char c ) {
+        return case_insensitive && c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+    };
+    for ( int i = from; i + static_cast<int>( literal.size() ) <= static_cast<int>( block.size() ); ++i ) {
+        int j = 0;
+        while ( j < static_cast<int>( literal.size() ) && fold( block[i + j] ) == fold( literal[j] ) )
+            ++j;
+        if ( j == static_cast<int>( literal.size() ) )
+            return i;
+    }
+    return -1;
+}
+
+TEST( LiteralFinderBehaviour, findsTheFirstOccurrence ) {
+    const LiteralFinder finder( "timeout", false );
+    const string block = "12:00 ERROR connection TIMEOUT\n12:01 ERROR connection timeout\n";
+
+    ASSERT_THAT( finder.find( block.data(), block.size() ), Eq( 54 ) );
+    ASSERT_THAT( finder.find( block.data(), block.size(), 55 ), Eq( -1 ) );
+    ASSERT_THAT( finder.find( block.data(), 60 ), Eq( -1 ) );
+}
+
+TEST( LiteralFinderBehaviour, ignoresTheCaseOfLettersOnly ) {
+    const LiteralFinder finder( "ERROR@1", true );
+    const string block = "error`1 Error@1";
+
+    ASSERT_THAT( finder.literal(), Eq( QByteArray( "error@1" ) ) );
+    ASSERT_THAT( finder.find( block.data(), block.size() ), Eq( 8 ) );
+}
+
+TEST( LiteralFinderBehaviour, findsNothingWhenEmpty ) {
+    const LiteralFinder finder;
+    const string block = "anything";
+
+    ASSERT_TRUE( finder.isEmpty() );
+    ASSERT_THAT( finder.find( block.data(), block.size() ), Eq( -1 ) );
+}
+
+TEST( LiteralFinderBehaviour, findsLikeANaiveSearch ) {
+    mt19937 random( 42 );
+    const string alphabet = "abAB \t:=";
+
+    for ( int n = 0; n < 200; ++n ) {
+        string block( random() % 100, ' ' );
+        for ( char& c : block )
+            c = alphabet[ random() % alphabet.size() ];
+        string literal( 1 + random() % 4, ' ' );
+        for ( char& c : literal )
+            c = alphabet[ random() % alphabet.size() ];
+        const bool case_insensitive = random() % 2;
+        const int from = random() % ( block.size() + 1 );
+
+        const LiteralFinder finder( QByteArray( literal.data(), literal.size() ), case_insensitive );
+        ASSERT_THAT( finder.find( block.data(), block.size(), from ),
+                Eq( naiveFind( block, literal, case_insensitive, from ) ) )
+            << "\"" << literal << "\" in \"" << block << "\" from " << from;
+    }
+}
@@ -1,11 +1,16 @@
 #include <iostream>
+#include <thread>
+#include <vector>
 
+#include <QElapsedTimer>
 #include <QTest>
 #include <QSignalSpy>
+#include <QStandardPaths>
 
 #include "log.h"
 #include "test_utils.h"
 
+#include "data/indexcache.h"
 #include "data/logdata.h"
 
 #include "gmock/gmock.h"
@@ -121,6 +126,60 @@ TEST_F( LogDataChanging, changingFile ) {
     }
 }
 
+TEST_F( LogDataChanging, coalescesTheUpdates ) {
+    char newLine[90];
+    LogData log_data;
+    log_data.setUpdateLatency( 300 );
+
+    QFile file( TMPDIR "/growingfile.txt" );
+    ASSERT_TRUE( file.open( QIODevice::WriteOnly ) );
+    for ( int i = 0; i < 100; i++ ) {
+        snprintf( newLine, 89, sl_format, i );
+        file.write( newLine, qstrlen( newLine ) );
+    }
+    file.close();
+
+    SafeQSignalSpy attachSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    log_data.attachFile( TMPDIR "/growingfile.txt" );
+    ASSERT_TRUE( attachSpy.safeWait() );
+
+    SafeQSignalSpy finishedSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    SafeQSignalSpy changedSpy( &log_data,
+            SIGNAL( fileChanged( LogData::MonitoredFileStatus ) ) );
+
+    // Many appends, closer to each other than the latency
+    QElapsedTimer appending;
+    appending.start();
+    for ( int batch = 0; batch < 20; ++batch ) {
+        ASSERT_TRUE( file.open( QIODevice::Append ) );
+        for ( int i = 0; i < 10; i++ ) {
+            snprintf( newLine, 89, sl_format, 100 + batch * 10 + i );
+            file.write( newLine, qstrlen( newLine ) );
+        }
+        file.close();
+        QTest::qWait( 10 );
+    }
+    const qint64 elapsed = appending.elapsed();
+
+    // (until the last update is done)
+    for ( int i = 0; i < 100 && log_data.getNbLine() < 300; ++i )
+        QTest::qWait( 50 );
+    QTest::qWait( 500 );
+
+    // At most one update per latency period, each announced once
+    ASSERT_THAT( finishedSpy.count(), Ge( 1 ) );
+    ASSERT_THAT( finishedSpy.count(), Le( elapsed / 300 + 2 ) );
+    ASSERT_THAT( changedSpy.count(), Eq( finishedSpy.count() ) );
+
+    // which has indexed the lines of every append once, in order
+    ASSERT_THAT( log_data.getNbLine(), 300LL );
+    for ( int i = 0; i < 300; i++ ) {
+        snprintf( newLine, 89, sl_format, i );
+        ASSERT_THAT( QString::compare( log_data.getLineString( i ),
+                    QString::fromLatin1( newLine ).trimmed() ), 0 );
+    }
+}
+
 class LogDataBehaviour : public testing::Test {
   public:
     LogDataBehaviour() {
@@ -194,6 +253,262 @@ TEST_F( LogDataBehaviour, readFunctions ) {
     ASSERT_THAT( QString::compare( log_data.getExpandedLines( 12, 2 ).at( 0 ), ref ), 0 );
 }
 
+TEST_F( LogDataBehaviour, cachesTheExpandedLines ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    endSpy.safeWait( 10000 );
+
+    const DecodedLineCache& cache = log_data.decodedLineCache();
+    const QStringList lines = log_data.getExpandedLines( 100, 50 );
+    const qint64 misses = cache.misses();
+
+    ASSERT_THAT( log_data.getExpandedLines( 100, 50 ), Eq( lines ) );
+    ASSERT_THAT( QString::compare( log_data.getExpandedLineString( 120 ),
+                lines.at( 20 ) ), 0 );
+    ASSERT_THAT( cache.misses(), Eq( misses ) );
+    ASSERT_THAT( cache.hits(), Ge( 3 ) );
+
+    // The encoding might change the lines
+    log_data.setDisplayEncoding( Encoding::ENCODING_UTF8 );
+    log_data.getExpandedLines( 100, 50 );
+    ASSERT_THAT( cache.misses(), Gt( misses ) );
+}
+
+TEST_F( LogDataBehaviour, readsRawLines ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    endSpy.safeWait( 10000 );
+
+    const RawLines lines = log_data.getRawLines( 10, 5 );
+    ASSERT_THAT( lines.size(), 5 );
+    for ( int i = 0; i < lines.size(); ++i ) {
+        const QString expected = log_data.getLineString( 10 + i );
+        ASSERT_THAT( lines.lineSize( i ), SL_LINE_LENGTH );
+        ASSERT_THAT( QByteArray( lines.lineData( i ), lines.lineSize( i ) ),
+                expected.toLatin1() );
+        ASSERT_THAT( QString::compare( lines.lineString( i ), expected ), 0 );
+        ASSERT_THAT( lines.expandedLength( i ), log_data.getLineLength( 10 + i ) );
+    }
+
+    ASSERT_THAT( log_data.getRawLines( SL_NB_LINES - 1, 2 ).size(), 0 );
+}
+
+TEST_F( LogDataBehaviour, readsFromSeveralThreadsAtOnce ) {
+    for ( bool memory_mapping : { false, true } ) {
+        LogData log_data;
+        IndexingOptions options;
+        options.memoryMapping = memory_mapping;
+        log_data.setIndexingOptions( options );
+        SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+        log_data.attachFile( TMPDIR "/smalllog.txt" );
+        endSpy.safeWait( 10000 );
+        ASSERT_THAT( log_data.getNbLine(), SL_NB_LINES );
+
+        const int nb_threads = 4;
+        std::vector<int> errors( nb_threads, 0 );
+        std::vector<std::thread> readers;
+        for ( int thread = 0; thread < nb_threads; ++thread ) {
+            readers.emplace_back( [&, thread]() {
+                char line[90];
+                for ( int i = thread; i < SL_NB_LINES; i += nb_threads ) {
+                    snprintf( line, 89, sl_format, i );
+                    const QString expected = QString::fromUtf8( line ).trimmed();
+                    if ( log_data.getLineString( i ) != expected
+                            || log_data.getLines( i, 1 ).at( 0 ) != expected )
+                        ++errors[thread];
+                }
+            } );
+        }
+        for ( auto& reader : readers )
+            reader.join();
+
+        for ( int thread_errors : errors )
+            ASSERT_THAT( thread_errors, 0 );
+    }
+}
+
+TEST_F( LogDataBehaviour, readsNothingFromATruncatedFile ) {
+    QFile::remove( TMPDIR "/truncatedlog.txt" );
+    QFile::copy( TMPDIR "/smalllog.txt", TMPDIR "/truncatedlog.txt" );
+
+    LogData log_data;
+    IndexingOptions options;
+    options.memoryMapping = true;
+    log_data.setIndexingOptions( options );
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/truncatedlog.txt" );
+    endSpy.safeWait( 10000 );
+    ASSERT_THAT( log_data.getNbLine(), SL_NB_LINES );
+
+    // Under the mapping, before the file is indexed again
+    QFile( TMPDIR "/truncatedlog.txt" ).resize( 0 );
+
+    const QStringList lines = log_data.getLines( SL_NB_LINES - 100, 100 );
+    ASSERT_THAT( lines.size(), 100 );
+    for ( const QString& line : lines )
+        ASSERT_TRUE( line.isEmpty() );
+    ASSERT_TRUE( log_data.getLineString( SL_NB_LINES - 1 ).isEmpty() );
+}
+
+TEST_F( LogDataBehaviour, startsFromTheCachedIndex ) {
+    QStandardPaths::setTestModeEnabled( true );
+    QFile::remove( TMPDIR "/cachedlog.txt" );
+    QFile::copy( TMPDIR "/smalllog.txt", TMPDIR "/cachedlog.txt" );
+
+    // An index of the file with a maximum length only the cache can give
+    IndexingData indexing_data;
+    FastLinePositionArray positions;
+    for ( qint64 i = 0; i < SL_NB_LINES; ++i )
+        positions.append( ( i + 1 ) * ( SL_LINE_LENGTH + 1 ) );
+    indexing_data.addAll( SL_NB_LINES * ( SL_LINE_LENGTH + 1 ), 12345, positions,
+            EncodingSpeculator::Encoding::ASCII7 );
+    IndexCache cache( TMPDIR "/cachedlog.txt" );
+    cache.save( indexing_data );
+
+    // The lines added since are indexed from the end of the cached index
+    const auto line = []( int i ) {
+        char newLine[90];
+        snprintf( newLine, 89, sl_format, i );
+        return QByteArray( newLine );
+    };
+    QFile file( TMPDIR "/cachedlog.txt" );
+    ASSERT_TRUE( file.open( QIODevice::Append ) );
+    for ( int i = SL_NB_LINES; i < SL_NB_LINES + 10; ++i )
+        file.write( line( i ) );
+    file.close();
+
+    LogData log_data;
+    IndexingOptions options;
+    options.indexCache = true;
+    log_data.setIndexingOptions( options );
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/cachedlog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    ASSERT_THAT( log_data.getNbLine(), SL_NB_LINES + 10 );
+    ASSERT_THAT( log_data.getMaxLength(), 12345 );
+    for ( int i : { 0, 1234, int( SL_NB_LINES ) - 1, int( SL_NB_LINES ) + 5 } )
+        ASSERT_THAT( QString::compare( log_data.getLineString( i ),
+                    QString::fromLatin1( line( i ).trimmed() ) ), 0 );
+
+    cache.clear();
+}
+
+TEST_F( LogDataBehaviour, indexesTheTailFirst ) {
+    // Big enough for its beginning to take a while to index
+    QFile file( TMPDIR "/tailfirstlog.txt" );
+    ASSERT_TRUE( file.open( QIODevice::WriteOnly ) );
+    char newLine[90];
+    for ( int i = 0; i < 500000; ++i ) {
+        snprintf( newLine, 89, sl_format, i );
+        file.write( newLine, qstrlen( newLine ) );
+    }
+    file.close();
+
+    // The tail starts after the first end of line of its last MiB
+    const qint64 tail_first_size = 1024 * 1024;
+    const qint64 nb_prefix_lines =
+        ( file.size() - tail_first_size ) / ( SL_LINE_LENGTH + 1 ) + 1;
+
+    IndexingOptions options;
+    options.indexCache = false;
+
+    LogData full;
+    full.setIndexingOptions( options );
+    SafeQSignalSpy fullSpy( &full, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    full.attachFile( TMPDIR "/tailfirstlog.txt" );
+    ASSERT_TRUE( fullSpy.safeWait( 10000 ) );
+
+    options.tailFirstSize = tail_first_size;
+    options.nbThreads = 1;
+    LogData log_data;
+    log_data.setIndexingOptions( options );
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    SafeQSignalSpy changedSpy( &log_data,
+            SIGNAL( fileChanged( LogData::MonitoredFileStatus ) ) );
+    log_data.attachFile( TMPDIR "/tailfirstlog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    // The tail, numbered from its beginning (unless the prefix has
+    // already been spliced, what is read is provisional if the line
+    // numbers still are after)
+    const qint64 nb_tail_lines = log_data.getNbLine();
+    const QStringList tail_lines = log_data.getLines( 0, 100 );
+    const bool provisional = log_data.hasProvisionalLineNumbers();
+    if ( provisional ) {
+        ASSERT_THAT( nb_tail_lines, full.getNbLine() - nb_prefix_lines );
+        ASSERT_TRUE( tail_lines == full.getLines( nb_prefix_lines, 100 ) );
+    }
+
+    // Then the whole file, renumbered once
+    while ( endSpy.count() < 2 )
+        ASSERT_TRUE( endSpy.wait( 10000 ) );
+    QTest::qWait( 100 );
+    ASSERT_THAT( endSpy.count(), 2 );
+    ASSERT_THAT( changedSpy.count(), 1 );
+    ASSERT_THAT( changedSpy.takeFirst().at( 0 ).value<LogData::MonitoredFileStatus>(),
+            LogData::LinesRenumbered );
+
+    ASSERT_FALSE( log_data.hasProvisionalLineNumbers() );
+    ASSERT_THAT( log_data.getNbLine(), full.getNbLine() );
+    ASSERT_THAT( log_data.getMaxLength(), full.getMaxLength() );
+    for ( qint64 line = 0; line < full.getNbLine(); line += 10000 ) {
+        const int number = qMin<qint64>( 10000, full.getNbLine() - line );
+        ASSERT_TRUE( log_data.getLines( line, number ) == full.getLines( line, number ) );
+    }
+
+    // What was the first line is after the prefix
+    if ( provisional )
+        ASSERT_TRUE( log_data.getLines( nb_prefix_lines, 100 ) == tail_lines );
+}
+
+TEST_F( LogDataBehaviour, readsWindowsOfLongLines ) {
+    // Lines 1 and 3 are long enough to be read by windows
+    QFile file( TMPDIR "/longlines.txt" );
+    ASSERT_TRUE( file.open( QIODevice::WriteOnly ) );
+    QByteArray long_line;
+    for ( int i = 0; long_line.size() < 3 * LongLineIndex::stride; ++i )
+        long_line.append( QString( "%1\tcaf\u00e9 \u20ac " ).arg( i ).toUtf8() );
+    file.write( "short line\n" );
+    file.write( long_line + "\n" );
+    file.write( "\tanother short line\n" );
+    file.write( long_line + "\n" );
+    file.write( "last line\n" );
+    file.close();
+
+    for ( Encoding encoding : { Encoding::ENCODING_ISO_8859_1, Encoding::ENCODING_UTF8 } ) {
+        LogData log_data;
+        SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+        log_data.setDisplayEncoding( encoding );
+        log_data.attachFile( TMPDIR "/longlines.txt" );
+        ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+        const QString expanded = log_data.getExpandedLineString( 1 );
+        ASSERT_THAT( log_data.getLineLength( 1 ), expanded.size() );
+        for ( int column : { 0, 5, 1000, LongLineIndex::stride - 3,
+                2 * LongLineIndex::stride + 17, expanded.size() - 10,
+                expanded.size() + 10 } ) {
+            ASSERT_THAT( QString::compare( log_data.getExpandedLineWindow( 1, column, 80 ),
+                        expanded.mid( column, 80 ) ), 0 );
+        }
+
+        const int column = LongLineIndex::stride + 1;
+        const QStringList windows = log_data.getExpandedLineWindows( 0, 5, column, 80 );
+        ASSERT_THAT( windows.size(), 5 );
+        for ( int i = 0; i < windows.size(); ++i )
+            ASSERT_THAT( QString::compare( windows.at( i ),
+                        log_data.getExpandedLineString( i ).mid( column, 80 ) ), 0 );
+    }
+}
+
 class LogDataMultiByte : public testing::Test {
   public:
     LogDataMultiByte() {
@@ -277,3 +592,142 @@ TEST_F( LogDataMultiByte, readUtf16BE ) {
     ASSERT_THAT( QString::compare( log_data.getLines( 11, 3 ).at( 2 ), QStringLiteral( "DOM CARLOS, frère d'Elvire." ) ), 0 );
     ASSERT_THAT( QString::compare( log_data.getExpandedLines( 0, 3 ).at( 2 ), QStringLiteral( "COMÉDIE" ) ), 0 );
 }
+
+TEST_F( LogDataMultiByte, indexesUtf16ByCodeUnits ) {
+    // U+010A and U+0A0A contain LF bytes, U+0909 a tab byte
+    const QString text = QString::fromUtf8( u8"first\naĊb\nਊ\tउx\nlast" );
+
+    const struct {
+        const char* codec;
+        const char* bom;
+        Encoding encoding;
+    } files[] = {
+        { "UTF-16LE", "\xFF\xFE", Encoding::ENCODING_UTF16LE },
+        { "UTF-16BE", "\xFE\xFF", Encoding::ENCODING_UTF16BE } };
+
+    for ( const auto& f : files ) {
+        QFile file( TMPDIR "/utf16bom.txt" );
+        ASSERT_TRUE( file.open( QIODevice::WriteOnly ) );
+        file.write( f.bom, 2 );
+        file.write( QTextCodec::codecForName( f.codec )->fromUnicode( text ) );
+        file.close();
+
+        LogData log_data;
+        SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+        log_data.attachFile( TMPDIR "/utf16bom.txt" );
+        ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+        log_data.setDisplayEncoding( f.encoding );
+
+        ASSERT_THAT( log_data.getNbLine(), 4LL );
+        // (the lengths are in characters, the BOM counting as one)
+        ASSERT_THAT( log_data.getMaxLength(), 10 );
+        ASSERT_THAT( QString::compare( log_data.getLineString( 1 ),
+                    QString::fromUtf8( u8"aĊb" ) ), 0 );
+        ASSERT_THAT( QString::compare( log_data.getExpandedLineString( 2 ),
+                    QString::fromUtf8( u8"ਊ       उx" ) ), 0 );
+        ASSERT_THAT( QString::compare( log_data.getLines( 1, 3 ).at( 2 ),
+                    QStringLiteral( "last" ) ), 0 );
+    }
+}
+
+class LogDataParallelIndexing : public testing::Test {
+  public:
+    // Size of the chunks indexed in parallel (IndexOperation::sizeChunk)
+    static const int sizeChunk = 5 * 1024 * 1024;
+
+    // Lines up to size characters, with at each of the passed positions
+    // a run of tabs and a CR/LF pair split by it in turn
+    static QString splitLines( int size, const std::vector<int>& boundaries ) {
+        QString text;
+        bool tabs = true;
+        for ( int boundary : boundaries ) {
+            appendLines( &text, boundary - 300 );
+            if ( tabs ) {
+                text.append( QString( boundary - 4 - text.size(), 'x' ) );
+                text.append( "\t\t\t\t\t\t\t\tafter the tabs\n" );
+            }
+            else {
+                text.append( QString( boundary - 1 - text.size(), 'y' ) );
+                text.append( "\r\n" );
+            }
+            tabs = ! tabs;
+        }
+        appendLines( &text, size );
+        return text;
+    }
+
+    static void appendLines( QString* text, int size ) {
+        for ( int i = 0; text->size() + 40 < size; ++i )
+            text->append( QString( "line %1\tof the\tfile\n" ).arg( i ) );
+    }
+
+    static void write( const QString& file_name, const QByteArray& bytes ) {
+        QFile file( file_name );
+        ASSERT_TRUE( file.open( QIODevice::WriteOnly ) );
+        file.write( bytes );
+    }
+
+    // The file indexed by several threads (in place in a mapping or
+    // not) must be indexed exactly as by one
+    void expectSameIndex( const QString& file_name, Encoding encoding ) {
+        IndexingOptions options;
+        options.nbThreads = 1;
+        options.indexCache = false;
+        LogData sequential;
+        sequential.setIndexingOptions( options );
+        SafeQSignalSpy sequentialSpy( &sequential, SIGNAL( loadingFinished( LoadingStatus ) ) );
+        sequential.attachFile( file_name );
+        ASSERT_TRUE( sequentialSpy.safeWait( 20000 ) );
+        sequential.setDisplayEncoding( encoding );
+
+        for ( bool memory_mapping : { false, true } ) {
+            options.nbThreads = 4;
+            options.memoryMapping = memory_mapping;
+            LogData parallel;
+            parallel.setIndexingOptions( options );
+            SafeQSignalSpy parallelSpy( &parallel, SIGNAL( loadingFinished( LoadingStatus ) ) );
+            parallel.attachFile( file_name );
+            ASSERT_TRUE( parallelSpy.safeWait( 20000 ) );
+            parallel.setDisplayEncoding( encoding );
+
+            ASSERT_THAT( parallel.getNbLine(), Eq( sequential.getNbLine() ) );
+            ASSERT_THAT( parallel.getMaxLength(), Eq( sequential.getMaxLength() ) );
+            for ( qint64 line = 0; line < sequential.getNbLine(); line += 1000 ) {
+                const int number = qMin<qint64>( 1000, sequential.getNbLine() - line );
+                ASSERT_TRUE( parallel.getLines( line, number )
+                        == sequential.getLines( line, number ) );
+                for ( qint64 i = line; i < line + number; ++i )
+                    ASSERT_THAT( parallel.getLineLength( i ),
+                            Eq( sequential.getLineLength( i ) ) );
+            }
+        }
+    }
+};
+
+TEST_F( LogDataParallelIndexing, splitsTabsAndLineEndsAcrossChunks ) {
+    const int size = 3 * sizeChunk + sizeChunk / 2;
+    write( TMPDIR "/parallellog.txt",
+            splitLines( size, { sizeChunk, 2 * sizeChunk, 3 * sizeChunk } ).toLatin1() );
+
+    expectSameIndex( TMPDIR "/parallellog.txt", Encoding::ENCODING_ISO_8859_1 );
+}
+
+TEST_F( LogDataParallelIndexing, splitsUtf16AcrossChunks ) {
+    // (after the BOM, the chunks start at a code unit in the middle of
+    // the tabs and between CR and LF)
+    const int size = ( 3 * sizeChunk + sizeChunk / 2 ) / 2;
+    const QString text = splitLines( size,
+            { ( sizeChunk - 2 ) / 2, ( 2 * sizeChunk - 2 ) / 2, ( 3 * sizeChunk - 2 ) / 2 } );
+    write( TMPDIR "/parallelutf16.txt",
+            QByteArray( "\xFF\xFE", 2 ) + QTextCodec::codecForName( "UTF-16LE" )->fromUnicode( text ) );
+
+    expectSameIndex( TMPDIR "/parallelutf16.txt", Encoding::ENCODING_UTF16LE );
+}
+
+TEST_F( LogDataParallelIndexing, indexesAFileSmallerThanAChunk ) {
+    write( TMPDIR "/parallelsmall.txt", splitLines( 10000, { 5000, 8000 } ).toLatin1() );
+
+    expectSameIndex( TMPDIR "/parallelsmall.txt", Encoding::ENCODING_ISO_8859_1 );
+}
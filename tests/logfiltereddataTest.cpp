@@ -6,6 +6,7 @@
 
 #include "data/logdata.h"
 #include "data/logfiltereddata.h"
+#include "data/trigramindex.h"
 
 #include "gmock/gmock.h"
 
@@ -66,3 +67,102 @@ TEST_F( MarksBehaviour, marksAreStored ) {
     ASSERT_TRUE( filtered_data->isLineMarked( 10 ) );
     ASSERT_TRUE( filtered_data->isLineMarked( 25 ) );
 }
+
+class SearchBehaviour : public testing::Test {
+  public:
+    LogData log_data;
+    std::unique_ptr<LogFilteredData> filtered_data;
+
+    SearchBehaviour() {
+        QFile file( TMPDIR "/searchlog.txt" );
+        if ( file.open( QIODevice::WriteOnly ) ) {
+            char newLine[90];
+            for ( int i = 0; i < 10 * SL_NB_LINES; i++ ) {
+                snprintf( newLine, 89, sl_format, i );
+                file.write( newLine, qstrlen( newLine ) );
+            }
+        }
+        file.close();
+
+        SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+        log_data.attachFile( TMPDIR "/searchlog.txt" );
+        endSpy.safeWait( 10000 );
+
+        filtered_data.reset( log_data.getNewFilteredData() );
+    }
+
+    // Returns the matching lines of a search on the passed number of threads
+    std::vector<qint64> search( const RegExpFilter& regexp, int nb_threads ) {
+        QSignalSpy progressSpy( filtered_data.get(),
+                SIGNAL( searchProgressed( int, int, qint64 ) ) );
+
+        filtered_data->setSearchThreads( nb_threads );
+        filtered_data->runSearch( regexp );
+        int percent = 0;
+        while ( percent < 100 && progressSpy.wait( 10000 ) )
+            percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+        std::vector<qint64> lines;
+        for ( LineNumber i = 0; i < filtered_data->getNbMatches(); ++i )
+            lines.push_back( filtered_data->getMatchingLineNumber( i ) );
+        return lines;
+    }
+};
+
+TEST_F( SearchBehaviour, parallelSearchFindsTheSameLines ) {
+    const struct {
+        const char* pattern;
+        size_t nb_matches;
+    } searches[] = { { "line 0[0-9]*7$", 5000 }, { "line", 50000 }, { "nothing", 0 } };
+
+    for ( const auto& s : searches ) {
+        const std::vector<qint64> serial = search( RegExpFilter( s.pattern ), 1 );
+        const std::vector<qint64> parallel = search( RegExpFilter( s.pattern ), 4 );
+
+        ASSERT_THAT( serial.size(), s.nb_matches );
+        ASSERT_THAT( parallel, testing::ContainerEq( serial ) );
+    }
+}
+
+TEST( TrigramSearchBehaviour, findsTheLastLineCompletedAfterTheIndexing ) {
+    // A whole block of lines, the last one without its final LF
+    QFile file( TMPDIR "/trigramlog.txt" );
+    ASSERT_TRUE( file.open( QIODevice::WriteOnly ) );
+    char newLine[90];
+    for ( int i = 0; i < TrigramIndex::blockLines - 1; i++ ) {
+        snprintf( newLine, 89, sl_format, i );
+        file.write( newLine, qstrlen( newLine ) );
+    }
+    file.write( "beginning of line" );
+    file.close();
+
+    LogData log_data;
+    IndexingOptions options;
+    options.trigramIndex = true;
+    log_data.setIndexingOptions( options );
+
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    log_data.attachFile( TMPDIR "/trigramlog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+    ASSERT_THAT( log_data.getNbLine(), TrigramIndex::blockLines );
+
+    // (lets the trigrams be indexed)
+    QTest::qWait( 200 );
+
+    ASSERT_TRUE( file.open( QIODevice::Append ) );
+    file.write( " zyxwv\n" );
+    file.close();
+    ASSERT_TRUE( endSpy.wait( 1000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    QSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( int, int, qint64 ) ) );
+    filtered_data->runSearch( RegExpFilter( "line zyxwv" ) );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    ASSERT_THAT( filtered_data->getNbMatches(), 1 );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 0 ),
+            TrigramIndex::blockLines - 1 );
+}
@@ -0,0 +1,50 @@
+#include "gmock/gmock.h"
+
+#include "log.h"
+
+#include "data/longlineindex.h"
+
+using namespace testing;
+
+class LongLineIndexBehaviour : public testing::Test {
+  public:
+    LongLineIndex index { 2 };
+
+    static std::shared_ptr<const LongLineIndex::Checkpoints> checkpoints() {
+        return std::make_shared<LongLineIndex::Checkpoints>(
+                LongLineIndex::Checkpoints { { 0, 0 }, { 100, 90 }, { 203, 180 }, { 250, 230 } } );
+    }
+};
+
+TEST_F( LongLineIndexBehaviour, FindsTheClosestCheckpoint ) {
+    const auto line = checkpoints();
+
+    ASSERT_THAT( LongLineIndex::closest( *line, 0 ).offset, Eq( 0 ) );
+    ASSERT_THAT( LongLineIndex::closest( *line, 89 ).offset, Eq( 0 ) );
+    ASSERT_THAT( LongLineIndex::closest( *line, 90 ).offset, Eq( 100 ) );
+    ASSERT_THAT( LongLineIndex::closest( *line, 200 ).column, Eq( 180 ) );
+    ASSERT_THAT( LongLineIndex::closest( *line, 1000 ).column, Eq( 230 ) );
+}
+
+TEST_F( LongLineIndexBehaviour, KeepsTheMostRecentlyUsedLines ) {
+    index.put( index.generation(), 1, checkpoints() );
+    index.put( index.generation(), 2, checkpoints() );
+    ASSERT_THAT( index.get( 1 ), NotNull() );
+
+    index.put( index.generation(), 3, checkpoints() );
+
+    ASSERT_THAT( index.get( 1 ), NotNull() );
+    ASSERT_THAT( index.get( 2 ), IsNull() );
+    ASSERT_THAT( index.get( 3 ), NotNull() );
+}
+
+TEST_F( LongLineIndexBehaviour, IgnoresTheLinesReadBeforeAClear ) {
+    const uint64_t generation = index.generation();
+    index.put( generation, 1, checkpoints() );
+
+    index.clear();
+    index.put( generation, 2, checkpoints() );
+
+    ASSERT_THAT( index.get( 1 ), IsNull() );
+    ASSERT_THAT( index.get( 2 ), IsNull() );
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "data/mappedfile.h"
+
+#include "gmock/gmock.h"
+
+using namespace testing;
+
+class MappedFileBehaviour : public testing::Test {
+  public:
+    QTemporaryDir directory;
+    QString fileName;
+    QByteArray content;
+
+    MappedFileBehaviour() : fileName( directory.filePath( "mapped.log" ) ) {
+        // A few pages
+        for ( int i = 0; content.size() < 256 * 1024; ++i )
+            content.append( QString( "line %1 of the file\n" ).arg( i ).toLatin1() );
+        write( content );
+    }
+
+    void write( const QByteArray& bytes ) {
+        QFile file( fileName );
+        file.open( QIODevice::WriteOnly );
+        file.write( bytes );
+    }
+
+    void truncate( qint64 size ) {
+        QFile file( fileName );
+        file.resize( size );
+    }
+};
+
+TEST_F( MappedFileBehaviour, readsTheFileInPlace ) {
+    MappedFile mapping;
+    ASSERT_TRUE( mapping.open( fileName ) );
+    ASSERT_THAT( mapping.size(), Eq( content.size() ) );
+
+    QByteArray read;
+    ASSERT_TRUE( mapping.access( 100, 5000, [&]( const char* data ) {
+        read = QByteArray( data, 5000 );
+    } ) );
+    ASSERT_THAT( read, Eq( content.mid( 100, 5000 ) ) );
+
+    ASSERT_FALSE( mapping.access( content.size() - 10, 20, []( const char* ) {} ) );
+}
+
+TEST_F( MappedFileBehaviour, reportsTheTruncationOfTheFile ) {
+    MappedFile mapping;
+    ASSERT_TRUE( mapping.open( fileName ) );
+    truncate( 0 );
+
+    // The pages after the end of the file are read as zeros
+    QByteArray read;
+    ASSERT_FALSE( mapping.access( 64 * 1024, 128 * 1024, [&]( const char* data ) {
+        read = QByteArray( data, 128 * 1024 );
+    } ) );
+    ASSERT_THAT( read, Eq( QByteArray( 128 * 1024, '\0' ) ) );
+    ASSERT_TRUE( mapping.isTruncated() );
+
+    // And read again once the file is mapped again
+    write( content );
+    ASSERT_TRUE( mapping.remap() );
+    ASSERT_FALSE( mapping.isTruncated() );
+    ASSERT_TRUE( mapping.access( 64 * 1024, 1000, [&]( const char* data ) {
+        read = QByteArray( data, 1000 );
+    } ) );
+    ASSERT_THAT( read, Eq( content.mid( 64 * 1024, 1000 ) ) );
+}
+
+TEST_F( MappedFileBehaviour, reportsATruncationWhileReading ) {
+    MappedFile mapping;
+    ASSERT_TRUE( mapping.open( fileName ) );
+
+    int nb_lines = 0;
+    ASSERT_FALSE( mapping.access( 0, content.size(), [&]( const char* data ) {
+        truncate( 64 * 1024 );
+        nb_lines = std::count( data, data + content.size(), '\n' );
+    } ) );
+    ASSERT_THAT( nb_lines, Eq( content.left( 64 * 1024 ).count( '\n' ) ) );
+}
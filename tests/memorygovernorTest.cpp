@@ -0,0 +1,106 @@
+#include <vector>
+
+#include "gmock/gmock.h"
+
+#include "log.h"
+
+#include "data/memorygovernor.h"
+
+using namespace std;
+using namespace testing;
+
+// Holds 'cache' bytes it can drop and 'index' bytes it can halve
+class FakeConsumer : public MemoryConsumer {
+  public:
+    FakeConsumer( qint64 cache, qint64 index ) : cache_( cache ), index_( index ) {}
+
+    qint64 memoryUsage() const override { return cache_ + index_; }
+
+    void releaseMemory( Release level ) override {
+        releases.push_back( level );
+        if ( level == Release::Caches )
+            cache_ = 0;
+        else if ( level == Release::Sparse )
+            index_ /= 2;
+    }
+
+    vector<Release> releases;
+
+  private:
+    qint64 cache_;
+    qint64 index_;
+};
+
+class MemoryGovernorBehaviour : public testing::Test {
+  public:
+    MemoryGovernor& governor = MemoryGovernor::get();
+
+    ~MemoryGovernorBehaviour() {
+        governor.setBudget( 0 );
+    }
+};
+
+TEST_F( MemoryGovernorBehaviour, AddsTheUsageOfAllTheConsumers ) {
+    const qint64 initial_usage = governor.memoryUsage();
+    FakeConsumer first( 100, 1000 );
+    {
+        FakeConsumer second( 10, 200 );
+        ASSERT_THAT( governor.memoryUsage(), Eq( initial_usage + 1310 ) );
+    }
+    ASSERT_THAT( governor.memoryUsage(), Eq( initial_usage + 1100 ) );
+}
+
+TEST_F( MemoryGovernorBehaviour, DoesNothingWithoutBudget ) {
+    FakeConsumer consumer( 100, 1000 );
+
+    governor.rebalance();
+
+    ASSERT_THAT( consumer.releases, IsEmpty() );
+}
+
+TEST_F( MemoryGovernorBehaviour, DoesNothingUnderBudget ) {
+    FakeConsumer consumer( 100, 1000 );
+
+    governor.setBudget( governor.memoryUsage() );
+    governor.rebalance();
+
+    ASSERT_THAT( consumer.releases, IsEmpty() );
+}
+
+TEST_F( MemoryGovernorBehaviour, AsksTheLeastRecentlyUsedFirst ) {
+    FakeConsumer background( 100, 1000 );
+    FakeConsumer foreground( 100, 1000 );
+    background.touch();
+    foreground.touch();
+
+    governor.setBudget( governor.memoryUsage() - 50 );
+    governor.rebalance();
+
+    ASSERT_THAT( background.releases, ElementsAre( MemoryConsumer::Release::Caches ) );
+    ASSERT_THAT( foreground.releases, IsEmpty() );
+}
+
+TEST_F( MemoryGovernorBehaviour, DropsAllTheCachesBeforeGoingFurther ) {
+    FakeConsumer background( 100, 1000 );
+    FakeConsumer foreground( 100, 1000 );
+    foreground.touch();
+
+    governor.setBudget( governor.memoryUsage() - 600 );
+    governor.rebalance();
+
+    ASSERT_THAT( background.releases, ElementsAre(
+                MemoryConsumer::Release::Caches, MemoryConsumer::Release::Compact,
+                MemoryConsumer::Release::Sparse ) );
+    ASSERT_THAT( foreground.releases, ElementsAre(
+                MemoryConsumer::Release::Caches, MemoryConsumer::Release::Compact ) );
+    ASSERT_THAT( background.memoryUsage(), Eq( 500 ) );
+    ASSERT_THAT( foreground.memoryUsage(), Eq( 1000 ) );
+}
+
+TEST_F( MemoryGovernorBehaviour, StopsWhenNothingMoreCanBeReleased ) {
+    FakeConsumer consumer( 100, 1000 );
+
+    governor.shrinkTo( 0 );
+
+    ASSERT_THAT( consumer.memoryUsage(), Eq( 500 ) );
+}
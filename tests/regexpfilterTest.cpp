@@ -0,0 +1,75 @@
+#include "gmock/gmock.h"
+
+#include <QByteArray>
+#include <QString>
+
+#include "regexp_filter.h"
+
+using namespace testing;
+
+TEST( RegExpFilterBehaviour, MatchesUtf8LikeTheDecodedLines ) {
+    const RegExpFilter filters[] = {
+        RegExpFilter( "ERROR.*timeout" ),
+        RegExpFilter( "ERROR.*timeout", ExtendedRegexp, false ),
+        RegExpFilter( "café|\\w+\\d$" ),
+        RegExpFilter( "req_id=abc123", FixedString ),
+        RegExpFilter( "error|||timeout" ),
+        RegExpFilter( "^\\s*\\p{Lu}" ) };
+    const char* lines[] = {
+        "",
+        "12:00 ERROR connection timeout",
+        "12:00 error Connection TIMEOUT",
+        "12:00 ERROR connection refused",
+        "CAF\xC3\x89 cr\xC3\xA8me \xE2\x82\xAC\t\xF0\x9F\x98\x80 req_id=abc123",
+        "\xC3\xA9t\xC3\xA9" "2",
+        "  \xC3\x89t\xC3\xA9" };
+
+    for ( const RegExpFilter& filter : filters ) {
+        if ( ! filter.canMatchUtf8() )
+            continue;   // (not built with pcre2)
+
+        for ( const char* line : lines ) {
+            const QByteArray bytes( line );
+            bool matched = false;
+            ASSERT_TRUE( filter.hasUtf8Match( bytes.constData(), bytes.size(), &matched ) );
+            ASSERT_THAT( matched, Eq( filter.hasMatch( QString::fromUtf8( bytes ) ) ) );
+        }
+    }
+}
+
+TEST( RegExpFilterBehaviour, LeavesInvalidUtf8ToTheDecodedLines ) {
+    const RegExpFilter filter( "timeout" );
+    const QByteArray bytes( "caf\xE9 timeout" );
+
+    bool matched;
+    ASSERT_FALSE( filter.canMatchUtf8()
+            && filter.hasUtf8Match( bytes.constData(), bytes.size(), &matched ) );
+}
+
+TEST( RegExpFilterBehaviour, ExtractsTheLiteralsEveryMatchContains ) {
+    const struct {
+        RegExpFilter filter;
+        QByteArray literal;
+    } filters[] = {
+        { RegExpFilter( "ERROR.*timeout", ExtendedRegexp, false ), "timeout" },
+        { RegExpFilter( "ERROR.*timeout" ), "timeout" },
+        { RegExpFilter( "req_id=abc123", FixedString ), "req_id=abc123" },
+        { RegExpFilter( "a.b (x+y)", FixedString ), "a.b (x+y)" },
+        { RegExpFilter( "\\[Main\\] \\d+ss?ions?|||debug" ), "[main] " },
+        { RegExpFilter( "colou?r[ =]+grey\\.", ExtendedRegexp, false ), "grey." },
+        { RegExpFilter( "(fatal) at line\\s\\d{2,3}" ), " at line" },
+        { RegExpFilter( "ask" ), "" },
+        { RegExpFilter( "error|warning" ), "" },
+        { RegExpFilter( "(?-i)ERROR" ), "" },
+        { RegExpFilter( "\\x41BC" ), "" },
+        { RegExpFilter( "café" ), "caf" },
+        { RegExpFilter( "[[:space:]]ERROR" ), "error" },
+        { RegExpFilter( "([[:digit:]])xy" ), "xy" },
+        { RegExpFilter( "([])]x)yz" ), "yz" },
+        { RegExpFilter( "[^]a]bc" ), "bc" },
+        { RegExpFilter( "[[:x]]bc" ), "]bc" } };
+
+    // (in lower case when the case is ignored)
+    for ( const auto& filter : filters )
+        ASSERT_THAT( filter.filter.requiredLiteral().literal(), Eq( filter.literal ) );
+}
@@ -0,0 +1,136 @@
+#include "gmock/gmock.h"
+
+#include <random>
+#include <vector>
+
+#include "data/searchresultarray.h"
+
+using namespace std;
+using namespace testing;
+
+// Lines matching with the passed probability out of nb_lines,
+// from first_line
+static vector<LineNumber> randomLines( mt19937* random,
+        LineNumber first_line, int nb_lines, double probability )
+{
+    bernoulli_distribution matches( probability );
+    vector<LineNumber> lines;
+    for ( int i = 0; i < nb_lines; ++i ) {
+        if ( matches( *random ) )
+            lines.push_back( first_line + i );
+    }
+
+    return lines;
+}
+
+static void expectSameMatches( const SearchResultArray& array,
+        const vector<LineNumber>& lines )
+{
+    ASSERT_THAT( array.size(), Eq( lines.size() ) );
+
+    size_t i = 0;
+    for ( auto match = array.begin(); match != array.end(); ++match, ++i )
+        ASSERT_THAT( ( *match ).lineNumber(), Eq( lines[i] ) ) << "match " << i;
+    ASSERT_THAT( i, Eq( lines.size() ) );
+
+    for ( i = 0; i < lines.size(); i += 7 )
+        ASSERT_THAT( array[i].lineNumber(), Eq( lines[i] ) ) << "match " << i;
+}
+
+class SearchResultArrayBehaviour: public testing::TestWithParam<double> {
+};
+
+TEST_P( SearchResultArrayBehaviour, keepsTheMatches ) {
+    mt19937 random( 42 );
+    const vector<LineNumber> lines = randomLines( &random, 10, 200000, GetParam() );
+
+    SearchResultArray array;
+    for ( const LineNumber line : lines )
+        array.push_back( MatchingLine( line ) );
+
+    expectSameMatches( array, lines );
+}
+
+TEST_P( SearchResultArrayBehaviour, findsTheLines ) {
+    mt19937 random( 7 );
+    const vector<LineNumber> lines = randomLines( &random, 0, 100000, GetParam() );
+
+    SearchResultArray array;
+    for ( const LineNumber line : lines )
+        array.push_back( MatchingLine( line ) );
+
+    for ( LineNumber line = 0; line < 100010; line += 3 ) {
+        const size_t expected = lower_bound( lines.begin(), lines.end(), line ) - lines.begin();
+        ASSERT_THAT( array.lowerBound( line ), Eq( expected ) ) << "line " << line;
+        ASSERT_THAT( array.contains( line ),
+                Eq( expected < lines.size() && lines[expected] == line ) ) << "line " << line;
+    }
+}
+
+TEST_P( SearchResultArrayBehaviour, copiesAreIndependent ) {
+    mt19937 random( 3 );
+    vector<LineNumber> lines = randomLines( &random, 0, 50000, GetParam() );
+
+    SearchResultArray array;
+    for ( const LineNumber line : lines )
+        array.push_back( MatchingLine( line ) );
+
+    const SearchResultArray snapshot = array;
+    SearchResultArray copy = array;
+    vector<LineNumber> copy_lines = lines;
+
+    // Both add matches after the ones they share
+    for ( const LineNumber line : randomLines( &random, 50000, 50000, GetParam() ) ) {
+        array.push_back( MatchingLine( line ) );
+        lines.push_back( line );
+    }
+    for ( const LineNumber line : randomLines( &random, 60000, 20000, 1.0 ) ) {
+        copy.push_back( MatchingLine( line ) );
+        copy_lines.push_back( line );
+    }
+
+    expectSameMatches( array, lines );
+    expectSameMatches( copy, copy_lines );
+    expectSameMatches( snapshot, vector<LineNumber>( copy_lines.begin(),
+                copy_lines.begin() + snapshot.size() ) );
+}
+
+TEST_P( SearchResultArrayBehaviour, removesTheLastMatches ) {
+    mt19937 random( 5 );
+    vector<LineNumber> lines = randomLines( &random, 0, 30000, GetParam() );
+
+    SearchResultArray array;
+    for ( const LineNumber line : lines )
+        array.push_back( MatchingLine( line ) );
+
+    for ( int i = 0; i < SearchResultArray::chunkSize + 10 && ! lines.empty(); ++i ) {
+        ASSERT_THAT( array.back().lineNumber(), Eq( lines.back() ) );
+        array.pop_back();
+        lines.pop_back();
+    }
+    array.push_back( MatchingLine( 40000 ) );
+    lines.push_back( 40000 );
+
+    expectSameMatches( array, lines );
+}
+
+INSTANTIATE_TEST_CASE_P( DenseAndSparse, SearchResultArrayBehaviour,
+        testing::Values( 1.0, 0.5, 0.05, 0.0001 ) );
+
+TEST( SearchResultArrayMemory, isCompactForDenseMatches ) {
+    SearchResultArray array;
+    for ( LineNumber line = 0; line < 1000000; ++line )
+        array.push_back( MatchingLine( line ) );
+
+    ASSERT_THAT( array.memoryUsage(), Lt( 1000000 / 4 ) );
+}
+
+TEST( SearchResultArrayMemory, copiesOnlyUseTheirLastMatches ) {
+    SearchResultArray array;
+    for ( LineNumber line = 0; line < 1000000; ++line )
+        array.push_back( MatchingLine( line ) );
+
+    const SearchResultArray copy = array;
+    ASSERT_THAT( copy.unsharedMemoryUsage(),
+            Lt( SearchResultArray::chunkSize * sizeof( LineNumber ) ) );
+}
@@ -0,0 +1,135 @@
+#include <atomic>
+#include <thread>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "gmock/gmock.h"
+
+#include "log.h"
+
+#include "data/sparselinepositionarray.h"
+
+using namespace std;
+using namespace testing;
+
+class SparseLinePositionArrayBehaviour : public testing::Test {
+  public:
+    QTemporaryDir directory;
+    QString file_name;
+    // All the positions, as a dense array would have them
+    vector<uint64_t> positions;
+
+    static const int STRIDE = 8;
+
+    SparseLinePositionArrayBehaviour() {
+        file_name = directory.filePath( "file.log" );
+
+        // Lines of various lengths, including empty ones
+        QFile file( file_name );
+        file.open( QIODevice::WriteOnly );
+        uint64_t position = 0;
+        for ( int i = 0; i < 1000; ++i ) {
+            const int length = ( i * 7 ) % 23;
+            file.write( QByteArray( length, 'a' + i % 26 ) + '\n' );
+            position += length + 1;
+            positions.push_back( position );
+        }
+    }
+
+    // Add the positions [begin, end) to the array
+    void addPositions( SparseLinePositionArray* array, int begin, int end ) {
+        FastLinePositionArray lines;
+        for ( int i = begin; i < end; ++i )
+            lines.append( positions[i] );
+        array->append_list( lines );
+    }
+
+    void expectAllPositions( const SparseLinePositionArray& array, int nb_lines ) {
+        ASSERT_THAT( array.size(), Eq( static_cast<LineNumber>( nb_lines ) ) );
+        for ( int i = 0; i < nb_lines; ++i )
+            ASSERT_THAT( array.at( i ), Eq( positions[i] ) );
+    }
+};
+
+TEST_F( SparseLinePositionArrayBehaviour, ReturnsAllThePositions ) {
+    SparseLinePositionArray array( file_name, STRIDE, 4 );
+    addPositions( &array, 0, 1000 );
+
+    expectAllPositions( array, 1000 );
+}
+
+TEST_F( SparseLinePositionArrayBehaviour, CanBeFilledInSeveralSteps ) {
+    SparseLinePositionArray array( file_name, STRIDE, 4 );
+    addPositions( &array, 0, 3 );
+    addPositions( &array, 3, 17 );
+    addPositions( &array, 17, 24 );
+    addPositions( &array, 24, 995 );
+
+    expectAllPositions( array, 995 );
+}
+
+TEST_F( SparseLinePositionArrayBehaviour, ReadsTheBlocksInAnyOrder ) {
+    SparseLinePositionArray array( file_name, STRIDE, 2 );
+    addPositions( &array, 0, 1000 );
+
+    for ( int i = 999; i >= 0; i -= 3 )
+        ASSERT_THAT( array.at( i ), Eq( positions[i] ) );
+    for ( int i = 0; i < 1000; i += 37 )
+        ASSERT_THAT( array.at( i ), Eq( positions[i] ) );
+}
+
+TEST_F( SparseLinePositionArrayBehaviour, ReplacesTheFakeFinalLF ) {
+    SparseLinePositionArray array( file_name, STRIDE, 4 );
+    addPositions( &array, 0, STRIDE - 1 );
+
+    // The fake LF would complete the block
+    FastLinePositionArray fake;
+    fake.append( 123456 );
+    fake.setFakeFinalLF();
+    array.append_list( fake );
+    ASSERT_THAT( array.size(), Eq( static_cast<LineNumber>( STRIDE ) ) );
+    ASSERT_THAT( array.at( STRIDE - 1 ), Eq( 123456u ) );
+    ASSERT_TRUE( array.hasFakeFinalLF() );
+
+    addPositions( &array, STRIDE - 1, 100 );
+    ASSERT_FALSE( array.hasFakeFinalLF() );
+    expectAllPositions( array, 100 );
+}
+
+TEST_F( SparseLinePositionArrayBehaviour, IsEmptyOnceCleared ) {
+    SparseLinePositionArray array( file_name, STRIDE, 4 );
+    addPositions( &array, 0, 100 );
+    array.at( 10 );
+
+    array.clear();
+    ASSERT_THAT( array.size(), Eq( 0u ) );
+
+    addPositions( &array, 0, 50 );
+    expectAllPositions( array, 50 );
+}
+
+TEST_F( SparseLinePositionArrayBehaviour, CanBeReadFromSeveralThreads ) {
+    SparseLinePositionArray array( file_name, STRIDE, 2 );
+    addPositions( &array, 0, 500 );
+
+    // (more blocks than cached, so they are read again and again)
+    std::atomic<int> errors( 0 );
+    vector<thread> readers;
+    for ( int t = 0; t < 4; ++t ) {
+        readers.emplace_back( [&, t]() {
+            for ( int i = t; i < 1000; i += 3 ) {
+                if ( i < 500 && array.at( i ) != positions[i] )
+                    ++errors;
+            }
+        } );
+    }
+
+    // While the other lines are added
+    addPositions( &array, 500, 1000 );
+    for ( auto& reader : readers )
+        reader.join();
+
+    ASSERT_THAT( errors.load(), Eq( 0 ) );
+    expectAllPositions( array, 1000 );
+}
@@ -0,0 +1,72 @@
+#include "gmock/gmock.h"
+
+#include <QByteArray>
+
+#include "data/abstractlogdata.h"
+#include "data/trigramindex.h"
+
+using namespace testing;
+
+// The passed text, one line per LF
+static RawLines linesOf( const QByteArray& text )
+{
+    RawLines lines;
+    lines.setBuffer( text );
+    int begin = 0;
+    for ( int end = text.indexOf( '\n' ); end >= 0; end = text.indexOf( '\n', begin ) ) {
+        lines.addLine( begin, end );
+        begin = end + 1;
+    }
+    lines.addLine( begin, text.size() );
+
+    return lines;
+}
+
+class TrigramIndexBehaviour : public testing::Test {
+  public:
+    TrigramIndexBehaviour() {
+        index.append( index.generation(), 0, TrigramIndex::bitmapOf( linesOf(
+                        "12:00 ERROR connection timeout\n12:01 INFO done" ) ) );
+        index.append( index.generation(), 1, TrigramIndex::bitmapOf( linesOf(
+                        "12:02 INFO connected\n12:03 INFO done" ) ) );
+    }
+
+    TrigramIndex index;
+};
+
+TEST_F( TrigramIndexBehaviour, skipsTheBlocksWithoutTheTrigrams ) {
+    const TrigramIndex::Trigrams trigrams = TrigramIndex::trigramsOf( "timeout" );
+
+    ASSERT_THAT( trigrams.size(), Eq( 5u ) );
+    ASSERT_TRUE( index.mayContain( 0, trigrams ) );
+    ASSERT_FALSE( index.mayContain( 1, trigrams ) );
+    // (not indexed)
+    ASSERT_TRUE( index.mayContain( 2, trigrams ) );
+}
+
+TEST_F( TrigramIndexBehaviour, ignoresTheCaseOfLetters ) {
+    ASSERT_TRUE( index.mayContain( 0, TrigramIndex::trigramsOf( "error" ) ) );
+    ASSERT_TRUE( index.mayContain( 1, TrigramIndex::trigramsOf( "Info" ) ) );
+    ASSERT_FALSE( index.mayContain( 1, TrigramIndex::trigramsOf( "Error" ) ) );
+}
+
+TEST_F( TrigramIndexBehaviour, doesNotSkipForShortLiterals ) {
+    const TrigramIndex::Trigrams trigrams = TrigramIndex::trigramsOf( "ti" );
+
+    ASSERT_TRUE( trigrams.empty() );
+    ASSERT_TRUE( index.mayContain( 1, trigrams ) );
+}
+
+TEST_F( TrigramIndexBehaviour, onlyAppendsTheNextBlockOfTheSameGeneration ) {
+    const uint64_t generation = index.generation();
+    const TrigramIndex::Bitmap bitmap = TrigramIndex::bitmapOf( linesOf( "line" ) );
+
+    ASSERT_FALSE( index.append( generation, 3, bitmap ) );
+    ASSERT_TRUE( index.append( generation, 2, bitmap ) );
+    ASSERT_THAT( index.nbBlocks(), Eq( 3 ) );
+
+    index.clear();
+    ASSERT_THAT( index.nbBlocks(), Eq( 0 ) );
+    ASSERT_FALSE( index.append( generation, 0, bitmap ) );
+    ASSERT_TRUE( index.append( index.generation(), 0, bitmap ) );
+}